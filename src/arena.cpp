@@ -0,0 +1,178 @@
+#include "arena.h"
+#include "asserts.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if ALLOC_COUNTING
+
+static std::atomic<u64> g_allocCount{0};
+
+u64 AllocCount()
+{
+    return g_allocCount.load(std::memory_order_relaxed);
+}
+
+void CountAlloc()
+{
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+// the counting hook; the aligned forms keep their defaults
+void* operator new(size_t bytes)
+{
+    CountAlloc();
+    void* p = malloc(bytes ? bytes : 1);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t bytes)
+{
+    return operator new(bytes);
+}
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept
+{
+    CountAlloc();
+    return malloc(bytes ? bytes : 1);
+}
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept
+{
+    return operator new(bytes, std::nothrow);
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+
+#endif // ALLOC_COUNTING
+
+// ------------------------------------------------------------------------
+
+Arena::~Arena()
+{
+    reset();
+    while(m_spare)
+    {
+        Chunk* prev = m_spare->m_prev;
+        free(m_spare);
+        m_spare = prev;
+    }
+}
+
+void Arena::newChunk(size_t bytes)
+{
+    // reuse the first spare that fits, else allocate
+    Chunk** link = &m_spare;
+    while(*link && (*link)->m_size < bytes)
+    {
+        link = &(*link)->m_prev;
+    }
+    Chunk* c = *link;
+    if(c)
+    {
+        *link = c->m_prev;
+    }
+    else
+    {
+        const size_t size = bytes > m_chunkSize ? bytes : m_chunkSize;
+        CountAlloc();
+        c = (Chunk*)malloc(sizeof(Chunk) + size);
+        Assert(c);
+        c->m_size = size;
+    }
+    c->m_prev = m_chunk;
+    m_chunk = c;
+    m_used = 0;
+}
+
+// offset from base of the first align boundary at or after base + used;
+// chunk data is only as aligned as malloc, so this aligns the address
+static size_t AlignedOffset(const u8* base, size_t used, size_t align)
+{
+    const uintptr_t p = (uintptr_t(base) + used + align - 1) & ~uintptr_t(align - 1);
+    return size_t(p - uintptr_t(base));
+}
+
+void* Arena::alloc(size_t bytes, size_t align)
+{
+    Assert(align && (align & (align - 1)) == 0);
+    size_t offset = m_chunk ? AlignedOffset(chunkData(m_chunk), m_used, align) : 0;
+    if(!m_chunk || offset + bytes > m_chunk->m_size)
+    {
+        // the extra align bytes leave room to round up within the chunk
+        newChunk(bytes + align);
+        offset = AlignedOffset(chunkData(m_chunk), 0, align);
+    }
+    m_last = chunkData(m_chunk) + offset;
+    m_used = offset + bytes;
+    return m_last;
+}
+
+void* Arena::realloc(void* ptr, size_t old_bytes, size_t new_bytes, size_t align)
+{
+    if(ptr && ptr == m_last && (u8*)ptr + new_bytes <= chunkData(m_chunk) + m_chunk->m_size)
+    {
+        m_used = size_t((u8*)ptr - chunkData(m_chunk)) + new_bytes;
+        return ptr;
+    }
+    void* out = alloc(new_bytes, align);
+    if(ptr && old_bytes)
+    {
+        memcpy(out, ptr, old_bytes < new_bytes ? old_bytes : new_bytes);
+    }
+    return out;
+}
+
+void Arena::reset(const Marker& m)
+{
+    while(m_chunk != m.m_chunk)
+    {
+        Assert(m_chunk);
+        Chunk* c = m_chunk;
+        m_chunk = c->m_prev;
+        c->m_prev = m_spare;
+        m_spare = c;
+    }
+    m_used = m.m_used;
+    m_last = nullptr;
+}
+
+size_t Arena::used() const
+{
+    size_t total = m_used;
+    for(Chunk* c = m_chunk ? m_chunk->m_prev : nullptr; c; c = c->m_prev)
+    {
+        total += c->m_size;
+    }
+    return total;
+}
+
+size_t Arena::reserved() const
+{
+    size_t total = 0;
+    for(Chunk* c = m_chunk; c; c = c->m_prev)
+    {
+        total += c->m_size;
+    }
+    for(Chunk* c = m_spare; c; c = c->m_prev)
+    {
+        total += c->m_size;
+    }
+    return total;
+}
+
+Arena& ThreadArena()
+{
+    static thread_local Arena arena;
+    return arena;
+}
+
+void ResetFrameArena()
+{
+    ThreadArena().reset();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "ints.h"
+#include <cstddef>
+
+// Linear allocator over a list of chunks. Allocating bumps an offset, freeing
+// is a no-op, and everything goes at once by resetting to a marker, so
+// transient lists cost no malloc once the chunks exist. Chunks released by a
+// reset are kept as spares for the next allocations.
+// An arena belongs to one thread. Memory from it must not outlive the scope
+// that allocated it, nor cross to a thread that could outlive it.
+class Arena
+{
+    struct Chunk
+    {
+        Chunk* m_prev;
+        size_t m_size;      // bytes after the header
+    };
+
+    Chunk* m_chunk = nullptr;
+    Chunk* m_spare = nullptr;
+    size_t m_used = 0;          // bytes used in m_chunk
+    size_t m_chunkSize;
+    u8* m_last = nullptr;       // the newest allocation, which realloc extends
+
+    u8* chunkData(Chunk* c) const { return (u8*)(c + 1); }
+    void newChunk(size_t bytes);
+
+public:
+    struct Marker
+    {
+        Chunk* m_chunk;
+        size_t m_used;
+    };
+
+    explicit Arena(size_t chunk_size = 1 << 20) : m_chunkSize(chunk_size){}
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* alloc(size_t bytes, size_t align = 16);
+    // grows ptr in place when it is the newest allocation and fits its
+    // chunk, else copies old_bytes into a new block
+    void* realloc(void* ptr, size_t old_bytes, size_t new_bytes, size_t align = 16);
+
+    // also ends in place growth of the newest allocation, which would
+    // otherwise run past the marker and be handed out again after a reset
+    Marker mark()
+    {
+        m_last = nullptr;
+        return { m_chunk, m_used };
+    }
+    // frees everything allocated since m
+    void reset(const Marker& m);
+    void reset(){ reset({ nullptr, 0 }); }
+    // bytes up to the current offset, counting earlier chunks whole, and
+    // bytes held in chunks including spares
+    size_t used() const;
+    size_t reserved() const;
+};
+
+// the calling thread's arena; made on first use, freed at thread exit
+Arena& ThreadArena();
+
+// resets the arena to where it was on construction
+struct ArenaScope
+{
+    Arena& m_arena;
+    Arena::Marker m_mark;
+
+    ArenaScope(Arena& arena = ThreadArena()) : m_arena(arena), m_mark(arena.mark()){}
+    ~ArenaScope(){ m_arena.reset(m_mark); }
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+};
+
+// The main thread's arena doubles as the frame arena: whatever the frame
+// left in it goes here. Call once per frame from the main thread.
+void ResetFrameArena();
+
+// Allocation counting for benchmarks, off by default since it replaces the
+// global operator new. When on, every operator new and every heap Vector
+// block bumps one counter, so a difference of AllocCount() around some work
+// is the number of allocations it made on all threads. When off AllocCount()
+// stays 0.
+#ifndef ALLOC_COUNTING
+#define ALLOC_COUNTING 0
+#endif
+
+#if ALLOC_COUNTING
+u64 AllocCount();
+void CountAlloc();
+#else
+inline u64 AllocCount(){ return 0; }
+inline void CountAlloc(){}
+#endif
@@ -0,0 +1,135 @@
+#include "array.h"
+#include "cputimer.h"
+
+// Vector as it was: default constructed new[] storage, grown by copy
+template<typename T>
+struct CopyVector
+{
+    T* _data = nullptr;
+    s32 _tail = 0;
+    s32 _capacity = 0;
+
+    ~CopyVector(){ delete[] _data; }
+    CopyVector(){}
+    CopyVector(const CopyVector& other){ *this = other; }
+    CopyVector& operator=(const CopyVector& other){
+        if(this == &other)
+            return *this;
+        delete[] _data;
+        _data = other._tail ? new T[other._tail] : nullptr;
+        _tail = _capacity = other._tail;
+        for(s32 i = 0; i < _tail; ++i){
+            _data[i] = other._data[i];
+        }
+        return *this;
+    }
+    s32 count()const{ return _tail; }
+    T& grow(){
+        if(_tail >= _capacity){
+            const s32 new_cap = _tail ? _tail << 1 : 16;
+            T* new_data = new T[new_cap];
+            for(s32 i = 0; i < _tail; ++i){
+                new_data[i] = _data[i];
+            }
+            delete[] _data;
+            _data = new_data;
+            _capacity = new_cap;
+        }
+        return _data[_tail++];
+    }
+};
+
+struct BenchVertex
+{
+    float position[3];
+    float normal[3];
+    u32 color;
+    u32 material;
+};
+
+template<typename V>
+static u64 PushScalars(const s32 count)
+{
+    V v;
+    for(s32 i = 0; i < count; ++i){
+        v.grow() = u32(i);
+    }
+    return u64(v.count());
+}
+
+template<typename V>
+static u64 PushVertices(const s32 count)
+{
+    V v;
+    for(s32 i = 0; i < count; ++i){
+        BenchVertex& b = v.grow();
+        b.position[0] = b.position[1] = b.position[2] = float(i);
+        b.normal[0] = b.normal[1] = b.normal[2] = 0.0f;
+        b.color = b.material = u32(i);
+    }
+    return u64(v.count());
+}
+
+// one short index list per cell, as meshing builds per SubTask
+template<typename V>
+static u64 PushShortLists(const s32 lists)
+{
+    u64 sum = 0;
+    for(s32 l = 0; l < lists; ++l){
+        V v;
+        const s32 len = 1 + (l * 7) % 12;
+        for(s32 i = 0; i < len; ++i){
+            v.grow() = u16(i);
+        }
+        sum += u64(v.count());
+    }
+    return sum;
+}
+
+// lists of lists, where growing the outer copies or moves every inner list
+template<typename Outer>
+static u64 PushNested(const s32 count)
+{
+    Outer outer;
+    for(s32 i = 0; i < count; ++i){
+        auto& inner = outer.grow();
+        for(s32 k = 0; k < 8; ++k){
+            inner.grow() = u32(i + k);
+        }
+    }
+    return u64(outer.count());
+}
+
+template<typename Fn>
+static double BenchMs(Fn fn, u64& sum)
+{
+    CPUTimer timer;
+    for(s32 rep = 0; rep < 5; ++rep){
+        sum += fn();
+    }
+    return timer.ms() / 5.0;
+}
+
+void VectorBench()
+{
+    u64 sum = 0;
+    const s32 scalars = 1 << 22;
+    const s32 verts = 1 << 20;
+    const s32 lists = 1 << 20;
+    const s32 nested = 1 << 16;
+
+    const double scalar_old = BenchMs([&](){ return PushScalars<CopyVector<u32>>(scalars); }, sum);
+    const double scalar_new = BenchMs([&](){ return PushScalars<Vector<u32>>(scalars); }, sum);
+    const double vert_old = BenchMs([&](){ return PushVertices<CopyVector<BenchVertex>>(verts); }, sum);
+    const double vert_new = BenchMs([&](){ return PushVertices<Vector<BenchVertex>>(verts); }, sum);
+    const double list_old = BenchMs([&](){ return PushShortLists<CopyVector<u16>>(lists); }, sum);
+    const double list_new = BenchMs([&](){ return PushShortLists<Vector<u16>>(lists); }, sum);
+    const double list_small = BenchMs([&](){ return PushShortLists<SmallVector<u16, 16>>(lists); }, sum);
+    const double nest_old = BenchMs([&](){ return PushNested<CopyVector<CopyVector<u32>>>(nested); }, sum);
+    const double nest_new = BenchMs([&](){ return PushNested<Vector<Vector<u32>>>(nested); }, sum);
+
+    printf("[Vector] push 4M u32: %.2f ms -> %.2f ms\n", scalar_old, scalar_new);
+    printf("[Vector] push 1M 32 byte vertices: %.2f ms -> %.2f ms\n", vert_old, vert_new);
+    printf("[Vector] 1M lists of 1-12 u16: %.2f ms -> %.2f ms, SmallVector<16> %.2f ms\n", list_old, list_new, list_small);
+    printf("[Vector] 64K lists of 8 u32 in a list: %.2f ms -> %.2f ms (%llu)\n", nest_old, nest_new, (unsigned long long)sum);
+}
@@ -2,8 +2,32 @@
 
 #include "asserts.h"
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include "hash.h"
 #include "ints.h"
+#include "arena.h"
+#include "sort.h"
+
+// Content equality for operator==: bytewise for trivially copyable T, as
+// hash() sees it, else element operator==.
+template<typename T>
+typename std::enable_if<std::is_trivially_copyable<T>::value, bool>::type
+ContentEqual(const T* a, const T* b, const s32 count){
+    return !count || a == b || !memcmp(a, b, sizeof(T) * count);
+}
+template<typename T>
+typename std::enable_if<!std::is_trivially_copyable<T>::value, bool>::type
+ContentEqual(const T* a, const T* b, const s32 count){
+    for(s32 i = 0; i < count; ++i){
+        if(!(a[i] == b[i]))
+            return false;
+    }
+    return true;
+}
 
 template<typename T, s32 _capacity>
 class Array
@@ -63,8 +87,8 @@ public:
     s32 bytes()const{
         return sizeof(T) * _tail;
     }
-    u32 hash()const{
-        return fnv(_data, bytes());
+    u64 hash()const{
+        return hash64(_data, bytes());
     }
     void resize(s32 count){
         Assert(count <= _capacity);
@@ -93,33 +117,16 @@ public:
             remove(idx);
         }
     }
+    // sorts [a, b): radix sort for integers and floats, else introsort on <
     void sort(s32 a, s32 b){
-        if(a - b < 2)
-            return;
-
-        s32 i, j;
-        {
-            T& pivot = _data[(a + b) >> 1];
-            for(i = a, j = b - 1; ; ++i, --j){
-                while(_data[i] < pivot) ++i;
-                while(_data[j] > pivot) --j;
-    
-                if(i >= j) break;
-    
-                T temp = _data[i];
-                _data[i] = _data[j];
-                _data[j] = temp;
-            }
-        }
-
-        sort(a, i);
-        sort(i, b);
+        Assert(a >= 0 && a <= b && b <= _tail);
+        Sort(_data + a, _data + b);
     }
     void sort(){
         sort(0, _tail);
     }
     bool operator==(const Array& other)const{
-        return hash() == other.hash();
+        return _tail == other._tail && ContentEqual(_data, other._data, _tail);
     }
     void serialize(FILE* pFile){
         fwrite(&_tail, sizeof(u32), 1, pFile);
@@ -127,18 +134,151 @@ public:
     }
 };
 
+// Vector block allocators. HeapAlloc counts each call for AllocCount.
+struct HeapAlloc
+{
+    static void* alloc(size_t bytes){
+        CountAlloc();
+        return malloc(bytes);
+    }
+    static void* realloc(void* p, size_t, size_t bytes){
+        CountAlloc();
+        return ::realloc(p, bytes);
+    }
+    static void release(void* p, size_t){ free(p); }
+};
+
+// blocks from the calling thread's arena, given back by its next ArenaScope
+// reset rather than by the Vector
+struct ArenaAlloc
+{
+    static void* alloc(size_t bytes){ return ThreadArena().alloc(bytes); }
+    static void* realloc(void* p, size_t old_bytes, size_t bytes){
+        return ThreadArena().realloc(p, old_bytes, bytes);
+    }
+    static void release(void*, size_t){}
+};
+
+// Vector storage is raw memory: only [0, count) holds live objects, spare
+// capacity is never constructed. Trivially copyable types grow with realloc,
+// which can often extend the block in place, and copy with memcpy; anything
+// else is move constructed into the new block and the old objects destroyed.
+template<typename T, typename A, bool = std::is_trivially_copyable<T>::value>
+struct VectorOps
+{
+    // moves count objects from a block of old_cap slots into a new block of
+    // capacity slots; frees data when owned, i.e. not an inline buffer
+    static T* relocate(T* data, const s32 count, const s32 old_cap, const s32 capacity, const bool owned){
+        T* out = (T*)A::alloc(sizeof(T) * capacity);
+        Assert(out);
+        for(s32 i = 0; i < count; ++i){
+            new(out + i) T(std::move(data[i]));
+            data[i].~T();
+        }
+        if(owned){
+            A::release(data, sizeof(T) * old_cap);
+        }
+        return out;
+    }
+    static void destroy(T* data, const s32 count){
+        for(s32 i = 0; i < count; ++i){
+            data[i].~T();
+        }
+    }
+    static void copy(T* dst, const T* src, const s32 count){
+        for(s32 i = 0; i < count; ++i){
+            new(dst + i) T(src[i]);
+        }
+    }
+    static void move(T* dst, T* src, const s32 count){
+        for(s32 i = 0; i < count; ++i){
+            new(dst + i) T(std::move(src[i]));
+            src[i].~T();
+        }
+    }
+};
+
+template<typename T, typename A>
+struct VectorOps<T, A, true>
+{
+    static T* relocate(T* data, const s32 count, const s32 old_cap, const s32 capacity, const bool owned){
+        T* out = (T*)(owned ? A::realloc(data, sizeof(T) * old_cap, sizeof(T) * capacity) : A::alloc(sizeof(T) * capacity));
+        Assert(out);
+        if(!owned && count){
+            memcpy(out, data, sizeof(T) * count);
+        }
+        return out;
+    }
+    static void destroy(T*, const s32){}
+    static void copy(T* dst, const T* src, const s32 count){
+        if(count){
+            memcpy(dst, src, sizeof(T) * count);
+        }
+    }
+    static void move(T* dst, T* src, const s32 count){
+        copy(dst, src, count);
+    }
+};
+
+// the first N elements of a SmallVector live inside it
+template<typename T, s32 N>
+struct VectorInline
+{
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type _inline[N];
+    T* inlineData(){ return (T*)_inline; }
+};
+
 template<typename T>
-class Vector
+struct VectorInline<T, 0>
 {
+    T* inlineData(){ return nullptr; }
+};
+
+template<typename T, s32 N = 0, typename A = HeapAlloc>
+class Vector : VectorInline<T, N>
+{
+    // malloc, realloc and Arena align to 16 bytes on every target
+    static_assert(alignof(T) <= 16, "Vector storage comes from malloc");
+    typedef VectorOps<T, A> Ops;
+
     T* _data;
     s32 _tail;
     s32 _capacity;
+
+    bool owned(){ return _data != this->inlineData(); }
+    void release(){
+        Ops::destroy(_data, _tail);
+        if(owned()){
+            A::release(_data, sizeof(T) * _capacity);
+        }
+        _data = this->inlineData();
+        _tail = 0;
+        _capacity = N;
+    }
+    // takes other's heap block, or moves its inline elements one by one
+    void take(Vector& other){
+        if(other.owned()){
+            _data = other._data;
+            _tail = other._tail;
+            _capacity = other._capacity;
+        }
+        else{
+            // with no inline storage there is nothing to move, and the
+            // null inline pointer must not reach memcpy
+            if(N > 0 && other._tail > 0)
+                Ops::move(_data, other._data, other._tail);
+            _tail = other._tail;
+        }
+        other._data = other.inlineData();
+        other._tail = 0;
+        other._capacity = N;
+    }
 public:
     s32 capacity()const{ return _capacity; }
     s32 count()const{ return _tail; }
     bool full()const{ return _tail >= _capacity; }
     s32 bytes()const{ return sizeof(T) * _tail; }
-    s32 hash()const{ return fnv(_data, bytes()); }
+    u64 hash()const{ return hash64(_data, bytes()); }
 
     T* begin(){ return _data; }
     const T* begin()const{ return _data; }
@@ -161,48 +301,66 @@ public:
         return _data[idx];
     }
 
+    // sets the capacity; 0 frees the storage, a smaller capacity drops the
+    // elements past it but keeps the block
     void resize(const s32 new_cap){
         if(!new_cap){
-            delete[] _data;
-            _data = nullptr;
+            release();
         }
         else if(new_cap > _capacity){
-            T* new_data = new T[new_cap];
-            
-            if(_data){
-                for(s32 i = 0; i < _tail; ++i){
-                    new_data[i] = _data[i];
-                }
-                delete[] _data;
-            }
-            _data = new_data;
+            _data = Ops::relocate(_data, _tail, _capacity, new_cap, owned());
+            _capacity = new_cap;
+        }
+        else if(new_cap < _tail){
+            Ops::destroy(_data + new_cap, _tail - new_cap);
+            _tail = new_cap;
         }
-        _capacity = new_cap;
-        _tail = _tail < _capacity ? _tail : _capacity;
     }
 
     T& append(){
         Assert(_tail < _capacity);
-        ++_tail;
-        return _data[_tail - 1];
+        return *new(_data + _tail++) T;
     }
+    // doubles from 16, or from N for a SmallVector
     T& grow(){
         if(_tail >= _capacity){
-            resize(_tail ? _tail << 1 : 16);
+            reserve(_capacity ? _capacity << 1 : 16);
         }
-        ++_tail;
-        return _data[_tail - 1];
+        return *new(_data + _tail++) T;
+    }
+    // constructs in place rather than default constructing and assigning
+    T& push(const T& t){
+        if(_tail >= _capacity){
+            reserve(_capacity ? _capacity << 1 : 16);
+        }
+        return *new(_data + _tail++) T(t);
+    }
+    T& push(T&& t){
+        if(_tail >= _capacity){
+            reserve(_capacity ? _capacity << 1 : 16);
+        }
+        return *new(_data + _tail++) T(std::move(t));
     }
     T pop(){
         Assert(_tail > 0);
         --_tail;
-        return _data[_tail];
+        T t(std::move(_data[_tail]));
+        _data[_tail].~T();
+        return t;
     }
-    void clear(){ _tail = 0; }
+    // destroys the elements and keeps the storage
+    void clear(){
+        Ops::destroy(_data, _tail);
+        _tail = 0;
+    }
+    // swaps the last element into idx
     void remove(s32 idx){
-        Assert(idx <= _tail);
-        --tail;
-        _data[idx] = _data[tail];
+        Assert(idx >= 0 && idx < _tail);
+        --_tail;
+        if(idx != _tail){
+            _data[idx] = std::move(_data[_tail]);
+        }
+        _data[_tail].~T();
     }
     s32 find(const T& t){
         for(s32 i = 0; i < _tail; ++i){
@@ -213,7 +371,7 @@ public:
     }
     void uniquePush(const T& t){
         if(find(t) == -1){
-            grow() = t;
+            push(t);
         }
     }
     void findRemove(const T& t){
@@ -222,78 +380,37 @@ public:
             remove(idx);
         }
     }
+    // sorts [a, b): radix sort for integers and floats, else introsort on <
     void sort(s32 a, s32 b){
-        if(a - b < 2)
-            return;
-
-        s32 i, j;
-        {
-            T& pivot = _data[(a + b) >> 1];
-            for(i = a, j = b - 1; ; ++i, --j){
-                while(_data[i] < pivot) ++i;
-                while(_data[j] > pivot) --j;
-
-                if(i >= j) break;
-
-                T temp = _data[i];
-                _data[i] = _data[j];
-                _data[j] = temp;
-            }
-        }
-
-        sort(a, i);
-        sort(i, b);
+        Assert(a >= 0 && a <= b && b <= _tail);
+        Sort(_data + a, _data + b);
     }
     void sort(){
         sort(0, _tail);
     }
-    Vector() : _data(nullptr), _tail(0), _capacity(0){
+    Vector() : _data(this->inlineData()), _tail(0), _capacity(N){
     }
-    Vector(s32 cap){
-        if(cap > 0){
-            _data = new T[cap];
-        }
-        else{
-            _data = nullptr;
-        }
-        _capacity = cap;
-        _tail = 0;
+    Vector(s32 cap) : _data(this->inlineData()), _tail(0), _capacity(N){
+        reserve(cap);
     }
-    Vector(const Vector& other)
+    Vector(const Vector& other) : _data(this->inlineData()), _tail(0), _capacity(N)
     {
-        _data = nullptr;
-        _tail = 0;
         copy(other);
     }
-    Vector(Vector&& other) noexcept
+    Vector(Vector&& other) noexcept : _data(this->inlineData()), _tail(0), _capacity(N)
     {
-        _data = other._data;
-        _tail = other._tail;
-        _capacity = other._capacity;
-        other._data = nullptr;
-        other._tail = 0;
-        other._capacity = 0;
+        take(other);
     }
     ~Vector(){
-        if(_data){
-            delete[] _data;
-            _data = nullptr;
-        }
+        release();
     }
     void copy(const Vector& other){
-        if(_data){
-            delete[] _data;
-            _data = nullptr;
-        }
+        if(this == &other)
+            return;
+        clear();
+        reserve(other._tail);
+        Ops::copy(_data, other._data, other._tail);
         _tail = other._tail;
-        _capacity = _tail;
-        if(_tail){
-            _data = new T[_capacity];
-            for(s32 i = 0; i < _tail; ++i)
-            {
-                _data[i] = other._data[i];
-            }
-        }
     }
     Vector& operator=(const Vector& other){
         copy(other);
@@ -301,16 +418,14 @@ public:
     }
     Vector& operator=(Vector&& other) noexcept
     {
-        resize(0);
-        _data = other._data;
-        _tail = other._tail;
-        _capacity = other._capacity;
-        other._data = nullptr;
-        other._tail = 0;
-        other._capacity = 0;
+        if(this != &other){
+            release();
+            take(other);
+        }
+        return *this;
     }
     bool operator==(const Vector& other)const{
-        return hash() == other.hash();
+        return _tail == other._tail && ContentEqual(_data, other._data, _tail);
     }
     void serialize(FILE* pFile){
         fwrite(&_tail, sizeof(s32), 1, pFile);
@@ -326,47 +441,46 @@ public:
         }
     }
     void load(FILE* pFile){
-        if(_data){
-            delete[] _data;
-            _data = nullptr;
-        }
+        release();
         s32 count = 0;
         fread(&count, sizeof(s32), 1, pFile);
-        _tail = count;
-        _capacity = count;
+        reserve(count);
+        for(s32 i = 0; i < count; ++i){
+            append();
+        }
         if(count){
-            _data = new T[count];
             fread(_data, sizeof(T), count, pFile);
         }
     }
     // does NOT work on nested vectors
     void load_composite(FILE* pFile){
-        if(_data){
-            delete[] _data;
-            _data = nullptr;
-        }
+        release();
         s32 count = 0;
         fread(&count, sizeof(s32), 1, pFile);
-        _tail = count;
-        _capacity = count;
-        if(count){
-            _data = new T[count];
-            for(s32 i = 0; i < _tail; ++i){
-                _data[i].load(pFile);
-            }
+        reserve(count);
+        for(s32 i = 0; i < count; ++i){
+            append().load(pFile);
         }
     }
     void reserve(s32 new_cap)
     {
         if(_capacity < new_cap)
         {
-            T* new_data = new T[new_cap];
-            for(s32 i = 0; i < _tail; ++i)
-                new_data[i] = _data[i];
-
-            delete[] _data;
-            _data = new_data;
+            _data = Ops::relocate(_data, _tail, _capacity, new_cap, owned());
             _capacity = new_cap;
         }
     }
-};
\ No newline at end of file
+};
+
+// Vector whose first N elements need no allocation, for the many short lists
+// built per cell or per task; past N it spills to the heap like Vector
+template<typename T, s32 N>
+using SmallVector = Vector<T, N>;
+
+// Vector in the thread's arena, for scratch lists that die with an
+// ArenaScope on the thread that built them
+template<typename T, s32 N = 0>
+using ArenaVector = Vector<T, N, ArenaAlloc>;
+
+// push heavy workloads against the previous new[] and copy growth
+void VectorBench();
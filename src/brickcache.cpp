@@ -0,0 +1,198 @@
+#include "brickcache.h"
+#include <cstring>
+
+BrickCache g_BrickCache;
+
+BrickCache::BrickCache()
+{
+    m_entries = nullptr;
+    m_table = nullptr;
+    m_budget = BRICK_CACHE_DEFAULT_BUDGET;
+    m_capacity = 0;
+    m_tableMask = 0;
+    m_count = 0;
+    m_head = invalid_idx;
+    m_tail = invalid_idx;
+    resetStats();
+}
+
+BrickCache::~BrickCache()
+{
+    delete[] m_entries;
+    delete[] m_table;
+}
+
+void BrickCache::setBudget(size_t bytes)
+{
+    delete[] m_entries;
+    delete[] m_table;
+    m_entries = nullptr;
+    m_table = nullptr;
+    m_capacity = 0;
+    m_budget = bytes;
+    clear();
+}
+
+void BrickCache::allocate()
+{
+    m_capacity = u32(m_budget / sizeof(Entry));
+    Assert(m_capacity > 0);
+
+    // keep the table at most half full
+    u32 tableSize = 16;
+    while(tableSize < m_capacity * 2)
+    {
+        tableSize <<= 1;
+    }
+    m_tableMask = tableSize - 1;
+
+    m_entries = new Entry[m_capacity];
+    m_table = new u32[tableSize];
+    clear();
+}
+
+void BrickCache::clear()
+{
+    if(m_table)
+    {
+        memset(m_table, 0, sizeof(u32) * (m_tableMask + 1));
+    }
+    m_count = 0;
+    m_head = invalid_idx;
+    m_tail = invalid_idx;
+}
+
+u32 BrickCache::find(u64 key) const
+{
+    u32 pos = u32(key) & m_tableMask;
+    while(m_table[pos])
+    {
+        const u32 idx = m_table[pos] - 1;
+        if(m_entries[idx].m_key == key)
+        {
+            return idx;
+        }
+        pos = (pos + 1) & m_tableMask;
+    }
+    return invalid_idx;
+}
+
+void BrickCache::tableInsert(u64 key, u32 idx)
+{
+    u32 pos = u32(key) & m_tableMask;
+    while(m_table[pos])
+    {
+        pos = (pos + 1) & m_tableMask;
+    }
+    m_table[pos] = idx + 1;
+}
+
+void BrickCache::tableRemove(u64 key)
+{
+    u32 pos = u32(key) & m_tableMask;
+    while(m_entries[m_table[pos] - 1].m_key != key)
+    {
+        pos = (pos + 1) & m_tableMask;
+    }
+
+    // backward shift, so lookups never need tombstones
+    u32 hole = pos;
+    u32 next = (pos + 1) & m_tableMask;
+    while(m_table[next])
+    {
+        const u32 home = u32(m_entries[m_table[next] - 1].m_key) & m_tableMask;
+        const u32 distHole = (hole - home) & m_tableMask;
+        const u32 distNext = (next - home) & m_tableMask;
+        if(distHole < distNext)
+        {
+            m_table[hole] = m_table[next];
+            hole = next;
+        }
+        next = (next + 1) & m_tableMask;
+    }
+    m_table[hole] = 0;
+}
+
+void BrickCache::unlink(u32 idx)
+{
+    Entry& e = m_entries[idx];
+    if(e.m_prev != invalid_idx)
+        m_entries[e.m_prev].m_next = e.m_next;
+    else
+        m_head = e.m_next;
+
+    if(e.m_next != invalid_idx)
+        m_entries[e.m_next].m_prev = e.m_prev;
+    else
+        m_tail = e.m_prev;
+}
+
+void BrickCache::pushFront(u32 idx)
+{
+    Entry& e = m_entries[idx];
+    e.m_prev = invalid_idx;
+    e.m_next = m_head;
+    if(m_head != invalid_idx)
+        m_entries[m_head].m_prev = idx;
+    m_head = idx;
+    if(m_tail == invalid_idx)
+        m_tail = idx;
+}
+
+const float* BrickCache::get(u64 key)
+{
+    if(!m_entries)
+    {
+        ++m_misses;
+        return nullptr;
+    }
+
+    const u32 idx = find(key);
+    if(idx == invalid_idx)
+    {
+        ++m_misses;
+        return nullptr;
+    }
+
+    ++m_hits;
+    if(idx != m_head)
+    {
+        unlink(idx);
+        pushFront(idx);
+    }
+    return m_entries[idx].m_values;
+}
+
+float* BrickCache::insert(u64 key)
+{
+    if(!m_entries)
+    {
+        allocate();
+    }
+
+    u32 idx = find(key);
+    if(idx != invalid_idx)
+    {
+        unlink(idx);
+        pushFront(idx);
+        return m_entries[idx].m_values;
+    }
+
+    if(m_count < m_capacity)
+    {
+        idx = m_count++;
+    }
+    else
+    {
+        idx = m_tail;
+        unlink(idx);
+        tableRemove(m_entries[idx].m_key);
+        ++m_evictions;
+    }
+
+    m_entries[idx].m_key = key;
+    tableInsert(key, idx);
+    pushFront(idx);
+
+    return m_entries[idx].m_values;
+}
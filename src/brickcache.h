@@ -0,0 +1,71 @@
+#pragma once
+
+#include "ints.h"
+#include "asserts.h"
+#include "rasterfield.h"
+#include <cstddef>
+
+#define BRICK_VOXELS (RF_BRICK * RF_BRICK * RF_BRICK)
+#define BRICK_CACHE_DEFAULT_BUDGET (64u << 20)
+
+// Content addressed LRU cache of baked bricks.
+// Keys are hashes of the SDF subset touching a brick plus the brick transform,
+// so undo/redo and repeated sub-scenes reuse earlier bakes.
+// Not thread safe; bakes happen on the main thread.
+class BrickCache
+{
+    static constexpr u32 invalid_idx = 0xffffffff;
+
+    struct Entry
+    {
+        u64 m_key;
+        u32 m_prev;
+        u32 m_next;
+        float m_values[BRICK_VOXELS];
+    };
+
+    Entry* m_entries;
+    u32* m_table;       // entry index + 1, 0 is empty
+    size_t m_budget;
+    u32 m_capacity;
+    u32 m_tableMask;
+    u32 m_count;
+    u32 m_head;         // most recently used
+    u32 m_tail;         // least recently used
+    u64 m_hits;
+    u64 m_misses;
+    u64 m_evictions;
+
+    void allocate();
+    u32 find(u64 key) const;
+    void tableInsert(u64 key, u32 idx);
+    void tableRemove(u64 key);
+    void unlink(u32 idx);
+    void pushFront(u32 idx);
+
+public:
+    BrickCache();
+    ~BrickCache();
+    void setBudget(size_t bytes);
+    void clear();
+    void resetStats(){ m_hits = 0; m_misses = 0; m_evictions = 0; }
+
+    // returns nullptr on a miss
+    const float* get(u64 key);
+    // returns storage for BRICK_VOXELS values, evicting the least recently used brick when full
+    float* insert(u64 key);
+
+    size_t budget() const { return m_budget; }
+    u32 count() const { return m_count; }
+    u32 capacity() const { return m_capacity; }
+    u64 hits() const { return m_hits; }
+    u64 misses() const { return m_misses; }
+    u64 evictions() const { return m_evictions; }
+    float hitRate() const
+    {
+        const u64 total = m_hits + m_misses;
+        return total ? float(double(m_hits) / double(total)) : 0.0f;
+    }
+};
+
+extern BrickCache g_BrickCache;
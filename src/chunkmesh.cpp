@@ -0,0 +1,652 @@
+#include "chunkmesh.h"
+
+#if MESH_GEN_ENABLED
+
+#include "asserts.h"
+#include "parallelfor.h"
+#include "cputimer.h"
+#include "randf.h"
+#include "raycast.h"
+#include "sdfopt.h"
+#include "cpurender.h"
+#include "meshorder.h"
+#include <algorithm>
+#include <cstring>
+
+// per thread state while meshing a chunk. samples live on the chunk's half
+// cell lattice, the coarsest grid holding every corner, face and cell center.
+struct ChunkScratch
+{
+    float* values = nullptr;
+    u32* stamps = nullptr;      // values[i] is current when stamps[i] == stamp
+    u32 stamp = 0;
+    SDFIndices indices;
+    Vector<u64> keys;           // crossing edge of every triangle corner
+    Vector<vec3> points;        // and its position
+    Vector<u64> unique;
+
+    ~ChunkScratch()
+    {
+        delete[] values;
+        delete[] stamps;
+    }
+};
+
+ChunkGrid::~ChunkGrid()
+{
+    delete[] m_chunks;
+    delete[] m_scratch;
+}
+
+void ChunkGrid::init(const SDFList& sdfs, const vec3& origin, const ivec3& dims, const float chunk_size, const u32 cells)
+{
+    Assert(cells > 0 && cells <= CHUNK_MAX_CELLS && (cells & (cells - 1)) == 0);
+    delete[] m_chunks;
+    delete[] m_scratch;
+    m_scratch = nullptr;
+    m_numScratch = 0;
+
+    m_sdfs = &sdfs;
+    m_origin = origin;
+    m_dims = dims;
+    m_chunkSize = chunk_size;
+    m_cells = cells;
+    m_chunks = count() ? new Chunk[count()] : nullptr;
+}
+
+AABB ChunkGrid::bounds(const ivec3& c) const
+{
+    AABB box;
+    box.lo = m_origin + vec3(c) * m_chunkSize;
+    box.hi = box.lo + vec3(m_chunkSize);
+    return box;
+}
+
+u32 ChunkGrid::maxLod() const
+{
+    u32 lod = 0;
+    while((m_cells >> lod) > 1)
+    {
+        ++lod;
+    }
+    return lod;
+}
+
+void ChunkGrid::setLod(const ivec3& c, u32 lod)
+{
+    lod = glm::min(lod, maxLod());
+    Chunk& chunk = at(c);
+    if(chunk.lod == lod)
+        return;
+
+    chunk.lod = u8(lod);
+    for(s32 z = -1; z <= 1; ++z)
+    {
+        for(s32 y = -1; y <= 1; ++y)
+        {
+            for(s32 x = -1; x <= 1; ++x)
+            {
+                const ivec3 n = c + ivec3(x, y, z);
+                if(glm::all(glm::greaterThanEqual(n, ivec3(0))) && glm::all(glm::lessThan(n, m_dims)))
+                {
+                    at(n).dirty = true;
+                }
+            }
+        }
+    }
+}
+
+void ChunkGrid::setLods(const vec3& eye, const float lod0_distance)
+{
+    const u32 max_lod = maxLod();
+    for(s32 i = 0; i < count(); ++i)
+    {
+        const ivec3 c = coord(i);
+        const float dis = glm::distance(eye, bounds(c).center());
+        u32 lod = 0;
+        for(float d = lod0_distance; dis > d && lod < max_lod; d *= 2.0f)
+        {
+            ++lod;
+        }
+        setLod(c, lod);
+    }
+}
+
+void ChunkGrid::invalidate(const AABB& box)
+{
+    for(s32 i = 0; i < count(); ++i)
+    {
+        Chunk& chunk = m_chunks[i];
+        // a crossing edge can reach a cell past the surface it straddles
+        const float margin = cellSize(chunk.lod) * 2.0f;
+        const AABB b = bounds(coord(i));
+        if(glm::all(glm::lessThanEqual(box.lo, b.hi + margin)) && glm::all(glm::greaterThanEqual(box.hi, b.lo - margin)))
+        {
+            chunk.dirty = true;
+        }
+    }
+}
+
+void ChunkGrid::invalidate(const SDF& sdf)
+{
+    invalidate(SDFBounds(sdf));
+}
+
+s32 ChunkGrid::spacing(const ivec3& lo, const ivec3& hi) const
+{
+    const s32 C = s32(m_cells);
+    ivec3 a, b;
+    for(s32 i = 0; i < 3; ++i)
+    {
+        a[i] = b[i] = lo[i] / C;
+        // flat on a chunk boundary: shared with the chunks below it too
+        if(lo[i] == hi[i] && lo[i] % C == 0)
+        {
+            a[i] -= 1;
+        }
+        a[i] = glm::max(a[i], 0);
+        b[i] = glm::min(b[i], m_dims[i] - 1);
+    }
+
+    u32 lod = maxLod();
+    for(s32 z = a.z; z <= b.z; ++z)
+    {
+        for(s32 y = a.y; y <= b.y; ++y)
+        {
+            for(s32 x = a.x; x <= b.x; ++x)
+            {
+                lod = glm::min(lod, u32(at(ivec3(x, y, z)).lod));
+            }
+        }
+    }
+    return 1 << lod;
+}
+
+void ChunkGrid::meshChunk(const ivec3& c, ChunkScratch& scratch, const float lipschitz)
+{
+    Chunk& chunk = at(c);
+    chunk.geom.vertices.clear();
+    chunk.geom.indices.clear();
+    chunk.dirty = false;
+    ++chunk.version;
+
+    const SDFList& sdfs = *m_sdfs;
+    const s32 C = s32(m_cells);
+    const s32 s = 1 << chunk.lod;               // cell size in lod 0 cells
+    const s32 n = C / s;
+    const ivec3 base = c * C;                   // all integer coords are global
+    const s32 side = 2 * C + 1;
+    const float half = m_chunkSize / float(2 * C);
+
+    // hard unions out of reach of every cell never decide a sample's sign or
+    // a crossing, so neighbours agree on seam samples without them
+    const AABB box = bounds(c);
+    const float reach = box.cornerRadius() + cellSize(chunk.lod) * 2.0f;
+    scratch.indices.clear();
+    for(s32 i = 0; i < sdfs.count(); ++i)
+    {
+        const SDF& sdf = sdfs[i];
+        const float smax = glm::max(sdf.scale.x, glm::max(sdf.scale.y, sdf.scale.z));
+        if(sdf.blend_type != SDF_UNION || sdf.lowerBound(box.center()) * smax < reach)
+        {
+            scratch.indices.grow() = u16(i);
+        }
+    }
+    if(!scratch.indices.count())
+        return;
+
+    if(++scratch.stamp == 0)
+    {
+        memset(scratch.stamps, 0, sizeof(u32) * side * side * side);
+        scratch.stamp = 1;
+    }
+    scratch.keys.clear();
+    scratch.points.clear();
+
+    // g is on the global half cell lattice
+    auto World = [&](const ivec3& g)
+    {
+        return m_origin + vec3(g) * half;
+    };
+    auto Local = [&](const ivec3& g)
+    {
+        const ivec3 l = g - base * 2;
+        return u64(l.x) | (u64(l.y) << 10) | (u64(l.z) << 20);
+    };
+    auto Value = [&](const ivec3& g)
+    {
+        const ivec3 l = g - base * 2;
+        const s32 i = (l.z * side + l.y) * side + l.x;
+        if(scratch.stamps[i] != scratch.stamp)
+        {
+            scratch.stamps[i] = scratch.stamp;
+            scratch.values[i] = SDFDis(sdfs, scratch.indices, World(g));
+        }
+        return scratch.values[i];
+    };
+
+    auto Tet = [&](const ivec3& p0, const ivec3& p1, const ivec3& p2, const ivec3& p3)
+    {
+        const ivec3 g[4] = { p0, p1, p2, p3 };
+        float v[4];
+        s32 in[4], out[4];
+        s32 num_in = 0, num_out = 0;
+        for(s32 i = 0; i < 4; ++i)
+        {
+            v[i] = Value(g[i]);
+            if(v[i] < 0.0f)
+                in[num_in++] = i;
+            else
+                out[num_out++] = i;
+        }
+        if(!num_in || !num_out)
+            return;
+
+        // crossing edges in order around the cut
+        s32 ring[4][2];
+        s32 num = 0;
+        if(num_in == 2)
+        {
+            const s32 quad[4][2] = { { in[0], out[0] }, { in[0], out[1] }, { in[1], out[1] }, { in[1], out[0] } };
+            memcpy(ring, quad, sizeof(quad));
+            num = 4;
+        }
+        else
+        {
+            const s32 lone = num_in == 1 ? in[0] : out[0];
+            for(s32 i = 0; i < 4; ++i)
+            {
+                if(i == lone)
+                    continue;
+                ring[num][0] = lone;
+                ring[num][1] = i;
+                ++num;
+            }
+        }
+
+        // interpolate from the lower key so both sides of a seam get the same bits
+        u64 keys[4];
+        vec3 pts[4];
+        for(s32 k = 0; k < num; ++k)
+        {
+            s32 a = ring[k][0], b = ring[k][1];
+            u64 ka = Local(g[a]), kb = Local(g[b]);
+            if(ka > kb)
+            {
+                std::swap(a, b);
+                std::swap(ka, kb);
+            }
+            const vec3 wa = World(g[a]);
+            const float t = v[a] / (v[a] - v[b]);
+            pts[k] = wa + (World(g[b]) - wa) * t;
+            keys[k] = ka | (kb << 30);
+        }
+
+        const vec3 N = glm::cross(pts[1] - pts[0], pts[2] - pts[0]);
+        const bool flip = glm::dot(N, World(g[out[0]]) - World(g[in[0]])) < 0.0f;
+        const s32 tris[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+        for(s32 t = 0; t < num - 2; ++t)
+        {
+            for(s32 j = 0; j < 3; ++j)
+            {
+                const s32 k = tris[t][flip ? 2 - j : j];
+                scratch.keys.grow() = keys[k];
+                scratch.points.grow() = pts[k];
+            }
+        }
+    };
+
+    // triangulates one face of the cell at c0 and cones it to the cell center.
+    // the face is cut into squares of its own spacing; a square whose outer
+    // edge is sampled finer still is fanned from its center instead of split.
+    auto Face = [&](const ivec3& c0, const s32 axis, const s32 far_side)
+    {
+        ivec3 U(0), V(0);
+        U[(axis + 1) % 3] = 1;
+        V[(axis + 2) % 3] = 1;
+        ivec3 lo = c0;
+        lo[axis] += far_side * s;
+        const ivec3 hi = lo + (U + V) * s;
+
+        const s32 f = spacing(lo, hi);
+        const s32 e[4] =
+        {
+            spacing(lo, lo + U * s),
+            spacing(lo + U * s, hi),
+            spacing(lo + V * s, hi),
+            spacing(lo, lo + V * s)
+        };
+        const ivec3 apex = c0 * 2 + ivec3(s);
+        const s32 m = s / f;
+
+        for(s32 j = 0; j < m; ++j)
+        {
+            for(s32 i = 0; i < m; ++i)
+            {
+                const ivec3 p = lo + U * (i * f) + V * (j * f);
+                const ivec3 corners[4] = { p, p + U * f, p + (U + V) * f, p + V * f };
+                const s32 steps[4] =
+                {
+                    j == 0 ? e[0] : f,
+                    i == m - 1 ? e[1] : f,
+                    j == m - 1 ? e[2] : f,
+                    i == 0 ? e[3] : f
+                };
+
+                Array<ivec3, 4 * CHUNK_MAX_CELLS> ring;
+                for(s32 k = 0; k < 4; ++k)
+                {
+                    const ivec3 from = corners[k] * 2;
+                    const ivec3 to = corners[(k + 1) & 3] * 2;
+                    const s32 num = f / steps[k];
+                    for(s32 t = 0; t < num; ++t)
+                    {
+                        ring.grow() = from + (to - from) * t / num;
+                    }
+                }
+
+                if(ring.count() == 4)
+                {
+                    Tet(apex, ring[0], ring[1], ring[2]);
+                    Tet(apex, ring[0], ring[2], ring[3]);
+                }
+                else
+                {
+                    const ivec3 center = p * 2 + (U + V) * f;
+                    for(s32 k = 0; k < ring.count(); ++k)
+                    {
+                        Tet(apex, center, ring[k], ring[(k + 1) % ring.count()]);
+                    }
+                }
+            }
+        }
+    };
+
+    const float half_diagonal = cellSize(chunk.lod) * 0.8660254f;
+    for(s32 z = 0; z < n; ++z)
+    {
+        for(s32 y = 0; y < n; ++y)
+        {
+            for(s32 x = 0; x < n; ++x)
+            {
+                const ivec3 c0 = base + ivec3(x, y, z) * s;
+                if(glm::abs(Value(c0 * 2 + ivec3(s))) * lipschitz > half_diagonal)
+                    continue;
+
+                for(s32 axis = 0; axis < 3; ++axis)
+                {
+                    Face(c0, axis, 0);
+                    Face(c0, axis, 1);
+                }
+            }
+        }
+    }
+
+    // weld corners sharing a crossing edge
+    scratch.unique.clear();
+    for(const u64 key : scratch.keys)
+    {
+        scratch.unique.grow() = key;
+    }
+    scratch.unique.sort();
+    const s32 num_verts = s32(std::unique(scratch.unique.begin(), scratch.unique.end()) - scratch.unique.begin());
+
+    Geometry& geom = chunk.geom;
+    geom.vertices.reserve(num_verts);
+    for(s32 i = 0; i < num_verts; ++i)
+    {
+        geom.vertices.grow();
+    }
+    geom.indices.reserve(scratch.keys.count());
+    for(s32 i = 0; i < scratch.keys.count(); ++i)
+    {
+        const u32 idx = u32(std::lower_bound(scratch.unique.begin(), scratch.unique.begin() + num_verts, scratch.keys[i]) - scratch.unique.begin());
+        geom.indices.grow() = idx;
+        geom.vertices[idx].setPosition(scratch.points[i]);
+    }
+
+    for(MeshVertex& vert : geom.vertices)
+    {
+        const vec3 N = SDFNorm(sdfs, scratch.indices, vert.position);
+        const Material mat = SDFMaterial(sdfs, scratch.indices, vert.position);
+        const float ao = SDFAO(sdfs, vert.position, N);
+        vert.setNormal(N);
+        vert.setColor(mat.getColor());
+        vert.setMaterial(vec3(mat.getRoughness(), mat.getMetalness(), ao));
+    }
+    OptimizeMesh(geom);
+}
+
+u32 ChunkGrid::update(const u32 num_threads)
+{
+    Vector<s32> dirty;
+    for(s32 i = 0; i < count(); ++i)
+    {
+        if(m_chunks[i].dirty)
+        {
+            dirty.grow() = i;
+        }
+    }
+    if(!dirty.count())
+        return 0;
+
+    const u32 threads = glm::min(ResolveThreadCount(num_threads), u32(dirty.count()));
+    if(m_numScratch < threads)
+    {
+        delete[] m_scratch;
+        m_scratch = new ChunkScratch[threads];
+        m_numScratch = threads;
+        const s32 side = 2 * s32(m_cells) + 1;
+        for(u32 i = 0; i < threads; ++i)
+        {
+            m_scratch[i].values = new float[side * side * side];
+            m_scratch[i].stamps = new u32[side * side * side]();
+        }
+    }
+
+    const float lipschitz = SafeRelaxation(*m_sdfs);
+    ParallelForStealing(u32(dirty.count()), threads, [&](u32 index, u32 thread)
+    {
+        meshChunk(coord(dirty[index]), m_scratch[thread], lipschitz);
+    });
+    return u32(dirty.count());
+}
+
+// ------------------------------------------------------------------------
+
+// welds every chunk by exact position and counts edges with a single
+// triangle; a closed scene inside the grid should have none
+static s32 OpenEdges(ChunkGrid& grid)
+{
+    Vector<vec3> points;
+    for(s32 i = 0; i < grid.count(); ++i)
+    {
+        const Geometry& geom = grid.at(i).geom;
+        for(const u32 idx : geom.indices)
+        {
+            points.grow() = geom.vertices[idx].position;
+        }
+    }
+
+    auto Less = [](const vec3& a, const vec3& b)
+    {
+        if(a.x != b.x) return a.x < b.x;
+        if(a.y != b.y) return a.y < b.y;
+        return a.z < b.z;
+    };
+    Vector<vec3> sorted;
+    for(const vec3& p : points)
+    {
+        sorted.grow() = p;
+    }
+    std::sort(sorted.begin(), sorted.end(), Less);
+    const s32 num_unique = s32(std::unique(sorted.begin(), sorted.end()) - sorted.begin());
+
+    Vector<u64> edges;
+    for(s32 t = 0; t < points.count() / 3; ++t)
+    {
+        u32 ids[3];
+        for(s32 j = 0; j < 3; ++j)
+        {
+            ids[j] = u32(std::lower_bound(sorted.begin(), sorted.begin() + num_unique, points[t * 3 + j], Less) - sorted.begin());
+        }
+        if(ids[0] == ids[1] || ids[1] == ids[2] || ids[2] == ids[0])
+            continue;
+        for(s32 j = 0; j < 3; ++j)
+        {
+            const u32 a = glm::min(ids[j], ids[(j + 1) % 3]);
+            const u32 b = glm::max(ids[j], ids[(j + 1) % 3]);
+            edges.grow() = u64(a) | (u64(b) << 32);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    s32 open = 0;
+    for(s32 i = 0; i < edges.count(); )
+    {
+        s32 j = i + 1;
+        while(j < edges.count() && edges[j] == edges[i])
+        {
+            ++j;
+        }
+        open += (j - i) == 1 ? 1 : 0;
+        i = j;
+    }
+    return open;
+}
+
+static s32 TriangleCount(ChunkGrid& grid)
+{
+    s32 tris = 0;
+    for(s32 i = 0; i < grid.count(); ++i)
+    {
+        tris += grid.at(i).geom.indices.count() / 3;
+    }
+    return tris;
+}
+
+static void BenchWorld(SDFList& sdfs, ChunkGrid& grid)
+{
+    {
+        SDF& floor = sdfs.grow();
+        floor.type = SDF_BOX;
+        floor.translation = vec3(0.0f, -2.0f, 0.0f);
+        floor.scale = vec3(14.0f, 0.5f, 14.0f);
+        floor.material.setColor(vec3(0.8f));
+    }
+    for(u32 i = 0; i < 40; ++i)
+    {
+        SDF& sdf = sdfs.grow();
+        sdf.type = (i & 1) ? SDF_BOX : SDF_SPHERE;
+        sdf.translation = vec3(randf() * 24.0f - 12.0f, randf() * 2.5f - 1.5f, randf() * 24.0f - 12.0f);
+        sdf.scale = vec3(0.6f + randf() * 0.6f);
+        sdf.material.setColor(vec3(randf(), randf(), randf()));
+    }
+
+    // 32 x 8 x 32 units in 4 unit chunks, eye in a corner so all lods show up
+    grid.init(sdfs, vec3(-16.0f, -4.0f, -16.0f), ivec3(8, 2, 8), 4.0f, 32);
+    grid.setLods(vec3(-14.0f, 0.0f, -14.0f), 6.0f);
+}
+
+void ChunkMeshBench()
+{
+    SDFList sdfs;
+    ChunkGrid grid;
+    BenchWorld(sdfs, grid);
+
+    u32 lods[8] = {};
+    for(s32 i = 0; i < grid.count(); ++i)
+    {
+        ++lods[glm::min(u32(grid.at(i).lod), 7u)];
+    }
+    printf("[ChunkMesh] %d chunks, per lod: %u %u %u %u %u %u\n",
+        grid.count(), lods[0], lods[1], lods[2], lods[3], lods[4], lods[5]);
+
+    const u32 hw = ResolveThreadCount(0);
+    for(u32 t = 1; ; t = glm::min(t * 2, hw))
+    {
+        grid.invalidate(SDFListBounds(sdfs));
+        CPUTimer timer;
+        const u32 num = grid.update(t);
+        printf("[ChunkMesh] full build, %2u threads: %u chunks, %d tris, %.1f ms\n",
+            t, num, TriangleCount(grid), timer.ms());
+        if(t == hw)
+            break;
+    }
+    printf("[ChunkMesh] open edges after full build: %d\n", OpenEdges(grid));
+
+    // move one primitive around and time edit to finished meshes
+    const s32 num_edits = 32;
+    double total_ms = 0.0, max_ms = 0.0;
+    u32 total_chunks = 0;
+    for(s32 i = 0; i < num_edits; ++i)
+    {
+        SDF& sdf = sdfs[1 + (i % (sdfs.count() - 1))];
+        CPUTimer timer;
+        grid.invalidate(sdf);
+        sdf.translation += vec3(randf() - 0.5f, 0.0f, randf() - 0.5f);
+        grid.invalidate(sdf);
+        total_chunks += grid.update();
+        const double ms = timer.ms();
+        total_ms += ms;
+        max_ms = glm::max(max_ms, ms);
+    }
+    printf("[ChunkMesh] %d edits: %.2f ms average, %.2f ms worst, %.1f chunks remeshed per edit\n",
+        num_edits, total_ms / num_edits, max_ms, total_chunks / float(num_edits));
+    printf("[ChunkMesh] open edges after edits: %d\n", OpenEdges(grid));
+
+    // walk the eye across so lods shift under existing meshes
+    CPUTimer timer;
+    grid.setLods(vec3(10.0f, 0.0f, 6.0f), 6.0f);
+    const u32 num = grid.update();
+    printf("[ChunkMesh] lod shift: %u chunks in %.1f ms, open edges: %d\n", num, timer.ms(), OpenEdges(grid));
+}
+
+void ChunkPackBench()
+{
+    SDFList sdfs;
+    ChunkGrid grid;
+    BenchWorld(sdfs, grid);
+    grid.update();
+
+    const vec3 eye = vec3(-14.0f, 2.0f, -14.0f);
+    const CPUSun sun;
+    Vector<PackedVertex> packed;
+    s32 num_verts = 0;
+    float pos_err = 0.0f, normal_err = 0.0f, color_err = 0.0f, shade_err = 0.0f;
+    for(s32 i = 0; i < grid.count(); ++i)
+    {
+        Geometry& geom = grid.at(i).geom;
+        const AABB box = grid.bounds(grid.coord(i));
+        const vec3 extent = PackExtent(box);
+        PackGeometry(geom, box, packed);
+        for(s32 j = 0; j < packed.count(); ++j)
+        {
+            MeshVertex& v = geom.vertices[j];
+            vec3 P, N, C, M;
+            UnpackVertex(packed[j], box.lo, extent, P, N, C, M);
+            pos_err = glm::max(pos_err, glm::length(P - v.position));
+            normal_err = glm::max(normal_err, glm::degrees(glm::acos(glm::min(glm::dot(N, v.normal), 1.0f))));
+            color_err = glm::max(color_err, glm::max(glm::length(C - v.color), glm::length(M - v.material)));
+
+            const vec3 V = glm::normalize(eye - v.position);
+            const vec3 a = CPUShade(V, v.normal, v.color, v.material.x, v.material.y, sun);
+            const vec3 b = CPUShade(V, N, C, M.x, M.y, sun);
+            const vec3 d = glm::abs(a - b) * 255.0f;
+            shade_err = glm::max(shade_err, glm::max(d.x, glm::max(d.y, d.z)));
+
+            // decoded positions replace the originals for the seam check
+            v.position = P;
+        }
+        num_verts += packed.count();
+    }
+
+    printf("[ChunkPack] %d vertices: %d KB as MeshVertex, %d KB packed (%.1fx)\n",
+        num_verts, s32(num_verts * sizeof(MeshVertex) / 1024), s32(num_verts * sizeof(PackedVertex) / 1024),
+        float(sizeof(MeshVertex)) / float(sizeof(PackedVertex)));
+    printf("[ChunkPack] max error: position %.6f (%.4f lod 0 cells), normal %.4f deg, color %.4f, shading %.3f / 255\n",
+        pos_err, pos_err / grid.cellSize(0), normal_err, color_err, shade_err);
+    printf("[ChunkPack] open edges after decoding: %d\n", OpenEdges(grid));
+}
+
+#endif // MESH_GEN_ENABLED
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "meshgen.h"
+
+#if MESH_GEN_ENABLED
+
+#include "aabb.h"
+
+// Large worlds meshed as a grid of cubic chunks, each owning an indexed
+// Geometry at its own power of two LOD, so chunks mesh in parallel and an
+// edit only rebuilds the chunks it touches.
+// Every cell is split into tetrahedra by coning its center to its triangulated
+// faces. A face or edge on a chunk boundary is sampled at the spacing of the
+// finest chunk touching it, which turns the coarse side's border cells into
+// transition cells. Since that split depends only on the chunks around the
+// face, both sides cut the same triangles and seams stay closed at any LOD
+// difference, after edits and LOD changes alike.
+
+#define CHUNK_MAX_CELLS 64
+
+struct Chunk
+{
+    Geometry geom;              // OptimizeMesh order
+    u32 version = 0;            // bumped whenever geom is rebuilt
+    u8 lod = 0;                 // ChunkGrid::m_cells >> lod cells per side
+    bool dirty = true;
+};
+
+struct ChunkScratch;
+
+class ChunkGrid
+{
+    const SDFList* m_sdfs = nullptr;
+    Chunk* m_chunks = nullptr;
+    ChunkScratch* m_scratch = nullptr;
+    u32 m_numScratch = 0;
+
+    void meshChunk(const ivec3& c, ChunkScratch& scratch, const float lipschitz);
+public:
+    vec3 m_origin = vec3(0.0f);
+    ivec3 m_dims = ivec3(0);
+    float m_chunkSize = 1.0f;   // world units per chunk side
+    u32 m_cells = 32;           // cells per chunk side at lod 0, a power of two
+
+    ChunkGrid(){}
+    ~ChunkGrid();
+    ChunkGrid(const ChunkGrid&) = delete;
+    ChunkGrid& operator=(const ChunkGrid&) = delete;
+
+    // the list is referenced, not copied; call invalidate after editing it
+    void init(const SDFList& sdfs, const vec3& origin, const ivec3& dims, const float chunk_size, const u32 cells);
+    s32 count() const { return m_dims.x * m_dims.y * m_dims.z; }
+    Chunk& at(const ivec3& c){ return m_chunks[(c.z * m_dims.y + c.y) * m_dims.x + c.x]; }
+    const Chunk& at(const ivec3& c) const { return m_chunks[(c.z * m_dims.y + c.y) * m_dims.x + c.x]; }
+    Chunk& at(const s32 i){ return m_chunks[i]; }
+    ivec3 coord(const s32 i) const { return ivec3(i % m_dims.x, (i / m_dims.x) % m_dims.y, i / (m_dims.x * m_dims.y)); }
+    AABB bounds(const ivec3& c) const;
+    u32 maxLod() const;
+    float cellSize(const u32 lod) const { return m_chunkSize / float(m_cells >> lod); }
+
+    // a lod change also dirties the 26 neighbours, whose seams depend on it
+    void setLod(const ivec3& c, u32 lod);
+    // lod 0 within lod0_distance of eye, one level coarser every doubling after
+    void setLods(const vec3& eye, const float lod0_distance);
+    // marks every chunk whose samples could see a change inside box
+    void invalidate(const AABB& box);
+    void invalidate(const SDF& sdf);
+    // remeshes the dirty chunks and returns how many there were
+    u32 update(const u32 num_threads = 0);
+
+    // sample spacing, in lod 0 cells, of the face or edge spanning lo..hi
+    // (lod 0 cell units, lo == hi along its flat axes)
+    s32 spacing(const ivec3& lo, const ivec3& hi) const;
+};
+
+// full build, edit to new mesh latency and seam check on a multi lod world
+void ChunkMeshBench();
+// PackedVertex error per attribute and shading over the same world, and the
+// seam check again on the decoded positions
+void ChunkPackBench();
+
+#endif // MESH_GEN_ENABLED
@@ -0,0 +1,225 @@
+#include "cpurender.h"
+#include "parallelfor.h"
+#include "lodepng.h"
+#include "randf.h"
+#include "cputimer.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdio>
+
+// ------------------------------------------------------------------------
+// ports of fwdFrag.glsl
+
+static float DisGGX(const vec3& N, const vec3& H, const float roughness)
+{
+    const float a = roughness * roughness;
+    const float a2 = a * a;
+    const float NdH = glm::max(glm::dot(N, H), 0.0f);
+    const float NdH2 = NdH * NdH;
+
+    const float nom = a2;
+    const float denom_term = (NdH2 * (a2 - 1.0f) + 1.0f);
+    const float denom = 3.141592f * denom_term * denom_term;
+
+    return nom / denom;
+}
+
+static float GeomSchlickGGX(const float NdV, const float roughness)
+{
+    const float r = (roughness + 1.0f);
+    const float k = (r * r) / 8.0f;
+
+    const float nom = NdV;
+    const float denom = NdV * (1.0f - k) + k;
+
+    return nom / denom;
+}
+
+static float GeomSmith(const vec3& N, const vec3& V, const vec3& L, const float roughness)
+{
+    const float NdV = glm::max(glm::dot(N, V), 0.0f);
+    const float NdL = glm::max(glm::dot(N, L), 0.0f);
+    const float ggx2 = GeomSchlickGGX(NdV, roughness);
+    const float ggx1 = GeomSchlickGGX(NdL, roughness);
+
+    return ggx1 * ggx2;
+}
+
+static vec3 fresnelSchlick(const float cosTheta, const vec3& F0)
+{
+    return F0 + (vec3(1.0f) - F0) * glm::pow(1.0f - cosTheta, 5.0f);
+}
+
+static vec3 pbr_lighting(const vec3& V, const vec3& L, const vec3& N, const vec3& albedo,
+    const float roughness, const float metalness, const vec3& radiance)
+{
+    const float NdL = glm::max(0.0f, glm::dot(N, L));
+    const vec3 F0 = glm::mix(vec3(0.04f), albedo, metalness);
+    const vec3 H = glm::normalize(V + L);
+
+    const float NDF = DisGGX(N, H, roughness);
+    const float G = GeomSmith(N, V, L, roughness);
+    const vec3 F = fresnelSchlick(glm::max(glm::dot(H, V), 0.0f), F0);
+
+    const vec3 nom = NDF * G * F;
+    const float denom = 4.0f * glm::max(glm::dot(N, V), 0.0f) * NdL + 0.001f;
+    const vec3 specular = nom / denom;
+
+    const vec3 kS = F;
+    const vec3 kD = (vec3(1.0f) - kS) * (1.0f - metalness);
+
+    return (kD * albedo / 3.141592f + specular) * radiance * NdL;
+}
+
+vec3 CPUShade(const vec3& V, const vec3& N, const vec3& albedo, const float roughness,
+    const float metalness, const CPUSun& sun)
+{
+    const vec3 L = glm::normalize(sun.direction);
+    const vec3 color = pbr_lighting(V, L, N, albedo, roughness, metalness, sun.color * sun.intensity);
+    return glm::clamp(color / (color + vec3(1.0f)), vec3(0.0f), vec3(1.0f));
+}
+
+// ------------------------------------------------------------------------
+
+u32 CPUTileCount(const CPURenderParams& params)
+{
+    const u32 tx = (params.width + params.tile_size - 1) / params.tile_size;
+    const u32 ty = (params.height + params.tile_size - 1) / params.tile_size;
+    return tx * ty;
+}
+
+CPUTile CPUTileRect(const CPURenderParams& params, const u32 index)
+{
+    const u32 tx = (params.width + params.tile_size - 1) / params.tile_size;
+    CPUTile tile;
+    tile.x = (index % tx) * params.tile_size;
+    tile.y = (index / tx) * params.tile_size;
+    tile.width = glm::min(params.tile_size, params.width - tile.x);
+    tile.height = glm::min(params.tile_size, params.height - tile.y);
+    return tile;
+}
+
+void CPURenderTile(const SDFList& sdfs, const vec3& eye, const mat4& IVP, const CPUSun& sun,
+    const CPURenderParams& params, const CPUTile& tile, u8* rgba, const u32 stride)
+{
+    const u32 count = tile.width * tile.height;
+    Ray* rays = new Ray[count];
+    RayHit* hits = new RayHit[count];
+
+    // row 0 is the top of the image, as lodepng expects
+    for(u32 y = 0; y < tile.height; ++y)
+    {
+        for(u32 x = 0; x < tile.width; ++x)
+        {
+            const float ndcx = (float(tile.x + x) + 0.5f) / float(params.width) * 2.0f - 1.0f;
+            const float ndcy = 1.0f - (float(tile.y + y) + 0.5f) / float(params.height) * 2.0f;
+            vec4 far = IVP * vec4(ndcx, ndcy, 1.0f, 1.0f);
+            far /= far.w;
+
+            Ray& ray = rays[y * tile.width + x];
+            ray.origin = eye;
+            ray.direction = glm::normalize(vec3(far) - eye);
+            ray.tmax = glm::length(vec3(far) - eye);
+        }
+    }
+
+    RayCastParams trace = params.trace;
+    trace.num_threads = 1;
+    trace.relaxation = glm::min(trace.relaxation, SafeRelaxation(sdfs));
+    RayCast(sdfs, rays, hits, count, trace);
+
+    const vec3 albedo = vec3(0.7f, 0.1f, 0.2f);
+    const float roughness = 0.25f;
+    const float metalness = 0.001f;
+
+    for(u32 y = 0; y < tile.height; ++y)
+    {
+        u8* row = rgba + y * stride;
+        for(u32 x = 0; x < tile.width; ++x)
+        {
+            const RayHit& hit = hits[y * tile.width + x];
+            vec3 color = vec3(0.0f);
+            if(hit.hit)
+            {
+                color = CPUShade(-rays[y * tile.width + x].direction, hit.normal, albedo, roughness, metalness, sun);
+            }
+            row[x * 4 + 0] = u8(color.x * 255.0f + 0.5f);
+            row[x * 4 + 1] = u8(color.y * 255.0f + 0.5f);
+            row[x * 4 + 2] = u8(color.z * 255.0f + 0.5f);
+            row[x * 4 + 3] = 255;
+        }
+    }
+
+    delete[] rays;
+    delete[] hits;
+}
+
+void CPURender(const SDFList& sdfs, const vec3& eye, const mat4& VP, const CPUSun& sun,
+    const CPURenderParams& params, u8* rgba)
+{
+    const mat4 IVP = glm::inverse(VP);
+    const u32 stride = params.width * 4;
+    ParallelForStealing(CPUTileCount(params), params.num_threads, [&](u32 index, u32)
+    {
+        const CPUTile tile = CPUTileRect(params, index);
+        CPURenderTile(sdfs, eye, IVP, sun, params, tile, rgba + tile.y * stride + tile.x * 4, stride);
+    });
+}
+
+bool CPURenderPNG(const SDFList& sdfs, const vec3& eye, const mat4& VP, const CPUSun& sun,
+    const CPURenderParams& params, const char* filename)
+{
+    u8* rgba = new u8[params.width * params.height * 4];
+    CPURender(sdfs, eye, VP, sun, params, rgba);
+    const unsigned error = lodepng_encode32_file(filename, rgba, params.width, params.height);
+    delete[] rgba;
+    if(error)
+    {
+        printf("[CPURender] failed to write %s: %s\n", filename, lodepng_error_text(error));
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------
+
+void CPURenderBench()
+{
+    SDFList sdfs;
+    {
+        SDF& floor = sdfs.grow();
+        floor.type = SDF_BOX;
+        floor.translation = vec3(0.0f, -1.5f, 0.0f);
+        floor.scale = vec3(4.0f, 0.25f, 4.0f);
+    }
+    for(u32 i = 0; i < 15; ++i)
+    {
+        SDF& sdf = sdfs.grow();
+        sdf.type = (i & 1) ? SDF_BOX : SDF_SPHERE;
+        sdf.translation = vec3(randf() * 3.0f - 1.5f, randf() * 2.0f - 1.0f, randf() * 3.0f - 1.5f);
+        sdf.scale = vec3(0.2f + randf() * 0.3f);
+    }
+
+    CPURenderParams params;
+    params.width = 640;
+    params.height = 360;
+    const vec3 eye = vec3(0.0f, 0.5f, 4.0f);
+    const mat4 VP = glm::perspective(glm::radians(90.0f), float(params.width) / float(params.height), 0.1f, 100.0f)
+        * glm::lookAt(eye, vec3(0.0f), vec3(0.0f, 1.0f, 0.0f));
+    const CPUSun sun;
+    u8* rgba = new u8[params.width * params.height * 4];
+
+    const u32 hw = ResolveThreadCount(0);
+    for(u32 t = 1; ; t = glm::min(t * 2, hw))
+    {
+        params.num_threads = t;
+        CPUTimer timer;
+        CPURender(sdfs, eye, VP, sun, params, rgba);
+        const double secs = timer.seconds();
+        printf("[CPURender] %ux%u, %2u threads: %7.3f Mpix/s\n",
+            params.width, params.height, t, params.width * params.height / secs * 1e-6);
+        if(t == hw)
+            break;
+    }
+
+    delete[] rgba;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ints.h"
+#include "linmath.h"
+#include "sdf.h"
+#include "raycast.h"
+
+// Software reference for Renderables::fwdPass: sphere traces the scene's SDFs
+// and shades hits with the same pbr_lighting and sun as fwdFrag.glsl, without
+// the dither noise, so GL output can be diffed against it on GPU-less machines.
+
+#define CPU_TILE_SIZE 32
+
+// defaults match the sun set up in Renderables::init
+struct CPUSun
+{
+    vec3 direction = glm::normalize(vec3(1.0f, 1.0f, 1.0f));
+    vec3 color = vec3(1.0f, 0.75f, 0.5f);
+    float intensity = 10.0f;
+};
+
+struct CPURenderParams
+{
+    u32 width = 1280;
+    u32 height = 720;
+    u32 tile_size = CPU_TILE_SIZE;
+    u32 num_threads = 0;            // 0 picks std::thread::hardware_concurrency()
+    RayCastParams trace;            // relaxation is capped to SafeRelaxation of the scene
+};
+
+struct CPUTile
+{
+    u32 x, y, width, height;
+};
+
+// fwdFrag's pbr_lighting for one surface sample, tonemapped to [0, 1]
+vec3 CPUShade(const vec3& V, const vec3& N, const vec3& albedo, const float roughness,
+    const float metalness, const CPUSun& sun);
+
+u32 CPUTileCount(const CPURenderParams& params);
+CPUTile CPUTileRect(const CPURenderParams& params, const u32 index);
+
+// rgba8 pixels for one tile, written row by row at rgba with the given row stride in bytes
+void CPURenderTile(const SDFList& sdfs, const vec3& eye, const mat4& IVP, const CPUSun& sun,
+    const CPURenderParams& params, const CPUTile& tile, u8* rgba, const u32 stride);
+
+// whole image into width * height * 4 bytes, tiles spread over a work stealing pool
+void CPURender(const SDFList& sdfs, const vec3& eye, const mat4& VP, const CPUSun& sun,
+    const CPURenderParams& params, u8* rgba);
+bool CPURenderPNG(const SDFList& sdfs, const vec3& eye, const mat4& VP, const CPUSun& sun,
+    const CPURenderParams& params, const char* filename);
+
+void CPURenderBench();
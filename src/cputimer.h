@@ -0,0 +1,24 @@
+#pragma once
+
+#include <chrono>
+
+// wall clock timer for cpu side measurements; see timer.h for gpu queries
+struct CPUTimer
+{
+    std::chrono::high_resolution_clock::time_point m_begin;
+
+    CPUTimer(){ begin(); }
+    void begin()
+    {
+        m_begin = std::chrono::high_resolution_clock::now();
+    }
+    double seconds() const
+    {
+        const auto now = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double>(now - m_begin).count();
+    }
+    double ms() const
+    {
+        return seconds() * 1000.0;
+    }
+};
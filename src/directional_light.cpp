@@ -33,11 +33,11 @@ void DirectionalLight::deinit()
 
 void DirectionalLight::bind(GLProgram& prog, int channel)
 {
-    prog.setUniform("sunDirection", m_direction);
-    prog.setUniform("sunColor", m_color);
-    prog.setUniformFloat("sunIntensity", m_intensity);
-    prog.setUniform("sunMatrix", m_matrix);
-    prog.bindTexture(channel, m_tex, "sunDepth");
+    prog.setUniform(HS("sunDirection"), m_direction);
+    prog.setUniform(HS("sunColor"), m_color);
+    prog.setUniformFloat(HS("sunIntensity"), m_intensity);
+    prog.setUniform(HS("sunMatrix"), m_matrix);
+    prog.bindTexture(channel, m_tex, HS("sunDepth"));
 }
 
 void DirectionalLight::drawInto(const Camera& cam)
@@ -46,9 +46,9 @@ void GBuffer::draw(const Camera& cam, u32 dflag, u32 target)
 {
     ProfilerEvent("GBuffer::draw");
 
-    static const int seed_loc = prog.getUniformLocation("seed");
-    static const int eye_loc = prog.getUniformLocation("eye");
-    static const int draw_flag_loc = prog.getUniformLocation("draw_flags");
+    static const int seed_loc = prog.getUniformLocation(HS("seed"));
+    static const int eye_loc = prog.getUniformLocation(HS("eye"));
+    static const int draw_flag_loc = prog.getUniformLocation(HS("draw_flags"));
 
     const mat4 VP = cam.getVP();
     const mat4 IVP = glm::inverse(VP);
@@ -72,22 +72,22 @@ void GBuffer::draw(const Camera& cam, u32 dflag, u32 target)
         DepthContext dfctx(GL_ALWAYS);
         prog.bind();
     
-        prog.bindTexture(0, m_framebuffer.m_attachments[0], "positionSampler");
-        prog.bindTexture(1, m_framebuffer.m_attachments[1], "normalSampler");
-        prog.bindTexture(2, m_framebuffer.m_attachments[2], "albedoSampler");
+        prog.bindTexture(0, m_framebuffer.m_attachments[0], HS("positionSampler"));
+        prog.bindTexture(1, m_framebuffer.m_attachments[1], HS("normalSampler"));
+        prog.bindTexture(2, m_framebuffer.m_attachments[2], HS("albedoSampler"));
 
         if(dflag != DF_DIRECT_CUBEMAP)
-            prog.bindCubemap(5, cmap.color_cubemap, "env_cm");
+            prog.bindCubemap(5, cmap.color_cubemap, HS("env_cm"));
         else
-            prog.bindCubemap(5, 0, "env_cm");
+            prog.bindCubemap(5, 0, HS("env_cm"));
         
         g_Renderables.bindSun(prog);
         prog.setUniformInt(seed_loc, rand());
         prog.setUniform(eye_loc, eye);
         prog.setUniformInt(draw_flag_loc, dflag);
-        prog.setUniform("render_resolution", glm::vec2(float(width), float(height)));
-        prog.setUniform("IVP", IVP);
-        prog.setUniform("sunNearFar", glm::vec2(
+        prog.setUniform(HS("render_resolution"), glm::vec2(float(width), float(height)));
+        prog.setUniform(HS("IVP"), IVP);
+        prog.setUniform(HS("sunNearFar"), glm::vec2(
             g_Renderables.m_light.m_near,
             g_Renderables.m_light.m_far
         ));
@@ -105,8 +105,8 @@ void GBuffer::draw(const Camera& cam, u32 dflag, u32 target)
         DepthContext dfctx(GL_ALWAYS);
     
         postProg.bind();
-        postProg.bindTexture(0, curBuf.m_attachments[0], "curColor");
-        postProg.setUniformInt("seed", rand());
+        postProg.bindTexture(0, curBuf.m_attachments[0], HS("curColor"));
+        postProg.setUniformInt(HS("seed"), rand());
     
         glTextureBarrier(); DebugGL();
         GLScreen::draw();
@@ -5,14 +5,18 @@
 #include "shader.h"
 #include "loadfile.h"
 #include "debugmacro.h"
+#include "hash.h"
+#include "cputimer.h"
 #include "glm/gtc/type_ptr.hpp"
 #include "stdio.h"
+#include <cstring>
 
 void GLProgram::init(){
     m_id = glCreateProgram();  DebugGL();;
 }
 
 void GLProgram::deinit(){
+    freeReflection();
     glDeleteProgram(m_id); DebugGL();;
 }
 
@@ -46,26 +50,179 @@ void GLProgram::link(){
         log[loglen] = 0;
         puts(log);
         delete[] log;
+        return;
     }
+    reflect();
 }
 
-void GLProgram::bind(){
-    glUseProgram(m_id);  DebugGL();;
+// sampler and image types the renderer binds; their value is a unit
+static bool IsSamplerType(const u32 type)
+{
+    switch(type)
+    {
+        case GL_SAMPLER_1D:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_MULTISAMPLE:
+        case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_CUBE_MAP_ARRAY:
+        case GL_SAMPLER_BUFFER:
+        case GL_INT_SAMPLER_2D:
+        case GL_INT_SAMPLER_3D:
+        case GL_UNSIGNED_INT_SAMPLER_2D:
+        case GL_UNSIGNED_INT_SAMPLER_3D:
+        case GL_IMAGE_2D:
+        case GL_IMAGE_3D:
+        case GL_IMAGE_CUBE:
+        case GL_IMAGE_2D_ARRAY:
+        case GL_INT_IMAGE_2D:
+        case GL_INT_IMAGE_3D:
+        case GL_UNSIGNED_INT_IMAGE_2D:
+        case GL_UNSIGNED_INT_IMAGE_3D:
+            return true;
+    }
+    return false;
+}
+
+// hashes and registers a resource name, dropping the "[0]" arrays report
+static u32 HashResourceName(char* name, s32 len)
+{
+    if(len > 3 && strcmp(name + len - 3, "[0]") == 0)
+    {
+        name[len - 3] = 0;
+    }
+    return HashString::add(fnv(name), name);
+}
+
+static inline u32 ResourceSlot(const u32 hash, const u32 seed, const u32 mask)
+{
+    return FlatHash(hash ^ seed) & mask;
+}
+
+void GLProgram::freeReflection(){
+    delete[] m_resources;
+    delete[] m_table;
+    m_resources = nullptr;
+    m_table = nullptr;
+    m_numResources = 0;
+    m_tableMask = 0;
+    m_seed = 0;
 }
 
-s32 GLProgram::getUniformLocation(HashString hash){
-    s32* pLoc = locations[hash.m_hash];
-    if(!pLoc){
-        const char* loc_str = hash.str();
-        Assert(loc_str);
-        locations.insert(hash.m_hash, glGetUniformLocation(m_id, loc_str));
-        pLoc = locations[hash.m_hash];
-        if(*pLoc == -1){
-            printf("[GLProgram] Invalid uniform detected: %s\n", loc_str);
-            //Assert(false);
+void GLProgram::reflect(){
+    freeReflection();
+
+    s32 numUniforms = 0, numBlocks = 0, numStorage = 0, maxLen = 0, len = 0;
+    glGetProgramInterfaceiv(m_id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &numUniforms);  DebugGL();;
+    glGetProgramInterfaceiv(m_id, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &numBlocks);  DebugGL();;
+    glGetProgramInterfaceiv(m_id, GL_SHADER_STORAGE_BLOCK, GL_ACTIVE_RESOURCES, &numStorage);  DebugGL();;
+    glGetProgramInterfaceiv(m_id, GL_UNIFORM, GL_MAX_NAME_LENGTH, &len);  DebugGL();;
+    maxLen = glm::max(maxLen, len);
+    glGetProgramInterfaceiv(m_id, GL_UNIFORM_BLOCK, GL_MAX_NAME_LENGTH, &len);  DebugGL();;
+    maxLen = glm::max(maxLen, len);
+    glGetProgramInterfaceiv(m_id, GL_SHADER_STORAGE_BLOCK, GL_MAX_NAME_LENGTH, &len);  DebugGL();;
+    maxLen = glm::max(maxLen, len);
+
+    m_resources = new GLResource[numUniforms + numBlocks + numStorage];
+    char* name = new char[maxLen + 1];
+
+    // block members are set through their buffer, not by location
+    for(s32 i = 0; i < numUniforms; ++i){
+        static const u32 props[] = { GL_BLOCK_INDEX, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE };
+        s32 values[4];
+        glGetProgramResourceiv(m_id, GL_UNIFORM, i, 4, props, 4, nullptr, values);  DebugGL();;
+        if(values[0] != -1)
+            continue;
+        glGetProgramResourceName(m_id, GL_UNIFORM, i, maxLen + 1, &len, name);  DebugGL();;
+        GLResource& r = m_resources[m_numResources++];
+        r.m_hash = HashResourceName(name, len);
+        r.m_type = u32(values[1]);
+        r.m_location = values[2];
+        r.m_count = values[3];
+        r.m_binding = -1;
+        if(IsSamplerType(r.m_type)){
+            glGetUniformiv(m_id, r.m_location, &r.m_binding);  DebugGL();;
         }
     }
-    return *pLoc;
+    const u32 blockTypes[] = { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK };
+    const s32 blockCounts[] = { numBlocks, numStorage };
+    for(s32 b = 0; b < 2; ++b){
+        for(s32 i = 0; i < blockCounts[b]; ++i){
+            static const u32 props[] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+            s32 values[2];
+            glGetProgramResourceiv(m_id, blockTypes[b], i, 2, props, 2, nullptr, values);  DebugGL();;
+            glGetProgramResourceName(m_id, blockTypes[b], i, maxLen + 1, &len, name);  DebugGL();;
+            GLResource& r = m_resources[m_numResources++];
+            r.m_hash = HashResourceName(name, len);
+            r.m_type = blockTypes[b];
+            r.m_location = i;
+            r.m_binding = values[0];
+            r.m_count = values[1];
+        }
+    }
+    delete[] name;
+
+    // Perfect hash: try seeds until every name lands in its own slot,
+    // doubling the table every 64 failures. Programs here have a few dozen
+    // resources, so the table stays within a few KB.
+    Assert(m_numResources < 0xffff);
+    u32 size = 1;
+    while(size < m_numResources * 2){
+        size <<= 1;
+    }
+    for(u32 attempt = 0; ; ++attempt){
+        if(attempt && (attempt & 63) == 0){
+            size <<= 1;
+        }
+        delete[] m_table;
+        m_table = new u16[size];
+        memset(m_table, 0, sizeof(u16) * size);
+        m_tableMask = size - 1;
+        m_seed = attempt * 0x9e3779b9u;
+
+        bool placed = true;
+        for(u32 i = 0; i < m_numResources && placed; ++i){
+            u16& slot = m_table[ResourceSlot(m_resources[i].m_hash, m_seed, m_tableMask)];
+            if(!slot){
+                slot = u16(i + 1);
+            }
+            else if(m_resources[slot - 1].m_hash == m_resources[i].m_hash){
+                // two names with one hash, or a uniform sharing a block's name
+                printf("[GLProgram] %s hashes like another resource, skipped\n", HashString(m_resources[i].m_hash).str());
+                m_resources[i--] = m_resources[--m_numResources];
+            }
+            else{
+                placed = false;
+            }
+        }
+        if(placed)
+            break;
+    }
+}
+
+const GLResource* GLProgram::find(HashString name) const{
+    if(!m_table)
+        return nullptr;
+    const u16 i = m_table[ResourceSlot(name.m_hash, m_seed, m_tableMask)];
+    return i && m_resources[i - 1].m_hash == name.m_hash ? m_resources + (i - 1) : nullptr;
+}
+
+void GLProgram::bind(){
+    glUseProgram(m_id);  DebugGL();;
+}
+
+s32 GLProgram::getUniformLocation(HashString hash) const{
+    const GLResource* r = find(hash);
+    return r && r->m_type != GL_UNIFORM_BLOCK && r->m_type != GL_SHADER_STORAGE_BLOCK ? r->m_location : -1;
+}
+
+s32 GLProgram::getBlockBinding(HashString hash) const{
+    const GLResource* r = find(hash);
+    return r && (r->m_type == GL_UNIFORM_BLOCK || r->m_type == GL_SHADER_STORAGE_BLOCK) ? r->m_binding : -1;
 }
 
 void GLProgram::setUniform(s32 location, const glm::vec2& v){
@@ -122,23 +279,134 @@ void GLProgram::setup(const char** filenames, s32 count){
     }
 }
 
-void GLProgram::bindTexture(s32 channel, s32 texture, const char* name)
+void GLProgram::bindTexture(s32 channel, s32 texture, HashString name)
 {
     glActiveTexture(GL_TEXTURE0 + channel);  DebugGL();
     glBindTexture(GL_TEXTURE_2D, texture);  DebugGL();
     setUniformInt(name, channel);
 }
 
-void GLProgram::bindCubemap(s32 channel, s32 texture, const char* name)
+void GLProgram::bindCubemap(s32 channel, s32 texture, HashString name)
 {
     glActiveTexture(GL_TEXTURE0 + channel);  DebugGL();
     glBindTexture(GL_TEXTURE_CUBE_MAP, texture);  DebugGL();
     setUniformInt(name, channel);
 }
 
-void GLProgram::bind3DTexture(s32 channel, s32 texture, const char* name)
+void GLProgram::bind3DTexture(s32 channel, s32 texture, HashString name)
 {
     glActiveTexture(GL_TEXTURE0 + channel);  DebugGL();
     glBindTexture(GL_TEXTURE_3D, texture);  DebugGL();
     setUniformInt(name, channel);
-}
\ No newline at end of file
+}
+
+// ------------------------------------------------------------------------
+
+static const char* ReflectVert =
+    "#version 430 core\n"
+    "layout(location = 0) in vec3 position;\n"
+    "uniform mat4 MVP;\n"
+    "uniform mat3 normalMatrix;\n"
+    "uniform vec3 eye;\n"
+    "uniform float time;\n"
+    "out vec3 fragPos;\n"
+    "void main(){\n"
+    "    fragPos = normalMatrix * position + eye * time;\n"
+    "    gl_Position = MVP * vec4(position, 1.0);\n"
+    "}\n";
+
+static const char* ReflectFrag =
+    "#version 430 core\n"
+    "in vec3 fragPos;\n"
+    "out vec4 outColor;\n"
+    "layout(binding = 1) uniform sampler2D albedoSampler;\n"
+    "layout(binding = 2) uniform sampler2D normalSampler;\n"
+    "layout(binding = 5) uniform samplerCube env_cm;\n"
+    "layout(binding = 6) uniform sampler3D distance_field;\n"
+    "uniform vec4 palette[4];\n"
+    "uniform vec2 render_resolution;\n"
+    "uniform int draw_flags;\n"
+    "uniform int seed;\n"
+    "layout(std140, binding = 3) uniform LightBlock{ vec4 sunDirection; vec4 sunColor; };\n"
+    "layout(std430, binding = 4) buffer HitBuffer{ uint hits[]; };\n"
+    "void main(){\n"
+    "    vec2 uv = gl_FragCoord.xy / render_resolution;\n"
+    "    vec4 c = texture(albedoSampler, uv) + texture(normalSampler, uv) + texture(env_cm, fragPos);\n"
+    "    c += texture(distance_field, fragPos) + palette[(draw_flags + seed) & 3] + sunDirection * sunColor;\n"
+    "    hits[0] = uint(c.x);\n"
+    "    outColor = c;\n"
+    "}\n";
+
+bool GLProgramReflectionCheck(){
+    GLProgram prog;
+    prog.init();
+    const u32 vert = createShader(ReflectVert, GL_VERTEX_SHADER);
+    const u32 frag = createShader(ReflectFrag, GL_FRAGMENT_SHADER);
+    prog.addShader(vert);
+    prog.addShader(frag);
+    prog.link();
+    prog.freeShader(vert);
+    prog.freeShader(frag);
+
+    struct Expected{ HashString name; u32 type; s32 binding; s32 count; };
+    const Expected expected[] = {
+        { HS("MVP"), GL_FLOAT_MAT4, -1, 1 },
+        { HS("normalMatrix"), GL_FLOAT_MAT3, -1, 1 },
+        { HS("eye"), GL_FLOAT_VEC3, -1, 1 },
+        { HS("time"), GL_FLOAT, -1, 1 },
+        { HS("albedoSampler"), GL_SAMPLER_2D, 1, 1 },
+        { HS("normalSampler"), GL_SAMPLER_2D, 2, 1 },
+        { HS("env_cm"), GL_SAMPLER_CUBE, 5, 1 },
+        { HS("distance_field"), GL_SAMPLER_3D, 6, 1 },
+        { HS("palette"), GL_FLOAT_VEC4, -1, 4 },
+        { HS("render_resolution"), GL_FLOAT_VEC2, -1, 1 },
+        { HS("draw_flags"), GL_INT, -1, 1 },
+        { HS("seed"), GL_INT, -1, 1 },
+        { HS("LightBlock"), GL_UNIFORM_BLOCK, 3, 32 },
+        { HS("HitBuffer"), GL_SHADER_STORAGE_BLOCK, 4, -1 },
+    };
+    const s32 numExpected = sizeof(expected) / sizeof(expected[0]);
+
+    bool ok = prog.m_numResources == u32(numExpected);
+    if(!ok){
+        printf("[GLProgram] reflected %u resources, expected %d\n", prog.m_numResources, numExpected);
+    }
+    for(s32 i = 0; i < numExpected; ++i){
+        const Expected& e = expected[i];
+        const GLResource* r = prog.find(e.name);
+        const bool block = e.type == GL_UNIFORM_BLOCK || e.type == GL_SHADER_STORAGE_BLOCK;
+        // a runtime sized ssbo reports the size of its fixed part, here none
+        const bool match = r && r->m_type == e.type && r->m_binding == e.binding
+            && (e.count < 0 || r->m_count == e.count)
+            && (block || r->m_location == glGetUniformLocation(prog.m_id, e.name.str()));
+        if(!match){
+            printf("[GLProgram] reflection mismatch on %s\n", e.name.str());
+            ok = false;
+        }
+    }
+    ok = ok && prog.getUniformLocation(HS("LightBlock")) == -1 && prog.getBlockBinding(HS("LightBlock")) == 3;
+    ok = ok && prog.getUniformLocation(HS("missing")) == -1 && !prog.find(HS("sunColor"));
+
+    // every frame's lookups against asking the driver by name
+    const s32 reps = 100000;
+    s32 sum = 0;
+    CPUTimer timer;
+    for(s32 rep = 0; rep < reps; ++rep){
+        for(s32 i = 0; i < numExpected; ++i){
+            sum += prog.getUniformLocation(expected[i].name);
+        }
+    }
+    const double table_ns = timer.ms() * 1e6 / (double(reps) * numExpected);
+    timer.begin();
+    for(s32 rep = 0; rep < reps / 100; ++rep){
+        for(s32 i = 0; i < numExpected; ++i){
+            sum += glGetUniformLocation(prog.m_id, expected[i].name.str());
+        }
+    }
+    const double driver_ns = timer.ms() * 1e6 / (double(reps / 100) * numExpected);
+
+    printf("[GLProgram] reflection %s: %u resources in %u slots, lookup %.1f ns, glGetUniformLocation %.1f ns (%d)\n",
+        ok ? "ok" : "FAILED", prog.m_numResources, prog.m_tableMask + 1, table_ns, driver_ns, sum);
+    prog.deinit();
+    return ok;
+}
@@ -2,12 +2,38 @@
 
 #include "ints.h"
 #include "glm/glm.hpp"
-#include "store.h"
 #include "hashstring.h"
 
+// an active uniform, sampler or buffer block of a linked program
+struct GLResource
+{
+    u32 m_hash;         // fnv of the name, without a trailing "[0]"
+    u32 m_type;         // GL_FLOAT_VEC3, GL_SAMPLER_2D, ...; GL_UNIFORM_BLOCK or GL_SHADER_STORAGE_BLOCK
+    s32 m_location;     // uniform location, block index for blocks
+    s32 m_binding;      // texture unit for samplers, binding point for blocks, else -1
+    s32 m_count;        // array size, bytes for blocks
+};
+
+// Every resource is reflected once at link time into a table indexed by a
+// perfect hash of the name hashes, so a lookup is one mix, one index and one
+// compare, with no strings and no GL calls.
 struct GLProgram{
     u32 m_id;
-    Store<s32, 8> locations;
+    GLResource* m_resources = nullptr;
+    u16* m_table = nullptr;         // index + 1 into m_resources, 0 when empty
+    u32 m_numResources = 0;
+    u32 m_tableMask = 0;
+    u32 m_seed = 0;
+
+    // owns the reflection arrays and the GL program, so copies would free
+    // both twice
+    GLProgram() = default;
+    GLProgram(const GLProgram&) = delete;
+    GLProgram& operator=(const GLProgram&) = delete;
+
+    void reflect();
+    void freeReflection();
+    const GLResource* find(HashString name) const;
     void init();
     void deinit();
     s32 addShader(const char* path, s32 type);
@@ -15,7 +41,10 @@ struct GLProgram{
     void freeShader(u32 handle);
     void link();
     void bind();
-    s32 getUniformLocation(HashString name);
+    // -1 when the program has no such uniform, which glUniform* ignores
+    s32 getUniformLocation(HashString name) const;
+    // binding point of a uniform or storage block, -1 when missing
+    s32 getBlockBinding(HashString name) const;
     void setUniform(s32 loc, const glm::vec2& v);
     void setUniform(s32 loc, const glm::vec3& v);
     void setUniform(s32 loc, const glm::vec4& v);
@@ -23,22 +52,29 @@ struct GLProgram{
     void setUniform(s32 loc, const glm::mat4& v);
     void setUniformInt(s32 loc, s32 v);
     void setUniformFloat(s32 loc, float v);
-    void bindTexture(s32 channel, s32 texture, const char* name);
-    void bindCubemap(s32 channel, s32 texture, const char* name);
-    void bind3DTexture(s32 channel, s32 texture, const char* name);
+    void bindTexture(s32 channel, s32 texture, HashString name);
+    void bindCubemap(s32 channel, s32 texture, HashString name);
+    void bind3DTexture(s32 channel, s32 texture, HashString name);
     void computeCall(s32 x=0, s32 y=0, s32 z=0);
     void setup(const char** filenames, s32 count);
+    // pass names as HS("name"); a plain string still works but hashes and
+    // registers itself on every call
     template<typename T>
-    void setUniform(const char* name, const T& t){
-        s32 loc = getUniformLocation(HashString(name));
+    void setUniform(HashString name, const T& t){
+        s32 loc = getUniformLocation(name);
         setUniform(loc, t);
     }
-    void setUniformInt(const char* name, s32 v){
-        s32 loc = getUniformLocation(HashString(name));
+    void setUniformInt(HashString name, s32 v){
+        s32 loc = getUniformLocation(name);
         setUniformInt(loc, v);
     }
-    void setUniformFloat(const char* name, float v){
-        s32 loc = getUniformLocation(HashString(name));
+    void setUniformFloat(HashString name, float v){
+        s32 loc = getUniformLocation(name);
         setUniformFloat(loc, v);
     }
 };
+
+// links a program with plain uniforms, an array, samplers and both block
+// kinds, checks the reflected table against the source and times lookups.
+// Needs a current GL 4.3+ context; llvmpipe works. Returns false on mismatch.
+bool GLProgramReflectionCheck();
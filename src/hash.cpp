@@ -0,0 +1,174 @@
+#include "hash.h"
+#include "cputimer.h"
+#include <cstdio>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static const u64 s_wySecret[4] =
+{
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull,
+};
+
+// words are read little endian so the hash doesn't depend on the host
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HASH_SWAP64(x) __builtin_bswap64(x)
+#define HASH_SWAP32(x) __builtin_bswap32(x)
+#else
+#define HASH_SWAP64(x) (x)
+#define HASH_SWAP32(x) (x)
+#endif
+
+static inline u64 Read8(const u8* p)
+{
+    u64 v;
+    memcpy(&v, p, 8);
+    return HASH_SWAP64(v);
+}
+
+static inline u64 Read4(const u8* p)
+{
+    u32 v;
+    memcpy(&v, p, 4);
+    return HASH_SWAP32(v);
+}
+
+// 1 to 3 bytes, touching each at most once
+static inline u64 Read3(const u8* p, const u64 k)
+{
+    return (u64(p[0]) << 16) | (u64(p[k >> 1]) << 8) | p[k - 1];
+}
+
+// 64x64 -> 128 bit multiply, the halves xored together
+static inline u64 WyMix(u64 a, u64 b)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    u64 hi;
+    const u64 lo = _umul128(a, b, &hi);
+    return lo ^ hi;
+#elif defined(__SIZEOF_INT128__)
+    const unsigned __int128 r = (unsigned __int128)a * b;
+    return u64(r) ^ u64(r >> 64);
+#else
+    const u64 ha = a >> 32, hb = b >> 32, la = u32(a), lb = u32(b);
+    const u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const u64 t = rl + (rm0 << 32);
+    const u64 lo = t + (rm1 << 32);
+    const u64 hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+    return lo ^ hi;
+#endif
+}
+
+static u64 WyHash(const u8* p, const u64 len, u64 seed)
+{
+    const u64* s = s_wySecret;
+    seed ^= WyMix(seed ^ s[0], s[1]);
+    u64 a, b;
+    if(len <= 16)
+    {
+        if(len >= 4)
+        {
+            const u64 mid = (len >> 3) << 2;
+            a = (Read4(p) << 32) | Read4(p + mid);
+            b = (Read4(p + len - 4) << 32) | Read4(p + len - 4 - mid);
+        }
+        else if(len > 0)
+        {
+            a = Read3(p, len);
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        u64 i = len;
+        if(i > 48)
+        {
+            u64 see1 = seed, see2 = seed;
+            do
+            {
+                seed = WyMix(Read8(p) ^ s[1], Read8(p + 8) ^ seed);
+                see1 = WyMix(Read8(p + 16) ^ s[2], Read8(p + 24) ^ see1);
+                see2 = WyMix(Read8(p + 32) ^ s[3], Read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while(i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while(i > 16)
+        {
+            seed = WyMix(Read8(p) ^ s[1], Read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = Read8(p + i - 16);
+        b = Read8(p + i - 8);
+    }
+    return WyMix(s[1] ^ len, WyMix(a ^ s[1], b ^ seed) ^ s[0]);
+}
+
+u64 hash64(const void* p, const u64 len, const u64 seed)
+{
+    return WyHash((const u8*)p, len, seed);
+}
+
+// ------------------------------------------------------------------------
+
+template<typename Fn>
+static double HashGBs(const u8* data, const u64 len, const s32 reps, Fn fn, u64& sum)
+{
+    double best = 1e9;
+    for(s32 round = 0; round < 3; ++round)
+    {
+        CPUTimer timer;
+        for(s32 i = 0; i < reps; ++i)
+        {
+            sum += fn(data, len, u64(i));
+        }
+        const double s = timer.seconds();
+        best = s < best ? s : best;
+    }
+    return double(len) * reps / best * 1e-9;
+}
+
+void HashBench()
+{
+    // an RF_CAP^3 float field
+    const u64 size = 64 * 64 * 64 * sizeof(float);
+    u8* data = new u8[size];
+    u64 x = 1;
+    for(u64 i = 0; i < size; ++i)
+    {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        data[i] = u8(x >> 56);
+    }
+
+    u64 sum = 0;
+    const u64 lens[] = { 16, 64, 256, 1024, 16384, size };
+    for(const u64 len : lens)
+    {
+        const s32 reps = s32((64ull << 20) / len);
+        const double f32 = HashGBs(data, len, reps, [](const u8* p, u64 n, u64){ return u64(fnv(p, u32(n))); }, sum);
+        const double f64 = HashGBs(data, len, reps, [](const u8* p, u64 n, u64 seed){ return fnv64(p, n, seed); }, sum);
+        const double h = HashGBs(data, len, reps, [](const u8* p, u64 n, u64 seed){ return hash64(p, n, seed); }, sum);
+        printf("[Hash] %7llu bytes: fnv %.2f GB/s, fnv64 %.2f GB/s, hash64 %.2f GB/s\n",
+            (unsigned long long)len, f32, f64, h);
+    }
+
+    // flipping any one bit should change the hash
+    u32 same = 0;
+    const u64 base = hash64(data, size);
+    for(u64 bit = 0; bit < size * 8; bit += 4099)
+    {
+        data[bit >> 3] ^= u8(1 << (bit & 7));
+        same += hash64(data, size) == base;
+        data[bit >> 3] ^= u8(1 << (bit & 7));
+    }
+    printf("[Hash] single bit flips left the 1 MB hash unchanged %u times (%llx)\n", same, (unsigned long long)sum);
+    delete[] data;
+}
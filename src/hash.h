@@ -2,6 +2,18 @@
 
 #include "ints.h"
 
+// fnv(const char*) at compile time; C++11 constexpr is a single return, so
+// one recursion per character
+constexpr u32 fnv_finish(const u32 val)
+{
+    return (val & 0x7fffffff) | u32((val & 0x7fffffff) == 0);
+}
+
+constexpr u32 fnv_const(const char* name, const u32 val = 3759247821u)
+{
+    return *name ? fnv_const(name + 1, (val ^ u8(*name)) * 0x01000193u) : fnv_finish(val);
+}
+
 inline u32 fnv(const char* name)
 {
     const u8* data = (const u8*)name;
@@ -35,3 +47,35 @@ inline u32 fnv(const void* p, const u32 len)
     }
     return val;
 }
+
+inline u64 fnv64(const void* p, const u64 len, u64 val = 14695981039346656037ull)
+{
+    const u8* data = (const u8*)p;
+    for(u64 i = 0; i < len; i++)
+    {
+        val ^= data[i];
+        val *= 1099511628211ull;
+    }
+    return val;
+}
+
+// keys from fnv are well mixed already but counters and other plain keys are
+// not; murmur3's finalizer spreads both before masking to a table size
+inline u32 FlatHash(u32 key)
+{
+    key ^= key >> 16;
+    key *= 0x85ebca6b;
+    key ^= key >> 13;
+    key *= 0xc2b2ae35;
+    key ^= key >> 16;
+    return key;
+}
+
+// Fast 64 bit content hash (wyhash): 64x64 -> 128 bit multiplies folded to
+// 64 bits, over 48 bytes per step in three independent chains. Not
+// cryptographic; words are read little endian, so the same bytes and seed
+// give the same value on every platform.
+u64 hash64(const void* p, const u64 len, const u64 seed = 0);
+
+// hash64 against fnv and fnv64, in GB/s
+void HashBench();
@@ -1,11 +1,66 @@
 #include "hashstring.h"
 #include "namestore.h"
+#include "hash.h"
+#include "store.h"
+#include "cputimer.h"
 
 HashString::HashString(const char* str){
-    m_hash = fnv(str);
-    g_NameStore.insert(m_hash, str);
+    m_hash = add(fnv(str), str);
+}
+
+u32 HashString::add(u32 hash, const char* str){
+    g_NameStore.insert(hash, str);
+    return hash;
 }
 
 const char* HashString::str() const {
     return g_NameStore[m_hash];
-}
\ No newline at end of file
+}
+
+// the named uniforms GBuffer and DirectionalLight set each frame
+#define BENCH_UNIFORMS(X) \
+    X("sunDirection") X("sunColor") X("sunIntensity") X("sunMatrix") \
+    X("sunDepth") X("positionSampler") X("normalSampler") X("albedoSampler") \
+    X("env_cm") X("render_resolution") X("IVP") X("sunNearFar") \
+    X("curColor") X("seed") X("distance_field") X("draw_flags")
+
+static s32 LocationOf(Store<s32, 32>& locations, HashString name)
+{
+    const s32* loc = locations.get(name);
+    return loc ? *loc : -1;
+}
+
+void HashStringBench()
+{
+    static_assert(fnv_const("sunDirection") != 0, "fnv_const must fold at compile time");
+
+    // stand in for GLProgram::locations after the first frame
+    Store<s32, 32> locations;
+    s32 next = 0;
+#define BENCH_INSERT(name) locations.insert(fnv(name), next++);
+    BENCH_UNIFORMS(BENCH_INSERT)
+#undef BENCH_INSERT
+
+    const s32 frames = 100000;
+    s32 sum = 0;
+    CPUTimer timer;
+    for(s32 f = 0; f < frames; ++f)
+    {
+#define BENCH_RUNTIME(name) sum += LocationOf(locations, HashString(name));
+        BENCH_UNIFORMS(BENCH_RUNTIME)
+#undef BENCH_RUNTIME
+    }
+    const double runtime_ns = timer.ms() * 1e6 / frames;
+
+    timer.begin();
+    for(s32 f = 0; f < frames; ++f)
+    {
+#define BENCH_CONST(name) sum += LocationOf(locations, HS(name));
+        BENCH_UNIFORMS(BENCH_CONST)
+#undef BENCH_CONST
+    }
+    const double const_ns = timer.ms() * 1e6 / frames;
+
+    printf("[HashString] 16 uniforms per frame: HashString(const char*) %.0f ns, HS %.0f ns, %.0f ns saved per frame (%d)\n",
+        runtime_ns, const_ns, runtime_ns - const_ns, sum);
+}
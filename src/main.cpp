@@ -1,3 +1,5 @@
+#define _CRT_SECURE_NO_WARNINGS
+
 #include "myglheaders.h"
 #include "stdio.h"
 #include "camera.h"
@@ -10,20 +12,263 @@
 #include "framecounter.h"
 #include "profiler.h"
 #include "rasterfield.h"
+#include "cpurender.h"
+#include "renderfarm.h"
+#include "lodepng.h"
+#include "meshblob.h"
+#include "glprogram.h"
+#include "sort.h"
+#include "hash.h"
+#include "store.h"
+#include "slotmap.h"
+#include "array.h"
+#include "hashstring.h"
+#include "namestore.h"
+#include "meshgen.h"
+#include "meshsimplify.h"
+#include "meshorder.h"
+#include "splat.h"
+#include "chunkmesh.h"
+#include "probebake.h"
+#include "raycast.h"
+#include "sdfquery.h"
+#include "sdfopt.h"
 
 #include <random>
 #include <ctime>
+#include <cstring>
 
 void setupScene()
 {
-    u16 handle = g_Renderables.request();
+    SlotHandle handle = g_Renderables.request();
     RenderResource& res = g_Renderables[handle];
     SDFList list;
     SDF& sdf = list.grow();
     sdf.scale = vec3(0.5f);
     sdf.translation = vec3(0.5f);
     sdf.material.setColor(vec3(1.0f, 0.0f, 0.0f));
-    res.updateField(list);
+    res.setSDFs(list);
+}
+
+// a sphere mesh beside the field, drawn at the level its LodChain picks
+void setupMeshes()
+{
+    MeshTask task;
+    SDF& sdf = task.sdfs.grow();
+    sdf.type = SDF_SPHERE;
+    sdf.scale = vec3(0.3f);
+    sdf.translation = vec3(-0.75f, 0.0f, 0.0f);
+    sdf.material.setColor(vec3(0.2f, 0.5f, 1.0f));
+    task.center = sdf.translation;
+    task.radius = 0.5f;
+    task.max_depth = 6;
+    GenerateMeshDC(task);
+
+    const float ratios[] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+    LodChain chain;
+    chain.build(task.geom, ratios, 4, SimplifyParams());
+    g_Renderables.requestMesh(chain);
+
+    // models baked by main --bake ../assets/*.fbx, mapped and laid out in a
+    // row behind the field; any not baked yet are skipped
+    const char* models[] = { "ball", "cube", "plane", "sphere", "suzanne" };
+    float x = -3.0f;
+    for(const char* name : models)
+    {
+        char path[256];
+        snprintf(path, sizeof(path), "../assets/%s.mesh", name);
+        FILE* f = fopen(path, "rb");
+        if(!f)
+            continue;
+        fclose(f);
+
+        const SlotHandle handle = g_Renderables.requestMesh(path);
+        if(handle == SLOT_NULL)
+            continue;
+        LodMesh& mesh = g_Renderables.meshes[handle];
+        const vec3 span = mesh.m_bounds.span();
+        mesh.translate(vec3(x - mesh.m_bounds.lo.x, -mesh.m_center.y, -3.0f - mesh.m_center.z));
+        x += span.x + 0.5f;
+    }
+}
+
+// ground under the scene meshed as a chunk grid; chunks near the camera
+// mesh finer and remesh as it moves
+static SDFList g_chunkSDFs;
+static ChunkGrid g_chunkGrid;
+
+void setupChunks()
+{
+    SDF& floor = g_chunkSDFs.grow();
+    floor.type = SDF_BOX;
+    floor.translation = vec3(0.0f, -1.5f, -2.0f);
+    floor.scale = vec3(7.5f, 0.25f, 7.5f);
+    floor.material.setColor(vec3(0.6f, 0.55f, 0.5f));
+
+    const vec3 hills[] = { vec3(-5.0f, -1.5f, -6.0f), vec3(4.0f, -1.5f, -7.0f), vec3(5.5f, -1.5f, 2.0f) };
+    for(const vec3& p : hills)
+    {
+        SDF& hill = g_chunkSDFs.grow();
+        hill.type = SDF_SPHERE;
+        hill.translation = p;
+        hill.scale = vec3(1.5f);
+        hill.material.setColor(vec3(0.3f, 0.5f, 0.2f));
+    }
+
+    // 16 x 4 x 16 units in 4 unit chunks of 16 cells
+    g_chunkGrid.init(g_chunkSDFs, vec3(-8.0f, -2.5f, -10.0f), ivec3(4, 1, 4), 4.0f, 16);
+    g_Renderables.setChunks(&g_chunkGrid);
+}
+
+// a cluster of spheres beside the field drawn as point splats, the cut
+// refined around the camera every frame
+static SplatTree g_splatTree;
+
+void setupSplats()
+{
+    MeshTask task;
+    const vec3 offsets[] = { vec3(0.0f), vec3(0.3f, 0.25f, 0.0f), vec3(-0.2f, 0.3f, 0.2f) };
+    for(const vec3& p : offsets)
+    {
+        SDF& sdf = task.sdfs.grow();
+        sdf.type = SDF_SPHERE;
+        sdf.scale = vec3(0.25f);
+        sdf.translation = vec3(1.75f, 0.0f, 0.0f) + p;
+        sdf.material.setColor(vec3(1.0f, 0.7f, 0.2f));
+    }
+    task.center = vec3(1.75f, 0.15f, 0.0f);
+    task.radius = 0.6f;
+    task.max_depth = 6;
+    g_splatTree.build(task);
+    g_Renderables.requestSplats(g_splatTree);
+}
+
+void GatherSDFs(SDFList& list)
+{
+    for(const RenderResource& res : g_Renderables)
+    {
+        for(const SDF& sdf : res.m_sdfs)
+        {
+            list.grow() = sdf;
+        }
+    }
+}
+
+// renders a still of the default scene without opening a window:
+// main --cpu out.png [width height]
+// main --farm out.png local_workers [width height]
+// main --worker host [port]
+s32 CPUStill(s32 argc, const char** argv)
+{
+    if(strcmp(argv[1], "--worker") == 0)
+    {
+        return FarmWorker(argv[2], argc >= 4 ? u16(atoi(argv[3])) : FARM_DEFAULT_PORT);
+    }
+
+    const bool farm_mode = strcmp(argv[1], "--farm") == 0;
+    const s32 size_arg = farm_mode ? 4 : 3;
+    CPURenderParams params;
+    if(argc >= size_arg + 2)
+    {
+        params.width = atoi(argv[size_arg]);
+        params.height = atoi(argv[size_arg + 1]);
+    }
+
+    Camera camera;
+    camera.resize(params.width, params.height);
+    camera.setEye(glm::vec3(0.0f, 0.0f, 3.0f));
+    camera.update();
+
+    setupScene();
+    SDFList sdfs;
+    GatherSDFs(sdfs);
+
+    const CPUSun sun;
+    if(!farm_mode)
+    {
+        return CPURenderPNG(sdfs, camera.getEye(), camera.getVP(), sun, params, argv[2]) ? 0 : 1;
+    }
+
+    // with no local workers the coordinator waits for remote ones on FARM_DEFAULT_PORT
+    RenderFarm farm;
+    const u32 num_local = argc >= 4 ? atoi(argv[3]) : 0;
+    if(!farm.listen() || !farm.spawnLocal(num_local))
+        return 1;
+    farm.m_timeoutMs = num_local ? farm.m_timeoutMs : 600000;
+
+    u8* rgba = new u8[params.width * params.height * 4];
+    FarmStats stats;
+    const bool ok = farm.render(sdfs, camera.getEye(), camera.getVP(), sun, params, rgba, &stats);
+    farm.shutdown();
+    printf("[RenderFarm] %u tiles, %u stolen, %u requeued, %u workers lost\n",
+        stats.tiles, stats.stolen, stats.requeued, stats.workers_lost);
+    const unsigned error = ok ? lodepng_encode32_file(argv[2], rgba, params.width, params.height) : 1;
+    delete[] rgba;
+    return error ? 1 : 0;
+}
+
+static void LazyBakeBench()
+{
+    setupScene();
+    SDFList sdfs;
+    GatherSDFs(sdfs);
+    RasterFieldLazyBakeTest(sdfs);
+}
+
+struct BenchEntry
+{
+    const char* name;
+    void (*run)();
+};
+
+static const BenchEntry g_benches[] =
+{
+    { "sort", SortBench },
+    { "hash", HashBench },
+    { "store", StoreBench },
+    { "slotmap", SlotMapBench },
+    { "vector", VectorBench },
+    { "hashstring", HashStringBench },
+    { "namestore", NameStoreBench },
+    { "meshgen", MeshGenBench },
+    { "simplify", SimplifyBench },
+    { "splat", SplatBench },
+    { "chunkmesh", ChunkMeshBench },
+    { "chunkpack", ChunkPackBench },
+    { "meshorder", MeshOrderBench },
+    { "cpurender", CPURenderBench },
+    { "farm", FarmBench },
+    { "probebake", ProbeBakeBench },
+    { "raycast", RayCastBench },
+    { "sdfquery", SDFQueryBench },
+    { "lazybake", LazyBakeBench },
+    { "sdfopt", SDFOptimiseTest },
+};
+
+// runs one bench or self test by name without opening a window, or all of
+// them in order: main --bench <name|all>
+s32 RunBench(const char* name)
+{
+    const bool all = strcmp(name, "all") == 0;
+    bool found = false;
+    for(const BenchEntry& bench : g_benches)
+    {
+        if(all || strcmp(name, bench.name) == 0)
+        {
+            bench.run();
+            found = true;
+        }
+    }
+    if(!found)
+    {
+        printf("unknown bench '%s', expected all or one of:", name);
+        for(const BenchEntry& bench : g_benches)
+        {
+            printf(" %s", bench.name);
+        }
+        printf("\n");
+    }
+    return found ? 0 : 1;
 }
 
 void DrawScene(const Camera& cam, u32 dflag)
@@ -44,10 +289,29 @@ s32 main(s32 argc, const char** argv)
 {
     srand((u32)time(0));
 
+    // offline converter: main --bake assets/*.fbx
+    if(argc >= 3 && strcmp(argv[1], "--bake") == 0)
+    {
+        return BakeMeshBlobs(argv + 2, argc - 2) ? 0 : 1;
+    }
+
+    if(argc >= 3 && (strcmp(argv[1], "--cpu") == 0 || strcmp(argv[1], "--farm") == 0 || strcmp(argv[1], "--worker") == 0))
+    {
+        return CPUStill(argc, argv);
+    }
+
+    if(argc >= 3 && strcmp(argv[1], "--bench") == 0)
+    {
+        return RunBench(argv[2]);
+    }
+
     s32 WIDTH = 1280;
     s32 HEIGHT = 720;
 
-    if(argc >= 3){
+    // reflection self check, needs only a context
+    const bool reflect_check = argc >= 2 && strcmp(argv[1], "--reflect") == 0;
+
+    if(argc >= 3 && !reflect_check){
         WIDTH = atoi(argv[1]);
         HEIGHT = atoi(argv[2]);
     }
@@ -58,6 +322,10 @@ s32 main(s32 argc, const char** argv)
     camera.update();
 
     Window window(WIDTH, HEIGHT, 4, 5, "Renderer");
+    if(reflect_check)
+    {
+        return GLProgramReflectionCheck() ? 0 : 1;
+    }
     Input input(window.getWindow());
 
     g_Renderables.init();
@@ -66,6 +334,9 @@ s32 main(s32 argc, const char** argv)
     u32 flag = DF_INDIRECT;
 
     setupScene();
+    setupMeshes();
+    setupChunks();
+    setupSplats();
 
     while(window.open())
     {
@@ -160,10 +431,14 @@ s32 main(s32 argc, const char** argv)
             }
         }
 
+        g_Renderables.bakeVisible(camera);
+        g_Renderables.updateChunks(camera);
+        g_Renderables.selectLods(camera, HEIGHT);
         DrawScene(camera, flag);
 
         window.swap();
         FpsStats();
+        ResetFrameArena();
     }
     
     g_Renderables.deinit();
@@ -6,6 +6,18 @@
 #include "debugmacro.h"
 #include "shared_uniform.h"
 
+// GL format of each vertex attribute type
+template<typename A> struct attrib_format;
+template<> struct attrib_format<glm::vec2>{ enum { count = 2, type = GL_FLOAT, normalized = GL_FALSE }; };
+template<> struct attrib_format<glm::vec3>{ enum { count = 3, type = GL_FLOAT, normalized = GL_FALSE }; };
+template<> struct attrib_format<glm::vec4>{ enum { count = 4, type = GL_FLOAT, normalized = GL_FALSE }; };
+template<> struct attrib_format<float>{ enum { count = 1, type = GL_FLOAT, normalized = GL_FALSE }; };
+template<> struct attrib_format<unsigned>{ enum { count = 1, type = GL_UNSIGNED_INT, normalized = GL_FALSE }; };
+template<> struct attrib_format<unorm16x3>{ enum { count = 3, type = GL_UNSIGNED_SHORT, normalized = GL_TRUE }; };
+template<> struct attrib_format<snorm16x2>{ enum { count = 2, type = GL_SHORT, normalized = GL_TRUE }; };
+template<> struct attrib_format<unorm8x2>{ enum { count = 2, type = GL_UNSIGNED_BYTE, normalized = GL_TRUE }; };
+template<> struct attrib_format<unorm8x4>{ enum { count = 4, type = GL_UNSIGNED_BYTE, normalized = GL_TRUE }; };
+
 template<typename T>
 struct mesh_layout
 {
@@ -18,36 +30,13 @@ struct mesh_layout
         stride = sizeof(T);
     }
 
-    template<typename T>
-    void layout(int location);
-
-    template<>
-    void layout<glm::vec2>(int location)
-    {
-        glEnableVertexAttribArray(location); DebugGL();;
-        glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, (int)stride, (void*)offset_loc); DebugGL();;
-        offset_loc += sizeof(glm::vec2);
-    }
-    template<>
-    void layout<glm::vec3>(int location)
-    {
-        glEnableVertexAttribArray(location); DebugGL();;
-        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, (int)stride, (void*)offset_loc); DebugGL();;
-        offset_loc += sizeof(glm::vec3);
-    }
-    template<>
-    void layout<glm::vec4>(int location)
-    {
-        glEnableVertexAttribArray(location); DebugGL();;
-        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, (int)stride, (void*)offset_loc); DebugGL();;
-        offset_loc += sizeof(glm::vec4);
-    }
-    template<>
-    void layout<unsigned>(int location)
+    template<typename A>
+    void layout(int location)
     {
+        typedef attrib_format<A> F;
         glEnableVertexAttribArray(location); DebugGL();
-        glVertexAttribPointer(location, 1, GL_UNSIGNED_INT, GL_FALSE, (int)stride, (void*)offset_loc); DebugGL();
-        offset_loc += sizeof(unsigned);
+        glVertexAttribPointer(location, F::count, F::type, GLboolean(F::normalized), (int)stride, (void*)offset_loc); DebugGL();
+        offset_loc += sizeof(A);
     }
 };
 
@@ -95,4 +84,113 @@ void Mesh::draw()const
     glDrawArrays(GL_TRIANGLES, 0, num_indices);
     
     //glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); DebugGL();
-}
\ No newline at end of file
+}
+
+// ------------------------------------------------------------------------
+
+void PackedMesh::init()
+{
+    num_indices = 0;
+    glGenVertexArrays(1, &vao); DebugGL();
+    glGenBuffers(1, &vbo); DebugGL();
+    glGenBuffers(1, &ebo); DebugGL();
+
+    glBindVertexArray(vao); DebugGL();
+    glBindBuffer(GL_ARRAY_BUFFER, vbo); DebugGL();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo); DebugGL();
+
+    mesh_layout<PackedVertex> ml;
+    ml.layout<unorm16x3>(0);    // pos
+    ml.layout<unorm8x2>(1);     // roughness, metalness
+    ml.layout<snorm16x2>(2);    // octahedral normal
+    ml.layout<unorm8x4>(3);     // color, ao
+}
+
+void PackedMesh::deinit()
+{
+    glDeleteBuffers(1, &ebo); DebugGL();
+    glDeleteBuffers(1, &vbo); DebugGL();
+    glDeleteVertexArrays(1, &vao); DebugGL();
+}
+
+void PackedMesh::upload(const PackedVertex* p, const u32 count, const u32* indices, const u32 index_count)
+{
+    glBindVertexArray(vao); DebugGL();
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo); DebugGL();
+    glBufferData(GL_ARRAY_BUFFER, sizeof(PackedVertex) * count,
+        p, GL_STATIC_DRAW); DebugGL();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo); DebugGL();
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(u32) * index_count,
+        indices, GL_STATIC_DRAW); DebugGL();
+
+    num_indices = index_count;
+}
+
+void PackedMesh::draw()const
+{
+    if(!num_indices)
+        return;
+
+    NotifySharedUniformsUpdated();
+
+    glBindVertexArray(vao); DebugGL();
+    glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_INT, nullptr); DebugGL();
+}
+
+// ------------------------------------------------------------------------
+
+void SplatMesh::init()
+{
+    num_indices = 0;
+    glGenVertexArrays(1, &vao); DebugGL();
+    glGenBuffers(1, &vbo); DebugGL();
+    glGenBuffers(1, &ebo); DebugGL();
+
+    glBindVertexArray(vao); DebugGL();
+    glBindBuffer(GL_ARRAY_BUFFER, vbo); DebugGL();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo); DebugGL();
+
+    mesh_layout<SplatVertex> ml;
+    ml.layout<unorm16x3>(0);    // pos
+    ml.layout<unorm8x2>(1);     // roughness, metalness
+    ml.layout<snorm16x2>(2);    // octahedral normal
+    ml.layout<unorm8x4>(3);     // color, ao
+    ml.layout<float>(4);        // radius
+}
+
+void SplatMesh::deinit()
+{
+    glDeleteBuffers(1, &ebo); DebugGL();
+    glDeleteBuffers(1, &vbo); DebugGL();
+    glDeleteVertexArrays(1, &vao); DebugGL();
+}
+
+void SplatMesh::upload(const SplatVertex* p, const u32 count)
+{
+    glBindVertexArray(vao); DebugGL();
+    glBindBuffer(GL_ARRAY_BUFFER, vbo); DebugGL();
+    glBufferData(GL_ARRAY_BUFFER, sizeof(SplatVertex) * count,
+        p, GL_STATIC_DRAW); DebugGL();
+    num_indices = 0;
+}
+
+void SplatMesh::uploadCut(const u32* indices, const u32 count)
+{
+    glBindVertexArray(vao); DebugGL();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo); DebugGL();
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(u32) * count,
+        indices, GL_STREAM_DRAW); DebugGL();
+    num_indices = count;
+}
+
+void SplatMesh::draw()const
+{
+    if(!num_indices)
+        return;
+
+    NotifySharedUniformsUpdated();
+
+    glBindVertexArray(vao); DebugGL();
+    glDrawElements(GL_POINTS, num_indices, GL_UNSIGNED_INT, nullptr); DebugGL();
+}
@@ -10,4 +10,28 @@ struct Mesh
     void upload(const Vertex* p, const u32 count);
     void init();
     void deinit();
-};
\ No newline at end of file
+};
+
+// indexed PackedVertex mesh for packedVert.glsl, which expands positions by
+// SU.df_scale and SU.df_translation; set them to the extent and lo of the
+// bounds the mesh was packed against before drawing
+struct PackedMesh
+{
+    u32 vao, vbo, ebo, num_indices;
+    void draw()const;
+    void upload(const PackedVertex* p, const u32 count, const u32* indices, const u32 index_count);
+    void init();
+    void deinit();
+};
+
+// SplatVertex points for splatVert.glsl, quantised like PackedMesh. The
+// nodes upload once; each frame's cut then uploads as indices.
+struct SplatMesh
+{
+    u32 vao, vbo, ebo, num_indices;
+    void draw()const;
+    void upload(const SplatVertex* p, const u32 count);
+    void uploadCut(const u32* indices, const u32 count);
+    void init();
+    void deinit();
+};
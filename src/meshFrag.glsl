@@ -0,0 +1,44 @@
+#version 450 core
+
+in vec3 Position;
+in vec3 Normal;
+in vec3 Albedo;
+in vec3 Material;   // roughness, metalness, ao
+out vec4 Color;
+
+#define SHARED_UNIFORMS_BINDING 13
+
+struct SharedUniforms
+{
+    mat4 MVP;
+    mat4 IVP;
+    mat4 sunMatrix;
+    vec4 sunDirection;
+    vec4 sunColor; // w -> intensity
+    vec4 eye;
+    vec4 render_resolution; // zw -> sunNearFar
+    vec4 df_translation; // w -> df_pitch;
+    vec4 df_scale;
+    ivec4 seed_flags; // x -> seed, y -> draw mode
+    ivec4 sampler_states; // x -> env_cm; y -> sunDepth;
+};
+
+layout(std430, binding = SHARED_UNIFORMS_BINDING) buffer SU_BUFFER
+{
+    SharedUniforms SU;
+};
+
+void main()
+{
+    const vec3 N = normalize(Normal);
+    const vec3 L = normalize(SU.sunDirection.xyz);
+    const float ndl = max(dot(N, L), 0.0);
+
+    // lambert sun over a flat ambient, darkened by the baked ao
+    const vec3 radiance = SU.sunColor.xyz * SU.sunColor.w;
+    vec3 color = Albedo * (radiance * ndl + vec3(0.1)) * Material.z;
+
+    color = color / (color + vec3(1.0));
+
+    Color = vec4(color.xyz, 1.0);
+}
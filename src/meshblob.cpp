@@ -0,0 +1,241 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "meshblob.h"
+#include "meshimport.h"
+#include "cputimer.h"
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error mesh blobs are written in host order and read as little endian
+#endif
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+static void* MapFile(const char* path, size_t& size, void*& file, void*& mapping)
+{
+    HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(f == INVALID_HANDLE_VALUE)
+        return nullptr;
+    LARGE_INTEGER sz;
+    HANDLE m = GetFileSizeEx(f, &sz) && sz.QuadPart ? CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    void* base = m ? MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if(!base)
+    {
+        if(m)
+            CloseHandle(m);
+        CloseHandle(f);
+        return nullptr;
+    }
+    size = size_t(sz.QuadPart);
+    file = f;
+    mapping = m;
+    return base;
+}
+
+static void UnmapFile(void* base, size_t size, void* file, void* mapping)
+{
+    UnmapViewOfFile(base);
+    CloseHandle((HANDLE)mapping);
+    CloseHandle((HANDLE)file);
+}
+
+#else
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static void* MapFile(const char* path, size_t& size, void*& file, void*& mapping)
+{
+    const int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return nullptr;
+    struct stat st;
+    void* base = fstat(fd, &st) == 0 && st.st_size ? mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    // the mapping outlives the descriptor
+    close(fd);
+    if(base == MAP_FAILED)
+        return nullptr;
+    size = size_t(st.st_size);
+    file = mapping = nullptr;
+    return base;
+}
+
+static void UnmapFile(void* base, size_t size, void* file, void* mapping)
+{
+    munmap(base, size);
+}
+
+#endif
+
+bool MeshBlob::open(const char* path)
+{
+    close();
+    m_base = MapFile(path, m_size, m_file, m_mapping);
+    if(!m_base)
+    {
+        printf("[MeshBlob] could not map %s\n", path);
+        return false;
+    }
+
+    const MeshBlobHeader& h = header();
+    const bool valid = m_size >= sizeof(MeshBlobHeader)
+        && h.magic == MESH_BLOB_MAGIC
+        && h.version == MESH_BLOB_VERSION
+        && h.vertex_offset % 4 == 0 && h.index_offset % 4 == 0
+        && u64(h.vertex_offset) + u64(h.num_vertices) * sizeof(PackedVertex) <= m_size
+        && u64(h.index_offset) + u64(h.num_indices) * sizeof(u32) <= m_size;
+    if(!valid)
+    {
+        printf("[MeshBlob] %s is not a version %u mesh blob\n", path, MESH_BLOB_VERSION);
+        close();
+        return false;
+    }
+
+    // an index past the vertices would have GL read outside the buffer
+    const u32* idx = indices();
+    u32 max_index = 0;
+    for(u32 i = 0; i < h.num_indices; ++i)
+    {
+        max_index = idx[i] > max_index ? idx[i] : max_index;
+    }
+    if(h.num_indices && max_index >= h.num_vertices)
+    {
+        printf("[MeshBlob] %s has index %u past its %u vertices\n", path, max_index, h.num_vertices);
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MeshBlob::close()
+{
+    if(m_base)
+    {
+        UnmapFile(m_base, m_size, m_file, m_mapping);
+    }
+    m_base = nullptr;
+    m_mapping = nullptr;
+    m_file = nullptr;
+    m_size = 0;
+}
+
+bool LoadMeshBlob(const char* path, PackedMesh& mesh, AABB& bounds)
+{
+    MeshBlob blob;
+    if(!blob.open(path))
+        return false;
+    const MeshBlobHeader& h = blob.header();
+    mesh.upload(blob.vertices(), h.num_vertices, blob.indices(), h.num_indices);
+    bounds = h.bounds;
+    return true;
+}
+
+// ------------------------------------------------------------------------
+
+#if MESH_GEN_ENABLED
+
+bool WriteMeshBlob(const Geometry& geom, const char* path)
+{
+    // every field is set, and none has padding, so nothing unset hits disk
+    MeshBlobHeader h;
+    h.magic = MESH_BLOB_MAGIC;
+    h.version = MESH_BLOB_VERSION;
+    h.num_vertices = u32(geom.vertices.count());
+    h.num_indices = u32(geom.indices.count());
+    h.bounds.lo = vec3(FLT_MAX);
+    h.bounds.hi = vec3(-FLT_MAX);
+    for(const MeshVertex& v : geom.vertices)
+    {
+        h.bounds.lo = glm::min(h.bounds.lo, v.position);
+        h.bounds.hi = glm::max(h.bounds.hi, v.position);
+    }
+    if(!h.num_vertices)
+        h.bounds.lo = h.bounds.hi = vec3(0.0f);
+    h.vertex_offset = sizeof(MeshBlobHeader);
+    h.index_offset = h.vertex_offset + h.num_vertices * u32(sizeof(PackedVertex));
+
+    Vector<PackedVertex> packed;
+    PackGeometry(geom, h.bounds, packed);
+
+    FILE* f = fopen(path, "wb");
+    if(!f)
+    {
+        printf("[MeshBlob] could not write %s\n", path);
+        return false;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    ok = ok && fwrite(packed.begin(), sizeof(PackedVertex), h.num_vertices, f) == h.num_vertices;
+    ok = ok && fwrite(geom.indices.begin(), sizeof(u32), h.num_indices, f) == h.num_indices;
+    ok = fclose(f) == 0 && ok;
+    if(!ok)
+    {
+        printf("[MeshBlob] could not write %s\n", path);
+    }
+    return ok;
+}
+
+bool BakeMeshBlob(const char* src, const char* dst)
+{
+    Geometry geom;
+    return ImportGeometry(src, geom) && WriteMeshBlob(geom, dst);
+}
+
+bool BakeMeshBlobs(const char* const* paths, const s32 count)
+{
+    bool ok = true;
+    for(s32 i = 0; i < count; ++i)
+    {
+        // same name, .mesh extension
+        char dst[512];
+        // the last separator of either kind, so Windows paths work too
+        const char* dot = strrchr(paths[i], '.');
+        const char* slash = strrchr(paths[i], '/');
+        const char* back = strrchr(paths[i], '\\');
+        if(back && (!slash || back > slash))
+            slash = back;
+        const s32 len = s32(dot && dot > slash ? dot - paths[i] : strlen(paths[i]));
+        snprintf(dst, sizeof(dst), "%.*s.mesh", len, paths[i]);
+
+        CPUTimer timer;
+        Geometry geom;
+        if(!ImportGeometry(paths[i], geom))
+        {
+            ok = false;
+            continue;
+        }
+        const double import_ms = timer.ms();
+        if(!WriteMeshBlob(geom, dst))
+        {
+            ok = false;
+            continue;
+        }
+
+        // touch every page so the mapping costs what an upload would see
+        timer.begin();
+        MeshBlob blob;
+        u32 touched = 0;
+        if(blob.open(dst))
+        {
+            const u8* bytes = (const u8*)&blob.header();
+            for(size_t b = 0; b < blob.size(); b += 4096)
+            {
+                touched += bytes[b];
+            }
+        }
+        const double load_ms = timer.ms();
+        printf("[MeshBlob] %s: %d tris, %d verts, %u KB; assimp import %.3f ms, blob map %.3f ms (%.0fx, page sum %u)\n",
+            dst, geom.indices.count() / 3, geom.vertices.count(), u32(blob.size() / 1024),
+            import_ms, load_ms, import_ms / glm::max(load_ms, 1e-6), touched);
+    }
+    return ok;
+}
+
+#endif // MESH_GEN_ENABLED
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "meshgen.h"
+#include "mesh.h"
+
+// Baked meshes: a header, PackedVertex data quantised across the header's
+// bounds, then u32 indices, all little endian and laid out exactly as
+// PackedMesh::upload takes them. The writer stores host order, so it only
+// builds for little endian targets. Loading maps the file, checks the
+// indices once and hands the mapping to GL with no copies. Bump
+// MESH_BLOB_VERSION on any layout change; old blobs are then rejected and
+// need baking again.
+
+#define MESH_BLOB_MAGIC     0x4853454du     // "MESH"
+#define MESH_BLOB_VERSION   1u
+
+struct MeshBlobHeader
+{
+    u32 magic;
+    u32 version;
+    u32 num_vertices;
+    u32 num_indices;
+    AABB bounds;
+    u32 vertex_offset;      // bytes from the start of the file
+    u32 index_offset;
+};
+
+static_assert(sizeof(MeshBlobHeader) == 48, "MeshBlobHeader layout is part of the file format");
+
+// read only mapping of a blob; open checks the header and that every
+// index is in range
+class MeshBlob
+{
+    void* m_base = nullptr;
+    size_t m_size = 0;
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+public:
+    MeshBlob(){}
+    ~MeshBlob(){ close(); }
+    MeshBlob(const MeshBlob&) = delete;
+    MeshBlob& operator=(const MeshBlob&) = delete;
+
+    bool open(const char* path);
+    void close();
+    size_t size() const { return m_size; }
+    const MeshBlobHeader& header() const { return *(const MeshBlobHeader*)m_base; }
+    const PackedVertex* vertices() const { return (const PackedVertex*)((const u8*)m_base + header().vertex_offset); }
+    const u32* indices() const { return (const u32*)((const u8*)m_base + header().index_offset); }
+};
+
+// maps, uploads and unmaps; draw with df_translation = bounds.lo and
+// df_scale = PackExtent(bounds)
+bool LoadMeshBlob(const char* path, PackedMesh& mesh, AABB& bounds);
+
+#if MESH_GEN_ENABLED
+
+bool WriteMeshBlob(const Geometry& geom, const char* path);
+// ImportGeometry, then WriteMeshBlob
+bool BakeMeshBlob(const char* src, const char* dst);
+
+// offline converter: main --bake assets/*.fbx
+// writes each model next to itself with a .mesh extension and reports how
+// long mapping the blob takes against importing the model through assimp
+bool BakeMeshBlobs(const char* const* paths, const s32 count);
+
+#endif // MESH_GEN_ENABLED
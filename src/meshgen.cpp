@@ -4,7 +4,12 @@
 #if MESH_GEN_ENABLED
 
 #include "asserts.h"
+#include "parallelfor.h"
+#include "cputimer.h"
+#include "randf.h"
+#include "raycast.h"
 #include <glm/gtx/euler_angles.hpp>
+#include <algorithm>
 #include <thread>
 #include <mutex>
 
@@ -121,7 +126,7 @@ u32 HandleTet(const GridCell& cell, glm::vec3* tris, const u32* ind, const float
 
 struct SubTask
 {
-    Vector<u16> indices;
+    SDFIndices indices;
     glm::vec3 center;
     float radius = 0.0f;
     u32 depth = 0;
@@ -129,11 +134,29 @@ struct SubTask
     float qlen(){ return 1.732052f * radius; }
 };
 
-void MakeTris(const SDFList& sdfs, SubTask& st, Vector<Vertex>& outVerts, std::mutex& mut, const float iso)
+bool SurfaceCell(const SDFList& sdfs, const SDFIndices& parent, const vec3& center,
+    const float radius, const float lipschitz, SDFIndices& indices)
+{
+    const float qlen = 1.732052f * radius;
+    indices.clear();
+    for(const u16 idx : parent)
+    {
+        // a hard union wholly outside the cell never flips a sign in it, but one
+        // containing the cell must stay or the cell reads as outside
+        const SDF& sdf = sdfs[idx];
+        if(sdf.blend_type != SDF_UNION || sdf.distance(center) * lipschitz < qlen)
+        {
+            indices.grow() = idx;
+        }
+    }
+    return indices.count() && glm::abs(SDFDis(sdfs, indices, center)) * lipschitz <= qlen;
+}
+
+void MakeTris(const SDFList& sdfs, SubTask& st, Vector<MeshVertex>& outVerts, std::mutex& mut, const float iso)
 {
     GridCell cell;
 
-    const float offset = st.radius * 2.0f;
+    const float offset = st.radius;
     for(u32 i = 0; i < 8; ++i)
     {
         cell.pts[i] = st.center;
@@ -143,24 +166,26 @@ void MakeTris(const SDFList& sdfs, SubTask& st, Vector<Vertex>& outVerts, std::m
         cell.vals[i] = SDFDis(sdfs, st.indices, cell.pts[i]);
     }
 
+    // corners are indexed by bits, so split along the 0-7 diagonal; every cell
+    // splitting the same way keeps shared faces matched
     const u32 indices[6][4] = 
     {
+        { 0, 1, 3, 7 },
+        { 0, 1, 5, 7 },
         { 0, 2, 3, 7 },
         { 0, 2, 6, 7 },
-        { 0, 4, 6, 7 },
-        { 0, 6, 1, 2 },
-        { 0, 6, 1, 4 },
-        { 5, 6, 1, 4 }
+        { 0, 4, 5, 7 },
+        { 0, 4, 6, 7 }
     };
 
-    Array<Vertex, 36> vertices;
+    Array<MeshVertex, 36> vertices;
     for(u32 i = 0; i < 6; ++i)
     {
         vec3 tris[6];
         const u32 num_verts = 3 * HandleTet(cell, tris, indices[i], iso);
         for(u32 j = 0; j < num_verts; ++j)
         {
-            Vertex& vert = vertices.grow();
+            MeshVertex& vert = vertices.grow();
             const vec3 N = SDFNorm(sdfs, st.indices, tris[j]);
             const Material mat = SDFMaterial(sdfs, st.indices, tris[j]);
             const float ao = SDFAO(sdfs, tris[j], N);
@@ -176,7 +201,7 @@ void MakeTris(const SDFList& sdfs, SubTask& st, Vector<Vertex>& outVerts, std::m
     if(vertices.count())
     {
         mut.lock();
-        for(const Vertex& vert : vertices)
+        for(const MeshVertex& vert : vertices)
         {
             outVerts.grow() = vert;
         }
@@ -184,17 +209,17 @@ void MakeTris(const SDFList& sdfs, SubTask& st, Vector<Vertex>& outVerts, std::m
     }
 }
 
-void MakePts(const SDFList& sdfs, SubTask& st, Vector<Vertex>& outVerts, std::mutex& mut)
+MeshVertex SurfacePoint(const SDFList& sdfs, const SDFIndices& indices, const vec3& center, const float radius)
 {
-    vec3 aN = SDFNorm(sdfs, st.indices, st.center);
+    vec3 aN = SDFNorm(sdfs, indices, center);
     {
-        const vec3 axN = glm::abs(axN);
-        const float mc = glm::max(aN.x, glm::max(aN.y, aN.z));
-        if(mc == aN.x)
+        const vec3 axN = glm::abs(aN);
+        const float mc = glm::max(axN.x, glm::max(axN.y, axN.z));
+        if(mc == axN.x)
         {
             aN = vec3(1.0f, 0.0f, 0.0f) * glm::sign(aN.x);
         }
-        else if(mc == aN.y)
+        else if(mc == axN.y)
         {
             aN = vec3(0.0f, 1.0f, 0.0f) * glm::sign(aN.y);
         }
@@ -204,53 +229,63 @@ void MakePts(const SDFList& sdfs, SubTask& st, Vector<Vertex>& outVerts, std::mu
         }
     }
 
-    vec3 pt = st.center;
+    vec3 pt = center;
     float travel = 0.0f;
     for(s32 i = 0; i < 10; ++i)
     {
-        const float dis = SDFDis(sdfs, st.indices, pt);
+        const float dis = SDFDis(sdfs, indices, pt);
         travel += glm::abs(dis);
-        if(travel > st.radius)
+        if(travel > radius)
             break;
         
         pt -= dis * aN;
     }
 
-    mut.lock();
-    Vertex& vert = outVerts.grow();
-    mut.unlock();
-
-    const vec3 N = SDFNorm(sdfs, st.indices, pt);
-    const Material mat = SDFMaterial(sdfs, st.indices, pt);
+    const vec3 N = SDFNorm(sdfs, indices, pt);
+    const Material mat = SDFMaterial(sdfs, indices, pt);
     const float ao = SDFAO(sdfs, pt, N);
     const float roughness = mat.getRoughness();
     const float metalness = mat.getMetalness();
+
+    MeshVertex vert;
     vert.setPosition(pt);
     vert.setNormal(N);
     vert.setColor(mat.getColor());
     vert.setMaterial(glm::vec3(roughness, metalness, ao));
+    return vert;
+}
+
+void MakePts(const SDFList& sdfs, SubTask& st, Vector<MeshVertex>& outVerts, std::mutex& mut)
+{
+    const MeshVertex vert = SurfacePoint(sdfs, st.indices, st.center, st.radius);
+
+    mut.lock();
+    outVerts.grow() = vert;
+    mut.unlock();
 }
 
 void GenerateMesh(MeshTask& task)
 {
     task.geom.vertices.clear();
+    task.geom.indices.clear();
 
+    // the root is culled like every child, through SurfaceCell
+    const float lipschitz = SafeRelaxation(task.sdfs);
     Vector<SubTask> subtasks;
     {
-        SubTask& st = subtasks.grow();
-        st.center = task.center;
-        st.radius = task.radius;
-        st.depth = 0;
+        SubTask root;
+        root.center = task.center;
+        root.radius = task.radius;
+        root.depth = 0;
 
-        const float qlen = st.qlen();
-        const u16 numSdfs = task.sdfs.count();
-        for(u16 i = 0; i < numSdfs; ++i)
+        SDFIndices all;
+        for(u16 i = 0; i < u16(task.sdfs.count()); ++i)
         {
-            const float dis = task.sdfs[i].distance(st.center);
-            if(dis < qlen)
-            {
-                st.indices.grow() = i;
-            }
+            all.grow() = i;
+        }
+        if(SurfaceCell(task.sdfs, all, root.center, root.radius, lipschitz, root.indices))
+        {
+            subtasks.push(std::move(root));
         }
     }
 
@@ -275,8 +310,14 @@ void GenerateMesh(MeshTask& task)
 
         if(st.depth == task.max_depth)
         {
-            //MakeTris(task.sdfs, st, task.geom.vertices, vertexLock, 0.0f);
-            MakePts(task.sdfs, st, task.geom.vertices, vertexLock);
+            if(task.triangles)
+            {
+                MakeTris(task.sdfs, st, task.geom.vertices, vertexLock, 0.0f);
+            }
+            else
+            {
+                MakePts(task.sdfs, st, task.geom.vertices, vertexLock);
+            }
         }
         else
         {
@@ -293,17 +334,7 @@ void GenerateMesh(MeshTask& task)
                 child.radius = nlen;
                 child.depth = st.depth + 1;
 
-                const float qlen = child.qlen();
-                for(const u16 idx : st.indices)
-                {
-                    const float dis = task.sdfs[idx].distance(child.center);
-                    if(glm::abs(dis) < qlen)
-                    {
-                        child.indices.grow() = idx;
-                    }
-                }
-
-                if(child.indices.count())
+                if(SurfaceCell(task.sdfs, st.indices, child.center, child.radius, lipschitz, child.indices))
                 {
                     subtaskLock.lock();
                     subtasks.grow() = child;
@@ -340,6 +371,437 @@ void GenerateMesh(MeshTask& task)
     }
 }
 
+// ------------------------------------------------------------------------
+// dual contouring
+
+// least squares fit of a point to the tangent planes of a cell's edge crossings
+struct QEF
+{
+    float ata[6];   // xx, xy, xz, yy, yz, zz
+    vec3 atb;
+    float btb;
+    vec3 mass;
+    u32 count;
+
+    void clear()
+    {
+        for(s32 i = 0; i < 6; ++i)
+            ata[i] = 0.0f;
+        atb = vec3(0.0f);
+        btb = 0.0f;
+        mass = vec3(0.0f);
+        count = 0;
+    }
+    void add(const vec3& p, const vec3& n)
+    {
+        ata[0] += n.x * n.x; ata[1] += n.x * n.y; ata[2] += n.x * n.z;
+        ata[3] += n.y * n.y; ata[4] += n.y * n.z; ata[5] += n.z * n.z;
+        const float d = dot(n, p);
+        atb += n * d;
+        btb += d * d;
+        mass += p;
+        ++count;
+    }
+    void merge(const QEF& o)
+    {
+        for(s32 i = 0; i < 6; ++i)
+            ata[i] += o.ata[i];
+        atb += o.atb;
+        btb += o.btb;
+        mass += o.mass;
+        count += o.count;
+    }
+    mat3 matrix() const
+    {
+        return mat3(ata[0], ata[1], ata[2], ata[1], ata[3], ata[4], ata[2], ata[4], ata[5]);
+    }
+    float error(const vec3& x) const
+    {
+        return glm::max(0.0f, dot(x, matrix() * x) - 2.0f * dot(x, atb) + btb);
+    }
+    vec3 solve(const vec3& lo, const vec3& hi) const;
+};
+
+// jacobi rotations; eigenvectors end up in the columns of V
+static void SymmetricEigen(mat3 A, mat3& V, vec3& e)
+{
+    V = mat3(1.0f);
+    const s32 pairs[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+    for(s32 sweep = 0; sweep < 8; ++sweep)
+    {
+        for(s32 k = 0; k < 3; ++k)
+        {
+            const s32 p = pairs[k][0];
+            const s32 q = pairs[k][1];
+            const float apq = A[q][p];
+            if(glm::abs(apq) < 0.000000001f)
+                continue;
+
+            const float theta = (A[q][q] - A[p][p]) / (2.0f * apq);
+            const float t = (theta >= 0.0f ? 1.0f : -1.0f) / (glm::abs(theta) + glm::sqrt(theta * theta + 1.0f));
+            const float c = 1.0f / glm::sqrt(t * t + 1.0f);
+            const float s = t * c;
+
+            mat3 J(1.0f);
+            J[p][p] = c;
+            J[q][q] = c;
+            J[q][p] = s;
+            J[p][q] = -s;
+            A = transpose(J) * A * J;
+            V = V * J;
+        }
+    }
+    e = vec3(A[0][0], A[1][1], A[2][2]);
+}
+
+// the minimiser closest to the mass point: small eigenvalues are dropped from
+// the pseudo inverse so flat and edge-only cells stay near their crossings
+vec3 QEF::solve(const vec3& lo, const vec3& hi) const
+{
+    const vec3 c = mass / float(count);
+    const mat3 A = matrix();
+    const vec3 b = atb - A * c;
+
+    mat3 V;
+    vec3 e;
+    SymmetricEigen(A, V, e);
+    const float emax = glm::max(glm::abs(e.x), glm::max(glm::abs(e.y), glm::abs(e.z)));
+
+    vec3 x = c;
+    for(s32 i = 0; i < 3; ++i)
+    {
+        if(glm::abs(e[i]) > emax * 0.1f)
+        {
+            x += V[i] * (dot(V[i], b) / e[i]);
+        }
+    }
+    return glm::clamp(x, lo, hi);
+}
+
+struct DCCell
+{
+    ivec3 coord;
+    u8 inside;      // bit i set when corner i is inside
+    s32 cluster;    // -1 without a crossing
+    QEF qef;
+};
+
+struct DCCluster
+{
+    QEF qef;
+    vec3 position;
+    ivec3 coord;    // at the cluster's level
+    s32 parent;
+    u32 leaf;       // a member leaf, for its primitive list
+};
+
+// the file pulls in glm's namespace, whose u64 differs from ours on some platforms
+struct DCKey
+{
+    ::u64 key;
+    s32 index;
+    bool operator<(const DCKey& o) const { return key < o.key; }
+};
+
+static ::u64 DCPack(const ivec3& c)
+{
+    return ::u64(u32(c.x)) | (::u64(u32(c.y)) << 21) | (::u64(u32(c.z)) << 42);
+}
+
+static void CollectLeaves(const SDFList& sdfs, SubTask& st, const u32 max_depth, const float lipschitz, ArenaVector<SubTask>& leaves)
+{
+    if(st.depth == max_depth)
+    {
+        leaves.grow() = st;
+        return;
+    }
+
+    const float nlen = st.radius * 0.5f;
+    for(u32 i = 0; i < 8; ++i)
+    {
+        SubTask child;
+        child.center = st.center;
+        child.center.x += (i & 1) ? -nlen : nlen;
+        child.center.y += (i & 2) ? -nlen : nlen;
+        child.center.z += (i & 4) ? -nlen : nlen;
+        child.radius = nlen;
+        child.depth = st.depth + 1;
+
+        if(SurfaceCell(sdfs, st.indices, child.center, child.radius, lipschitz, child.indices))
+        {
+            CollectLeaves(sdfs, child, max_depth, lipschitz, leaves);
+        }
+    }
+}
+
+void GenerateMeshDC(MeshTask& task, const float max_error)
+{
+    task.geom.vertices.clear();
+    task.geom.indices.clear();
+
+    const s32 res = 1 << task.max_depth;
+    const float size = 2.0f * task.radius / float(res);
+    const vec3 origin = task.center - vec3(task.radius);
+
+    // every list below is scratch in this thread's arena; the workers only
+    // read leaves and write cells, and are joined before the scope ends
+    ArenaScope scope;
+    ArenaVector<SubTask> leaves;
+    {
+        SubTask root;
+        root.center = task.center;
+        root.radius = task.radius;
+        const float lipschitz = SafeRelaxation(task.sdfs);
+        SDFIndices all;
+        for(u16 i = 0; i < u16(task.sdfs.count()); ++i)
+        {
+            all.grow() = i;
+        }
+        if(SurfaceCell(task.sdfs, all, root.center, root.radius, lipschitz, root.indices))
+        {
+            CollectLeaves(task.sdfs, root, task.max_depth, lipschitz, leaves);
+        }
+    }
+
+    const s32 num_leaves = leaves.count();
+    if(!num_leaves)
+        return;
+
+    const s32 edges[12][2] = 
+    {
+        { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+        { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+        { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+    };
+
+    ArenaVector<DCCell> cells(num_leaves);
+    for(s32 i = 0; i < num_leaves; ++i)
+    {
+        cells.append();
+    }
+    ParallelForStealing(u32(num_leaves), 0, [&](u32 i, u32)
+    {
+        const SubTask& leaf = leaves[i];
+        DCCell& cell = cells[i];
+        cell.coord = glm::clamp(ivec3(glm::floor((leaf.center - origin) / size)), ivec3(0), ivec3(res - 1));
+        cell.cluster = -1;
+        cell.inside = 0;
+        cell.qef.clear();
+
+        const vec3 lo = origin + vec3(cell.coord) * size;
+        vec3 pts[8];
+        float vals[8];
+        for(s32 c = 0; c < 8; ++c)
+        {
+            pts[c] = lo + vec3(float(c & 1), float((c >> 1) & 1), float((c >> 2) & 1)) * size;
+            vals[c] = SDFDis(task.sdfs, leaf.indices, pts[c]);
+            cell.inside |= vals[c] < 0.0f ? u8(1 << c) : u8(0);
+        }
+        if(cell.inside == 0 || cell.inside == 0xff)
+            return;
+
+        for(s32 k = 0; k < 12; ++k)
+        {
+            const s32 a = edges[k][0];
+            const s32 b = edges[k][1];
+            if((vals[a] < 0.0f) == (vals[b] < 0.0f))
+                continue;
+            const float t = vals[a] / (vals[a] - vals[b]);
+            const vec3 p = glm::mix(pts[a], pts[b], t);
+            cell.qef.add(p, SDFNorm(task.sdfs, leaf.indices, p));
+        }
+    });
+
+    ArenaVector<DCCluster> clusters;
+    for(s32 i = 0; i < num_leaves; ++i)
+    {
+        DCCell& cell = cells[i];
+        if(!cell.qef.count)
+            continue;
+        cell.cluster = clusters.count();
+        DCCluster& cl = clusters.grow();
+        const vec3 lo = origin + vec3(cell.coord) * size;
+        cl.qef = cell.qef;
+        cl.position = cell.qef.solve(lo, lo + vec3(size));
+        cl.coord = cell.coord;
+        cl.parent = -1;
+        cl.leaf = u32(i);
+    }
+
+    // octree collapse: siblings merge into their parent's cell while the merged
+    // residual stays under max_error; a failed parent blocks all its ancestors
+    if(max_error > 0.0f)
+    {
+        ArenaVector<DCKey> active;
+        for(s32 i = 0; i < clusters.count(); ++i)
+        {
+            DCKey& k = active.grow();
+            k.key = DCPack(clusters[i].coord);
+            k.index = i;
+        }
+
+        for(u32 level = task.max_depth; level > 0 && active.count(); --level)
+        {
+            for(DCKey& k : active)
+            {
+                k.key = DCPack(ivec3(k.key & 0x1fffff, (k.key >> 21) & 0x1fffff, k.key >> 42) >> 1);
+            }
+            std::sort(active.begin(), active.end());
+
+            ArenaVector<DCKey> next;
+            const float cell_size = size * float(1 << (task.max_depth - level + 1));
+            for(s32 begin = 0; begin < active.count(); )
+            {
+                s32 end = begin;
+                bool blocked = false;
+                QEF qef;
+                qef.clear();
+                while(end < active.count() && active[end].key == active[begin].key)
+                {
+                    blocked = blocked || active[end].index < 0;
+                    if(active[end].index >= 0)
+                    {
+                        qef.merge(clusters[active[end].index].qef);
+                    }
+                    ++end;
+                }
+
+                const ::u64 key = active[begin].key;
+                const ivec3 coord = ivec3(key & 0x1fffff, (key >> 21) & 0x1fffff, key >> 42);
+                DCKey& k = next.grow();
+                k.key = key;
+                k.index = -1;
+                if(!blocked)
+                {
+                    const vec3 lo = origin + vec3(coord) * cell_size;
+                    const vec3 x = qef.solve(lo, lo + vec3(cell_size));
+                    if(qef.error(x) <= max_error)
+                    {
+                        k.index = clusters.count();
+                        DCCluster& cl = clusters.grow();
+                        cl.qef = qef;
+                        cl.position = x;
+                        cl.coord = coord;
+                        cl.parent = -1;
+                        cl.leaf = clusters[active[begin].index].leaf;
+                        for(s32 i = begin; i < end; ++i)
+                        {
+                            clusters[active[i].index].parent = k.index;
+                        }
+                    }
+                }
+                begin = end;
+            }
+
+            // blocked parents only matter while a sibling is still collapsing
+            active.clear();
+            for(const DCKey& k : next)
+            {
+                active.grow() = k;
+            }
+        }
+    }
+
+    ArenaVector<DCKey> lookup;
+    for(s32 i = 0; i < num_leaves; ++i)
+    {
+        DCKey& k = lookup.grow();
+        k.key = DCPack(cells[i].coord);
+        k.index = i;
+    }
+    std::sort(lookup.begin(), lookup.end());
+    auto FindCluster = [&](const ivec3& c) -> s32
+    {
+        if(glm::any(glm::lessThan(c, ivec3(0))))
+            return -1;
+        DCKey k;
+        k.key = DCPack(c);
+        const DCKey* it = std::lower_bound(lookup.begin(), lookup.end(), k);
+        if(it == lookup.end() || it->key != k.key)
+            return -1;
+        s32 cl = cells[it->index].cluster;
+        while(cl >= 0 && clusters[cl].parent >= 0)
+        {
+            cl = clusters[cl].parent;
+        }
+        return cl;
+    };
+
+    // one quad per crossing edge, owned by the cell at the edge's low corner
+    ArenaVector<s32> remap(clusters.count());
+    for(s32 i = 0; i < clusters.count(); ++i)
+    {
+        remap.append() = -1;
+    }
+    for(s32 i = 0; i < num_leaves; ++i)
+    {
+        const DCCell& cell = cells[i];
+        if(cell.cluster < 0)
+            continue;
+
+        for(s32 a = 0; a < 3; ++a)
+        {
+            const bool s0 = (cell.inside & 1) != 0;
+            const bool s1 = (cell.inside & (1 << (1 << a))) != 0;
+            if(s0 == s1)
+                continue;
+
+            ivec3 eb(0), ec(0);
+            eb[(a + 1) % 3] = 1;
+            ec[(a + 2) % 3] = 1;
+            s32 quad[4] = 
+            {
+                FindCluster(cell.coord),
+                FindCluster(cell.coord - eb),
+                FindCluster(cell.coord - eb - ec),
+                FindCluster(cell.coord - ec)
+            };
+            if(quad[0] < 0 || quad[1] < 0 || quad[2] < 0 || quad[3] < 0)
+                continue;
+
+            // counter clockwise around +a; the surface faces +a when the low corner is inside
+            if(!s0)
+            {
+                const s32 t = quad[1];
+                quad[1] = quad[3];
+                quad[3] = t;
+            }
+
+            const s32 tris[2][3] = { { quad[0], quad[1], quad[2] }, { quad[0], quad[2], quad[3] } };
+            for(s32 t = 0; t < 2; ++t)
+            {
+                if(tris[t][0] == tris[t][1] || tris[t][1] == tris[t][2] || tris[t][0] == tris[t][2])
+                    continue;
+                for(s32 v = 0; v < 3; ++v)
+                {
+                    const s32 cl = tris[t][v];
+                    if(remap[cl] < 0)
+                    {
+                        remap[cl] = task.geom.vertices.count();
+                        task.geom.vertices.grow().setPosition(clusters[cl].position);
+                    }
+                    task.geom.indices.grow() = u32(remap[cl]);
+                }
+            }
+        }
+    }
+
+    for(s32 i = 0; i < clusters.count(); ++i)
+    {
+        if(remap[i] < 0)
+            continue;
+        MeshVertex& vert = task.geom.vertices[remap[i]];
+        const SDFIndices& indices = leaves[clusters[i].leaf].indices;
+        const vec3 N = SDFNorm(task.sdfs, indices, vert.position);
+        const Material mat = SDFMaterial(task.sdfs, indices, vert.position);
+        const float ao = SDFAO(task.sdfs, vert.position, N);
+        vert.setNormal(N);
+        vert.setColor(mat.getColor());
+        vert.setMaterial(glm::vec3(mat.getRoughness(), mat.getMetalness(), ao));
+    }
+
+}
+
 void GenMeshTest(MeshTask& task)
 {
     for(u32 id = 0; id < 256; ++id)
@@ -366,12 +828,12 @@ void GenMeshTest(MeshTask& task)
         
         const u32 indices[6][4] = 
         {
+            { 0, 1, 3, 7 },
+            { 0, 1, 5, 7 },
             { 0, 2, 3, 7 },
             { 0, 2, 6, 7 },
-            { 0, 4, 6, 7 },
-            { 0, 6, 1, 2 },
-            { 0, 6, 1, 4 },
-            { 5, 6, 1, 4 }
+            { 0, 4, 5, 7 },
+            { 0, 4, 6, 7 }
         };
 
         for(u32 i = 0; i < 6; ++i)
@@ -383,7 +845,7 @@ void GenMeshTest(MeshTask& task)
             Ns[1] = normalize(cross(tris[4]-tris[3], tris[5]-tris[3]));
             for(u32 j = 0; j < num_verts; ++j)
             {
-                Vertex& vert = task.geom.vertices.grow();
+                MeshVertex& vert = task.geom.vertices.grow();
                 const vec3 N = j >= 3 ? Ns[0] : Ns[1];
                 const float ao = 0.0f;
                 const float roughness = 0.5f;
@@ -397,4 +859,87 @@ void GenMeshTest(MeshTask& task)
     }
 }
 
-#endif // MESH_GEN_ENABLED
\ No newline at end of file
+void PackGeometry(const Geometry& geom, const AABB& bounds, Vector<PackedVertex>& out)
+{
+    out.clear();
+    out.resize(geom.vertices.count());
+    const vec3 extent = PackExtent(bounds);
+    for(const MeshVertex& v : geom.vertices)
+    {
+        out.grow() = PackVertex(v.position, v.normal, v.color, v.material, bounds.lo, extent);
+    }
+}
+
+void SurfaceError(const SDFList& sdfs, const Geometry& geom, float& rms, float& max_err)
+{
+    const bool indexed = geom.indices.count() > 0;
+    const s32 num_tris = (indexed ? geom.indices.count() : geom.vertices.count()) / 3;
+    double sum = 0.0;
+    max_err = 0.0f;
+    for(s32 t = 0; t < num_tris; ++t)
+    {
+        vec3 p[3];
+        for(s32 v = 0; v < 3; ++v)
+        {
+            p[v] = geom.vertices[indexed ? s32(geom.indices[t * 3 + v]) : t * 3 + v].position;
+        }
+        const vec3 samples[4] = 
+        {
+            (p[0] + p[1] + p[2]) / 3.0f,
+            (p[0] + p[1]) * 0.5f,
+            (p[1] + p[2]) * 0.5f,
+            (p[2] + p[0]) * 0.5f
+        };
+        for(const vec3& q : samples)
+        {
+            const float e = glm::abs(SDFDis(sdfs, q));
+            sum += double(e) * e;
+            max_err = glm::max(max_err, e);
+        }
+    }
+    rms = num_tris ? float(glm::sqrt(sum / (num_tris * 4.0))) : 0.0f;
+}
+
+void MeshGenBench()
+{
+    if(!ALLOC_COUNTING)
+        printf("[MeshGen] built without ALLOC_COUNTING, alloc counts read 0\n");
+    MeshTask task;
+    for(u32 i = 0; i < 12; ++i)
+    {
+        SDF& sdf = task.sdfs.grow();
+        sdf.type = (i & 1) ? SDF_SPHERE : SDF_BOX;
+        sdf.translation = vec3(randf(), randf(), randf()) * 4.0f - 2.0f;
+        sdf.material.setColor(vec3(randf(), randf(), randf()));
+    }
+    task.center = vec3(0.0f);
+    task.radius = 4.0f;
+    task.max_depth = 6;
+
+    float rms, max_err;
+    task.triangles = true;
+    CPUTimer timer;
+    ::u64 allocs = AllocCount();
+    GenerateMesh(task);
+    double ms = timer.ms();
+    allocs = AllocCount() - allocs;
+    SurfaceError(task.sdfs, task.geom, rms, max_err);
+    const float tet_rms = rms;
+    printf("[MeshGen] tetrahedra, depth %u:            %7d tris, %8.1f ms, %6u allocs, rms error %.5f, max %.5f\n",
+        task.max_depth, task.geom.vertices.count() / 3, ms, u32(allocs), rms, max_err);
+
+    const float thresholds[5] = { 0.0f, 0.0001f, 0.001f, 0.01f, 0.1f };
+    for(const float max_error : thresholds)
+    {
+        timer.begin();
+        allocs = AllocCount();
+        GenerateMeshDC(task, max_error);
+        ms = timer.ms();
+        allocs = AllocCount() - allocs;
+        SurfaceError(task.sdfs, task.geom, rms, max_err);
+        printf("[MeshGen] dual contouring, max_error %-6g: %7d tris, %8.1f ms, %6u allocs, rms error %.5f, max %.5f%s\n",
+            max_error, task.geom.indices.count() / 3, ms, u32(allocs), rms, max_err, rms <= tet_rms ? ", within tet error" : "");
+    }
+}
+
+#endif // MESH_GEN_ENABLED
@@ -1,11 +1,34 @@
 #pragma once
 
-#define MESH_GEN_ENABLED 0
+#define MESH_GEN_ENABLED 1
 
 #if MESH_GEN_ENABLED
 
+#include "ints.h"
+#include "linmath.h"
+#include "array.h"
+#include "sdf.h"
+#include "aabb.h"
 #include "vertexbuffer.h"
-#include "sdfs.h"
+
+struct MeshVertex
+{
+    vec3 position;
+    vec3 normal;
+    vec3 color;
+    vec3 material;  // roughness, metalness, ao
+
+    void setPosition(const vec3& p){ position = p; }
+    void setNormal(const vec3& n){ normal = n; }
+    void setColor(const vec3& c){ color = c; }
+    void setMaterial(const vec3& m){ material = m; }
+};
+
+struct Geometry
+{
+    Vector<MeshVertex> vertices;
+    Vector<u32> indices;    // empty for point and triangle soup output
+};
 
 struct MeshTask
 {
@@ -14,6 +37,7 @@ struct MeshTask
     vec3 center;
     float radius = 1.0f;
     u32 max_depth = 5;
+    bool triangles = false; // marching tetrahedra soup instead of points
 
     float getPointSize()
     {
@@ -23,6 +47,37 @@ struct MeshTask
 
 void GenerateMesh(MeshTask& task);
 
+// fills indices with the primitives of parent that can decide the field's sign
+// inside the cube at center with half edge radius, and returns false when the
+// surface cannot pass through it. lipschitz is SafeRelaxation of the list.
+bool SurfaceCell(const SDFList& sdfs, const SDFIndices& parent, const vec3& center,
+    const float radius, const float lipschitz, SDFIndices& indices);
+
+// walks from center onto the surface along the normal's dominant axis, moving
+// at most radius, and shades the result like a mesh vertex; one per point
+// emitted by GenerateMesh's point mode
+MeshVertex SurfacePoint(const SDFList& sdfs, const SDFIndices& indices, const vec3& center, const float radius);
+
+// Dual contouring over the leaves of the same octree: one QEF minimising
+// vertex per leaf crossing the surface, one quad per crossing edge. Sibling
+// vertices are then collapsed level by level while the merged QEF residual
+// stays below max_error, so 0 keeps every leaf vertex.
+void GenerateMeshDC(MeshTask& task, const float max_error = 0.0f);
+
 void GenMeshTest(MeshTask& task);
 
-#endif // MESH_GEN_ENABLED
\ No newline at end of file
+// geom's vertices quantised against bounds, normally those of its chunk, for
+// PackedMesh; indices carry over unchanged
+void PackGeometry(const Geometry& geom, const AABB& bounds, Vector<PackedVertex>& out);
+// the extent PackGeometry quantises against, clamped so flat bounds don't
+// divide by zero; draw with it as df_scale
+inline vec3 PackExtent(const AABB& bounds){ return glm::max(bounds.span(), vec3(1e-6f)); }
+
+// rms and max field value over triangle centroids and edge midpoints, for
+// indexed or soup geometry
+void SurfaceError(const SDFList& sdfs, const Geometry& geom, float& rms, float& max_err);
+
+// triangle count, time and surface error of both meshers on one scene
+void MeshGenBench();
+
+#endif // MESH_GEN_ENABLED
@@ -0,0 +1,70 @@
+#include "meshimport.h"
+
+#if MESH_GEN_ENABLED
+
+#include "meshorder.h"
+#include "assimp/cimport.h"
+#include "assimp/scene.h"
+#include "assimp/postprocess.h"
+#include <cstdio>
+
+bool ImportGeometry(const char* filename, Geometry& geom)
+{
+    geom.vertices.clear();
+    geom.indices.clear();
+
+    const aiScene* scene = aiImportFile(filename,
+        aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_GenSmoothNormals |
+        aiProcess_PreTransformVertices | aiProcess_SortByPType);
+    if(!scene)
+    {
+        printf("[ImportGeometry] failed to load %s: %s\n", filename, aiGetErrorString());
+        return false;
+    }
+
+    for(u32 m = 0; m < scene->mNumMeshes; ++m)
+    {
+        const aiMesh* mesh = scene->mMeshes[m];
+        if(mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE)
+            continue;
+
+        const aiMaterial* mat = scene->mMaterials[mesh->mMaterialIndex];
+        aiColor4D diffuse(1.0f, 1.0f, 1.0f, 1.0f);
+        aiGetMaterialColor(mat, AI_MATKEY_COLOR_DIFFUSE, &diffuse);
+        float shininess = 0.0f;
+        aiGetMaterialFloat(mat, AI_MATKEY_SHININESS, &shininess);
+        const float roughness = glm::sqrt(2.0f / (glm::max(shininess, 0.0f) + 2.0f));
+
+        const u32 base = u32(geom.vertices.count());
+        for(u32 i = 0; i < mesh->mNumVertices; ++i)
+        {
+            const aiVector3D& p = mesh->mVertices[i];
+            const aiVector3D N = mesh->mNormals ? mesh->mNormals[i] : aiVector3D(0.0f, 1.0f, 0.0f);
+            const aiColor4D& c = mesh->mColors[0] ? mesh->mColors[0][i] : diffuse;
+            MeshVertex& vert = geom.vertices.grow();
+            vert.setPosition(vec3(p.x, p.y, p.z));
+            vert.setNormal(vec3(N.x, N.y, N.z));
+            vert.setColor(vec3(c.r, c.g, c.b));
+            vert.setMaterial(vec3(roughness, 0.0f, 0.0f));
+        }
+        for(u32 i = 0; i < mesh->mNumFaces; ++i)
+        {
+            const aiFace& face = mesh->mFaces[i];
+            for(u32 k = 0; k < 3; ++k)
+            {
+                geom.indices.grow() = base + face.mIndices[k];
+            }
+        }
+    }
+
+    aiReleaseImport(scene);
+    if(!geom.indices.count())
+    {
+        printf("[ImportGeometry] no triangles in %s\n", filename);
+        return false;
+    }
+    OptimizeMesh(geom);
+    return true;
+}
+
+#endif // MESH_GEN_ENABLED
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "meshgen.h"
+
+#if MESH_GEN_ENABLED
+
+// loads every triangle mesh of a model assimp understands (fbx, obj, ...)
+// into one indexed Geometry, node transforms baked in. Vertex colors, or the
+// diffuse color when there are none, fill color; shininess maps to roughness
+// and metalness and ao are 0. Indices come back in OptimizeMesh order.
+// Returns false when no triangles load.
+bool ImportGeometry(const char* filename, Geometry& geom);
+
+#endif // MESH_GEN_ENABLED
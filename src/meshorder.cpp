@@ -0,0 +1,504 @@
+#include "meshorder.h"
+
+#if MESH_GEN_ENABLED
+
+#include "meshsimplify.h"
+#include "asserts.h"
+#include "cputimer.h"
+#include "randf.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+
+#define NO_VERTEX           0xffffffffu
+#define FETCH_LINE_SIZE     64
+#define FETCH_CACHE_LINES   64
+
+// ------------------------------------------------------------------------
+
+// FIFO of timestamps: v is cached while fewer than size misses happened since
+// it was loaded. time starts past size so nothing is cached to begin with.
+struct FifoCache
+{
+    u32* m_stamps = nullptr;
+    u32 m_time = 0;
+    u32 m_size = 0;
+
+    FifoCache(const u32 count, const u32 size)
+    {
+        m_stamps = new u32[count];
+        memset(m_stamps, 0, sizeof(u32) * count);
+        m_size = size;
+        m_time = size + 1;
+    }
+    ~FifoCache(){ delete[] m_stamps; }
+    FifoCache(const FifoCache&) = delete;
+    FifoCache& operator=(const FifoCache&) = delete;
+
+    bool cached(const u32 v) const { return m_time - m_stamps[v] <= m_size; }
+    // true on a miss
+    bool access(const u32 v)
+    {
+        if(cached(v))
+            return false;
+        m_stamps[v] = m_time++;
+        return true;
+    }
+};
+
+VertexCacheStats AnalyzeVertexCache(const Geometry& geom, const u32 cache_size, const u32 vertex_size)
+{
+    VertexCacheStats stats;
+    const u32 num_verts = u32(geom.vertices.count());
+    const u32 num_tris = u32(geom.indices.count()) / 3;
+    if(!num_tris || !num_verts)
+        return stats;
+
+    const u32 num_lines = u32((u64(num_verts) * vertex_size + FETCH_LINE_SIZE - 1) / FETCH_LINE_SIZE);
+    FifoCache transform(num_verts, cache_size);
+    FifoCache fetch(num_lines, FETCH_CACHE_LINES);
+    u8* used = new u8[num_verts];
+    memset(used, 0, num_verts);
+
+    u32 misses = 0, lines = 0, num_used = 0;
+    for(u32 i = 0; i < num_tris * 3; ++i)
+    {
+        const u32 v = geom.indices[i];
+        num_used += used[v] ? 0 : 1;
+        used[v] = 1;
+        if(!transform.access(v))
+            continue;
+        ++misses;
+        const u64 begin = u64(v) * vertex_size;
+        for(u64 l = begin / FETCH_LINE_SIZE; l <= (begin + vertex_size - 1) / FETCH_LINE_SIZE; ++l)
+        {
+            lines += fetch.access(u32(l)) ? 1 : 0;
+        }
+    }
+    delete[] used;
+
+    stats.acmr = float(misses) / float(num_tris);
+    stats.atvr = float(misses) / float(num_used);
+    stats.overfetch = float(u64(lines) * FETCH_LINE_SIZE) / float(u64(num_used) * vertex_size);
+    return stats;
+}
+
+// ------------------------------------------------------------------------
+
+static void RasterOverdraw(const vec3* tri, const s32 res, float* depth, u32& shaded)
+{
+    const vec2 a = vec2(tri[0]), b = vec2(tri[1]), c = vec2(tri[2]);
+    const float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if(glm::abs(area) < 1e-12f)
+        return;
+    const float inv = 1.0f / area;
+
+    const vec2 lo = glm::min(a, glm::min(b, c));
+    const vec2 hi = glm::max(a, glm::max(b, c));
+    const s32 x0 = glm::max(s32(glm::ceil(lo.x - 0.5f)), 0);
+    const s32 y0 = glm::max(s32(glm::ceil(lo.y - 0.5f)), 0);
+    const s32 x1 = glm::min(s32(glm::floor(hi.x - 0.5f)), res - 1);
+    const s32 y1 = glm::min(s32(glm::floor(hi.y - 0.5f)), res - 1);
+    for(s32 y = y0; y <= y1; ++y)
+    {
+        for(s32 x = x0; x <= x1; ++x)
+        {
+            const vec2 p = vec2(float(x) + 0.5f, float(y) + 0.5f);
+            const float w0 = ((b.x - p.x) * (c.y - p.y) - (b.y - p.y) * (c.x - p.x)) * inv;
+            const float w1 = ((c.x - p.x) * (a.y - p.y) - (c.y - p.y) * (a.x - p.x)) * inv;
+            const float w2 = 1.0f - w0 - w1;
+            if(w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                continue;
+            const float z = w0 * tri[0].z + w1 * tri[1].z + w2 * tri[2].z;
+            float& d = depth[y * res + x];
+            if(z < d)
+            {
+                d = z;
+                ++shaded;
+            }
+        }
+    }
+}
+
+float AnalyzeOverdraw(const Geometry& geom, const u32 resolution)
+{
+    const s32 num_tris = geom.indices.count() / 3;
+    if(!num_tris)
+        return 0.0f;
+
+    vec3 lo = vec3(FLT_MAX), hi = vec3(-FLT_MAX);
+    for(const MeshVertex& v : geom.vertices)
+    {
+        lo = glm::min(lo, v.position);
+        hi = glm::max(hi, v.position);
+    }
+    const vec3 span = glm::max(hi - lo, vec3(1e-6f));
+    const s32 res = s32(resolution);
+    float* depth = new float[res * res];
+
+    u32 shaded = 0, covered = 0;
+    for(s32 view = 0; view < 6; ++view)
+    {
+        // look down axis, from the positive side when flip
+        const s32 axis = view >> 1;
+        const bool flip = (view & 1) != 0;
+        const s32 u = (axis + 1) % 3, w = (axis + 2) % 3;
+        vec3 dir = vec3(0.0f);
+        dir[axis] = flip ? -1.0f : 1.0f;
+        const float scale = float(res) / glm::max(span[u], span[w]);
+
+        for(s32 i = 0; i < res * res; ++i)
+        {
+            depth[i] = FLT_MAX;
+        }
+        for(s32 t = 0; t < num_tris; ++t)
+        {
+            const MeshVertex& v0 = geom.vertices[geom.indices[t * 3 + 0]];
+            const MeshVertex& v1 = geom.vertices[geom.indices[t * 3 + 1]];
+            const MeshVertex& v2 = geom.vertices[geom.indices[t * 3 + 2]];
+            if(glm::dot(v0.normal + v1.normal + v2.normal, dir) >= 0.0f)
+                continue;
+            vec3 tri[3];
+            const MeshVertex* verts[3] = { &v0, &v1, &v2 };
+            for(s32 k = 0; k < 3; ++k)
+            {
+                const vec3 p = verts[k]->position - lo;
+                tri[k] = vec3(p[u] * scale, p[w] * scale, flip ? span[axis] - p[axis] : p[axis]);
+            }
+            RasterOverdraw(tri, res, depth, shaded);
+        }
+        for(s32 i = 0; i < res * res; ++i)
+        {
+            covered += depth[i] < FLT_MAX ? 1 : 0;
+        }
+    }
+    delete[] depth;
+
+    return covered ? float(shaded) / float(covered) : 0.0f;
+}
+
+// ------------------------------------------------------------------------
+
+// writes the reordered triangles to out; clusters, when given, gets the first
+// triangle after every dead end, where the fan had to jump
+static void Tipsify(const Geometry& geom, const u32 cache_size, u32* out, Vector<u32>* clusters)
+{
+    const u32 num_verts = u32(geom.vertices.count());
+    const u32 num_tris = u32(geom.indices.count()) / 3;
+    const u32* indices = geom.indices.begin();
+
+    // triangles around each vertex
+    u32* offsets = new u32[num_verts + 1];
+    u32* live = new u32[num_verts];
+    u32* adjacency = new u32[num_tris * 3];
+    u8* emitted = new u8[num_tris];
+    memset(live, 0, sizeof(u32) * num_verts);
+    memset(emitted, 0, num_tris);
+    for(u32 i = 0; i < num_tris * 3; ++i)
+    {
+        ++live[indices[i]];
+    }
+    offsets[0] = 0;
+    for(u32 v = 0; v < num_verts; ++v)
+    {
+        offsets[v + 1] = offsets[v] + live[v];
+    }
+    for(u32 i = 0; i < num_tris * 3; ++i)
+    {
+        adjacency[offsets[indices[i]]++] = i / 3;
+    }
+    for(u32 v = num_verts; v > 0; --v)
+    {
+        offsets[v] = offsets[v - 1];
+    }
+    offsets[0] = 0;
+
+    FifoCache cache(num_verts, cache_size);
+    Vector<u32> dead_end;
+    Vector<u32> candidates;
+    u32 cursor = 0;
+    u32 num_out = 0;
+    u32 fan = num_verts ? 0 : NO_VERTEX;
+    if(clusters)
+    {
+        clusters->clear();
+    }
+    while(fan != NO_VERTEX)
+    {
+        candidates.clear();
+        for(u32 k = offsets[fan]; k < offsets[fan + 1]; ++k)
+        {
+            const u32 t = adjacency[k];
+            if(emitted[t])
+                continue;
+            emitted[t] = 1;
+            for(u32 c = 0; c < 3; ++c)
+            {
+                const u32 v = indices[t * 3 + c];
+                out[num_out++] = v;
+                dead_end.grow() = v;
+                candidates.grow() = v;
+                --live[v];
+                cache.access(v);
+            }
+        }
+
+        // the oldest neighbour that stays cached while its fan is drawn, any
+        // neighbour with triangles left when none would
+        u32 next = NO_VERTEX;
+        s32 best = -1;
+        for(const u32 v : candidates)
+        {
+            if(!live[v])
+                continue;
+            const u32 age = cache.m_time - cache.m_stamps[v];
+            const s32 priority = age + 2 * live[v] <= cache_size ? s32(age) : 0;
+            if(priority > best)
+            {
+                best = priority;
+                next = v;
+            }
+        }
+        // dead end: the most recently used vertex with triangles left, else
+        // the next one in input order
+        if(next == NO_VERTEX)
+        {
+            while(next == NO_VERTEX && dead_end.count())
+            {
+                const u32 v = dead_end.pop();
+                next = live[v] ? v : NO_VERTEX;
+            }
+            while(next == NO_VERTEX && cursor < num_verts)
+            {
+                next = live[cursor] ? cursor : NO_VERTEX;
+                ++cursor;
+            }
+            if(clusters && next != NO_VERTEX)
+            {
+                clusters->grow() = num_out / 3;
+            }
+        }
+        fan = next;
+    }
+    Assert(num_out == num_tris * 3);
+
+    delete[] emitted;
+    delete[] adjacency;
+    delete[] live;
+    delete[] offsets;
+}
+
+void OptimizeVertexCache(Geometry& geom, const u32 cache_size)
+{
+    if(!geom.indices.count())
+        return;
+    u32* out = new u32[geom.indices.count()];
+    Tipsify(geom, cache_size, out, nullptr);
+    memcpy(geom.indices.begin(), out, sizeof(u32) * geom.indices.count());
+    delete[] out;
+}
+
+struct ClusterKey
+{
+    float key;
+    u32 cluster;
+    bool operator<(const ClusterKey& o) const
+    {
+        return key > o.key;
+    }
+};
+
+void OptimizeOverdraw(Geometry& geom, const u32 cache_size, const float threshold)
+{
+    const u32 num_tris = u32(geom.indices.count()) / 3;
+    if(!num_tris)
+        return;
+    u32* order = new u32[num_tris * 3];
+    Vector<u32> hard;
+    Tipsify(geom, cache_size, order, &hard);
+    hard.grow() = num_tris;
+
+    // soft boundaries: a hard cluster ends early wherever its ACMR so far
+    // comes within threshold of the whole cluster's. Every piece is simulated
+    // from a cold cache, as it may draw after any other once sorted, so
+    // pieces only get as small as their cache warm up allows.
+    Vector<u32> clusters;
+    FifoCache cache(u32(geom.vertices.count()), cache_size);
+    u32 begin = 0;
+    for(const u32 end : hard)
+    {
+        u32 misses = 0;
+        for(u32 i = begin * 3; i < end * 3; ++i)
+        {
+            misses += cache.access(order[i]) ? 1 : 0;
+        }
+        const float limit = threshold * float(misses) / float(end - begin);
+        cache.m_time += cache_size + 1;
+
+        clusters.grow() = begin;
+        u32 size = 0;
+        misses = 0;
+        for(u32 t = begin; t < end; ++t)
+        {
+            for(u32 c = 0; c < 3; ++c)
+            {
+                misses += cache.access(order[t * 3 + c]) ? 1 : 0;
+            }
+            ++size;
+            if(t + 1 < end && float(misses) <= limit * float(size))
+            {
+                clusters.grow() = t + 1;
+                misses = 0;
+                size = 0;
+                cache.m_time += cache_size + 1;
+            }
+        }
+        cache.m_time += cache_size + 1;
+        begin = end;
+    }
+    clusters.grow() = num_tris;
+
+    // area weighted centroid of the mesh and centroid and normal of every
+    // cluster; clusters facing away from the middle from far out draw first
+    const s32 num_clusters = clusters.count() - 1;
+    vec3* centers = new vec3[num_clusters];
+    vec3* normals = new vec3[num_clusters];
+    vec3 mesh_center = vec3(0.0f);
+    float mesh_area = 0.0f;
+    for(s32 k = 0; k < num_clusters; ++k)
+    {
+        vec3 center = vec3(0.0f), normal = vec3(0.0f);
+        float area = 0.0f;
+        for(u32 t = clusters[k]; t < clusters[k + 1]; ++t)
+        {
+            const vec3& a = geom.vertices[order[t * 3 + 0]].position;
+            const vec3& b = geom.vertices[order[t * 3 + 1]].position;
+            const vec3& c = geom.vertices[order[t * 3 + 2]].position;
+            const vec3 n = glm::cross(b - a, c - a);
+            const float A = glm::length(n);
+            center += (a + b + c) * (A / 3.0f);
+            area += A;
+            // winding is not consistent across meshers, the vertex normals are
+            const vec3 N = geom.vertices[order[t * 3 + 0]].normal + geom.vertices[order[t * 3 + 1]].normal
+                + geom.vertices[order[t * 3 + 2]].normal;
+            normal += glm::dot(n, N) < 0.0f ? -n : n;
+        }
+        mesh_center += center;
+        mesh_area += area;
+        centers[k] = area > 0.0f ? center / area : geom.vertices[order[clusters[k] * 3]].position;
+        normals[k] = normal;
+    }
+    mesh_center = mesh_area > 0.0f ? mesh_center / mesh_area : vec3(0.0f);
+
+    ClusterKey* keys = new ClusterKey[num_clusters];
+    for(s32 k = 0; k < num_clusters; ++k)
+    {
+        const float len = glm::length(normals[k]);
+        keys[k].key = len > 0.0f ? glm::dot(centers[k] - mesh_center, normals[k] / len) : -FLT_MAX;
+        keys[k].cluster = u32(k);
+    }
+    std::stable_sort(keys, keys + num_clusters);
+
+    u32 n = 0;
+    for(s32 k = 0; k < num_clusters; ++k)
+    {
+        const u32 cluster = keys[k].cluster;
+        for(u32 i = clusters[cluster] * 3; i < clusters[cluster + 1] * 3; ++i)
+        {
+            geom.indices[n++] = order[i];
+        }
+    }
+
+    delete[] keys;
+    delete[] normals;
+    delete[] centers;
+    delete[] order;
+}
+
+void OptimizeVertexFetch(Geometry& geom)
+{
+    const s32 num_verts = geom.vertices.count();
+    if(!geom.indices.count())
+        return;
+    u32* remap = new u32[num_verts];
+    memset(remap, 0xff, sizeof(u32) * num_verts);
+
+    Vector<MeshVertex> vertices;
+    vertices.resize(num_verts);
+    for(u32& idx : geom.indices)
+    {
+        if(remap[idx] == NO_VERTEX)
+        {
+            remap[idx] = u32(vertices.count());
+            vertices.grow() = geom.vertices[idx];
+        }
+        idx = remap[idx];
+    }
+    geom.vertices = vertices;
+    delete[] remap;
+}
+
+void OptimizeMesh(Geometry& geom)
+{
+    OptimizeOverdraw(geom);
+    OptimizeVertexFetch(geom);
+}
+
+// ------------------------------------------------------------------------
+
+static void ReportOrder(const char* name, const char* pass, const Geometry& geom, const double ms)
+{
+    const VertexCacheStats stats = AnalyzeVertexCache(geom);
+    printf("[MeshOrder] %-10s %-9s %7d tris: acmr %.3f, atvr %.3f, overfetch %.2f, overdraw %.3f, %7.2f ms\n",
+        name, pass, geom.indices.count() / 3, stats.acmr, stats.atvr, stats.overfetch, AnalyzeOverdraw(geom), ms);
+}
+
+static void BenchOrder(const char* name, const Geometry& source)
+{
+    ReportOrder(name, "input", source, 0.0);
+
+    Geometry geom = source;
+    CPUTimer timer;
+    OptimizeVertexCache(geom);
+    ReportOrder(name, "cache", geom, timer.ms());
+
+    geom = source;
+    timer.begin();
+    OptimizeOverdraw(geom);
+    ReportOrder(name, "overdraw", geom, timer.ms());
+
+    timer.begin();
+    OptimizeVertexFetch(geom);
+    ReportOrder(name, "fetch", geom, timer.ms());
+}
+
+void MeshOrderBench()
+{
+    MeshTask task;
+    for(u32 i = 0; i < 12; ++i)
+    {
+        SDF& sdf = task.sdfs.grow();
+        sdf.type = (i & 1) ? SDF_SPHERE : SDF_BOX;
+        sdf.translation = vec3(randf(), randf(), randf()) * 4.0f - 2.0f;
+        sdf.material.setColor(vec3(randf(), randf(), randf()));
+    }
+    task.center = vec3(0.0f);
+    task.radius = 4.0f;
+
+    task.max_depth = 8;
+    GenerateMeshDC(task);
+    BenchOrder("dc", task.geom);
+
+    Geometry simple;
+    SimplifyMesh(task.geom, simple, 0.25f, SimplifyParams());
+    BenchOrder("simplified", simple);
+
+    task.max_depth = 6;
+    task.triangles = true;
+    GenerateMesh(task);
+    WeldGeometry(task.geom);
+    BenchOrder("tetrahedra", task.geom);
+}
+
+#endif // MESH_GEN_ENABLED
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "meshgen.h"
+
+#if MESH_GEN_ENABLED
+
+// Index and vertex order for indexed Geometry.
+// OptimizeVertexCache is Tipsify (Sander, Nehab & Barczak 2007): it fans
+// around one vertex at a time and moves to whichever neighbour is still in a
+// FIFO post-transform cache of cache_size entries, in time linear in the
+// triangle count. OptimizeOverdraw cuts that order into clusters whose ACMR
+// stays within threshold of their own and sorts the clusters outermost first,
+// so triangles likely to occlude the rest of the mesh draw before it.
+// OptimizeVertexFetch renumbers vertices in first use order so fetches walk
+// the vertex buffer forward; vertices no triangle uses are dropped.
+
+#define VERTEX_CACHE_SIZE   16
+
+struct VertexCacheStats
+{
+    float acmr = 0.0f;          // transformed vertices per triangle, 0.5 at best
+    float atvr = 0.0f;          // transformed vertices per used vertex, 1 at best
+    float overfetch = 0.0f;     // bytes read over bytes of used vertices, 1 at best
+};
+
+// FIFO post-transform cache of cache_size vertices feeding from 64 byte lines
+VertexCacheStats AnalyzeVertexCache(const Geometry& geom, const u32 cache_size = VERTEX_CACHE_SIZE,
+    const u32 vertex_size = sizeof(MeshVertex));
+// shaded over covered pixels of a depth tested, back face culled raster from
+// the six axis directions at resolution squared; 1 at best
+float AnalyzeOverdraw(const Geometry& geom, const u32 resolution = 256);
+
+void OptimizeVertexCache(Geometry& geom, const u32 cache_size = VERTEX_CACHE_SIZE);
+// vertex cache order as above, reordered by cluster
+void OptimizeOverdraw(Geometry& geom, const u32 cache_size = VERTEX_CACHE_SIZE, const float threshold = 1.05f);
+void OptimizeVertexFetch(Geometry& geom);
+// overdraw then fetch order, the usual pass before upload
+void OptimizeMesh(Geometry& geom);
+
+// the above on dual contoured, welded tetrahedra and simplified meshes
+void MeshOrderBench();
+
+#endif // MESH_GEN_ENABLED
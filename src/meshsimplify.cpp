@@ -0,0 +1,1043 @@
+#include "meshsimplify.h"
+
+#if MESH_GEN_ENABLED
+
+#include "asserts.h"
+#include "parallelfor.h"
+#include "cputimer.h"
+#include "randf.h"
+#include "splat.h"
+#include "meshorder.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <atomic>
+
+#define VF_LOCKED           1
+#define VF_BOUNDARY         2
+#define VF_REMOVED          4
+
+#define NO_CORNER           0xffffffffu
+#define NO_BUCKET           0xffffffffu
+
+// constraint planes on open edges count this many times a face plane
+#define BOUNDARY_WEIGHT     16.0
+
+// ------------------------------------------------------------------------
+
+struct WeldKey
+{
+    s32 x, y, z;
+    u32 vertex;
+
+    bool operator<(const WeldKey& o) const
+    {
+        if(x != o.x) return x < o.x;
+        if(y != o.y) return y < o.y;
+        if(z != o.z) return z < o.z;
+        return vertex < o.vertex;
+    }
+    bool samePosition(const WeldKey& o) const
+    {
+        return x == o.x && y == o.y && z == o.z;
+    }
+};
+
+static s32 WeldCoord(const float x, const double inv)
+{
+    const double q = glm::floor(double(x) * inv + 0.5);
+    return s32(glm::clamp(q, -2147483647.0, 2147483647.0));
+}
+
+static bool SameAttributes(const MeshVertex& a, const MeshVertex& b)
+{
+    return glm::dot(a.normal, b.normal) > 0.99f
+        && glm::all(glm::lessThan(glm::abs(a.color - b.color), vec3(0.01f)))
+        && glm::all(glm::lessThan(glm::abs(a.material - b.material), vec3(0.01f)));
+}
+
+// seams, when given, gets one flag per output vertex telling whether another
+// vertex shares its position
+static void Weld(Geometry& geom, const float weld_distance, Vector<u8>* seams)
+{
+    const bool indexed = geom.indices.count() > 0;
+    const s32 num_verts = geom.vertices.count();
+    const double inv = 1.0 / double(weld_distance);
+
+    WeldKey* keys = new WeldKey[num_verts];
+    for(s32 i = 0; i < num_verts; ++i)
+    {
+        const vec3& p = geom.vertices[i].position;
+        keys[i] = { WeldCoord(p.x, inv), WeldCoord(p.y, inv), WeldCoord(p.z, inv), u32(i) };
+    }
+    std::sort(keys, keys + num_verts);
+
+    u32* remap = new u32[num_verts];
+    Vector<MeshVertex> vertices;
+    vertices.resize(num_verts);
+    if(seams)
+    {
+        seams->clear();
+        seams->resize(num_verts);
+    }
+    for(s32 i = 0; i < num_verts; )
+    {
+        s32 end = i + 1;
+        while(end < num_verts && keys[end].samePosition(keys[i]))
+        {
+            ++end;
+        }
+        const s32 first = vertices.count();
+        for(s32 k = i; k < end; ++k)
+        {
+            const MeshVertex& v = geom.vertices[keys[k].vertex];
+            s32 match = -1;
+            for(s32 m = first; m < vertices.count() && match == -1; ++m)
+            {
+                match = SameAttributes(vertices[m], v) ? m : -1;
+            }
+            if(match == -1)
+            {
+                match = vertices.count();
+                vertices.grow() = v;
+            }
+            remap[keys[k].vertex] = u32(match);
+        }
+        if(seams)
+        {
+            for(s32 m = first; m < vertices.count(); ++m)
+            {
+                seams->grow() = vertices.count() - first > 1 ? 1 : 0;
+            }
+        }
+        i = end;
+    }
+
+    const s32 num_corners = indexed ? geom.indices.count() : num_verts - num_verts % 3;
+    Vector<u32> indices;
+    indices.resize(num_corners);
+    for(s32 c = 0; c < num_corners; c += 3)
+    {
+        u32 t[3];
+        for(s32 k = 0; k < 3; ++k)
+        {
+            t[k] = remap[indexed ? geom.indices[c + k] : u32(c + k)];
+        }
+        if(t[0] != t[1] && t[1] != t[2] && t[2] != t[0])
+        {
+            indices.grow() = t[0];
+            indices.grow() = t[1];
+            indices.grow() = t[2];
+        }
+    }
+
+    geom.vertices = vertices;
+    geom.indices = indices;
+    delete[] keys;
+    delete[] remap;
+}
+
+void WeldGeometry(Geometry& geom, const float weld_distance)
+{
+    Weld(geom, weld_distance, nullptr);
+}
+
+// ------------------------------------------------------------------------
+
+struct Quadric
+{
+    double m[10];   // a2 ab ac ad b2 bc bd c2 cd d2
+
+    void clear()
+    {
+        for(double& x : m)
+            x = 0.0;
+    }
+    void addPlane(const glm::dvec3& n, const double d, const double w)
+    {
+        m[0] += w * n.x * n.x; m[1] += w * n.x * n.y; m[2] += w * n.x * n.z; m[3] += w * n.x * d;
+        m[4] += w * n.y * n.y; m[5] += w * n.y * n.z; m[6] += w * n.y * d;
+        m[7] += w * n.z * n.z; m[8] += w * n.z * d;
+        m[9] += w * d * d;
+    }
+    void add(const Quadric& o)
+    {
+        for(u32 i = 0; i < 10; ++i)
+            m[i] += o.m[i];
+    }
+    double eval(const vec3& v) const
+    {
+        const double x = v.x, y = v.y, z = v.z;
+        return m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x
+            + m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y
+            + m[7] * z * z + 2.0 * m[8] * z
+            + m[9];
+    }
+    // minimiser, when the planes pin down a point
+    bool solve(vec3& p) const
+    {
+        const glm::dmat3 A(m[0], m[1], m[2], m[1], m[4], m[5], m[2], m[5], m[7]);
+        const double det = glm::determinant(A);
+        const double scale = m[0] + m[4] + m[7];
+        if(glm::abs(det) <= 1e-6 * scale * scale * scale)
+            return false;
+        p = vec3(glm::inverse(A) * -glm::dvec3(m[3], m[6], m[8]));
+        return true;
+    }
+};
+
+struct Collapse
+{
+    vec3 position;
+    float cost;
+    u32 keep, drop;
+    u32 keep_stamp, drop_stamp;
+};
+
+// the heap only moves cost and an index into the collapse pool, which keeps
+// its pops in cache on million edge meshes
+struct HeapEntry
+{
+    float cost;
+    u32 collapse;
+
+    // std heaps keep the largest on top, so invert to pop the cheapest
+    bool operator<(const HeapEntry& o) const { return cost > o.cost; }
+};
+
+// triangles are the corners of geom.indices; every vertex threads its corners
+// into a list so collapses can splice one vertex's list onto another's.
+// Triangles that die stay in their other vertices' lists until those get
+// walked by a collapse.
+struct SimplifyState
+{
+    Geometry geom;
+    Vector<u8> seams;
+    Quadric* quadrics = nullptr;
+    u32* first = nullptr;       // first corner around every vertex
+    u32* next = nullptr;        // next corner around the same vertex
+    u32* stamp = nullptr;       // bumped whenever a vertex moves or dies
+    u32* bucket = nullptr;      // NO_BUCKET once a vertex touches another bucket
+    u8* flags = nullptr;
+    u8* dead = nullptr;         // per triangle
+    u32 num_verts = 0;
+    u32 num_tris = 0;
+    u32 live_tris = 0;
+    double max_cost = 0.0;
+
+    ~SimplifyState()
+    {
+        delete[] quadrics;
+        delete[] first;
+        delete[] next;
+        delete[] stamp;
+        delete[] bucket;
+        delete[] flags;
+        delete[] dead;
+    }
+    const vec3& position(const u32 v) const { return geom.vertices[s32(v)].position; }
+    u32 corner(const u32 c) const { return geom.indices[s32(c)]; }
+};
+
+struct SimplifyScratch
+{
+    Vector<Collapse> collapses;
+    Vector<HeapEntry> heap;
+    Vector<u32> ring0;
+    Vector<u32> ring1;
+    Vector<float> border_costs;
+
+    void clear()
+    {
+        collapses.clear();
+        heap.clear();
+        border_costs.clear();
+    }
+    void add(const Collapse& c)
+    {
+        HeapEntry& e = heap.grow();
+        e.cost = c.cost;
+        e.collapse = u32(collapses.count());
+        collapses.grow() = c;
+    }
+};
+
+// fn(triangle, b, c) for every live triangle around v, b and c following v
+// in winding order
+template<typename Fn>
+static void ForTris(const SimplifyState& s, const u32 v, Fn fn)
+{
+    for(u32 c = s.first[v]; c != NO_CORNER; c = s.next[c])
+    {
+        const u32 t = c / 3;
+        if(s.dead[t])
+            continue;
+        const u32 k = c - t * 3;
+        fn(t, s.corner(t * 3 + (k + 1) % 3), s.corner(t * 3 + (k + 2) % 3));
+    }
+}
+
+// sorted and unique, so two rings intersect in one merge
+static void Ring(const SimplifyState& s, const u32 v, Vector<u32>& ring)
+{
+    ring.clear();
+    ForTris(s, v, [&](u32, u32 b, u32 c)
+    {
+        ring.grow() = b;
+        ring.grow() = c;
+    });
+    std::sort(ring.begin(), ring.end());
+    const s32 count = s32(std::unique(ring.begin(), ring.end()) - ring.begin());
+    while(ring.count() > count)
+    {
+        ring.pop();
+    }
+}
+
+static bool Evaluate(const SimplifyState& s, const u32 a, const u32 b, Collapse& col)
+{
+    const u8 fa = s.flags[a];
+    const u8 fb = s.flags[b];
+    if((fa & fb & VF_LOCKED) || ((fa | fb) & VF_REMOVED))
+        return false;
+
+    Quadric q = s.quadrics[a];
+    q.add(s.quadrics[b]);
+    const vec3& pa = s.position(a);
+    const vec3& pb = s.position(b);
+    col.keep = a;
+    col.drop = b;
+    if(fa & VF_LOCKED)
+    {
+        col.position = pa;
+    }
+    else if(fb & VF_LOCKED)
+    {
+        col.keep = b;
+        col.drop = a;
+        col.position = pb;
+    }
+    else
+    {
+        // ties go to the earlier candidate; on flat patches every candidate
+        // is free and taking an endpoint would pile fans onto one vertex
+        const vec3 mid = (pa + pb) * 0.5f;
+        vec3 candidates[4] = { mid, mid, pa, pb };
+        vec3 opt;
+        if(q.solve(opt) && glm::distance(opt, mid) <= glm::distance(pa, pb))
+        {
+            candidates[0] = opt;
+        }
+        double best = DBL_MAX;
+        for(u32 i = 0; i < 4; ++i)
+        {
+            const double cost = q.eval(candidates[i]);
+            if(cost < best)
+            {
+                best = cost;
+                col.position = candidates[i];
+            }
+        }
+    }
+    col.cost = float(glm::max(q.eval(col.position), 0.0));
+    col.keep_stamp = s.stamp[col.keep];
+    col.drop_stamp = s.stamp[col.drop];
+    return true;
+}
+
+// number of triangles the collapse removes, 0 when it would pinch the
+// surface, flip a triangle or tear a boundary
+static u32 CheckCollapse(const SimplifyState& s, const Collapse& col, SimplifyScratch& scratch)
+{
+    const u32 keep = col.keep;
+    const u32 drop = col.drop;
+    u32 shared = 0;
+    ForTris(s, drop, [&](u32, u32 b, u32 c)
+    {
+        shared += (b == keep || c == keep) ? 1 : 0;
+    });
+    if(!shared)
+        return 0;
+    // two boundary vertices joined through the inside
+    if((s.flags[keep] & s.flags[drop] & VF_BOUNDARY) && shared != 1)
+        return 0;
+
+    // no face around the pair may turn over
+    bool ok = true;
+    auto flips = [&](const u32 v, const u32 other)
+    {
+        ForTris(s, v, [&](u32, u32 b, u32 c)
+        {
+            if(!ok || b == other || c == other)
+                return;
+            const vec3& p1 = s.position(b);
+            const vec3& p2 = s.position(c);
+            const vec3 n0 = glm::cross(p1 - s.position(v), p2 - s.position(v));
+            const vec3 n1 = glm::cross(p1 - col.position, p2 - col.position);
+            const float l0 = glm::length(n0);
+            if(l0 > 0.0f && glm::dot(n0, n1) <= 0.2f * l0 * glm::length(n1))
+                ok = false;
+        });
+    };
+    flips(drop, keep);
+    flips(keep, drop);
+    if(!ok)
+        return 0;
+
+    // link condition: the only common neighbours are the shared triangles' apexes
+    Ring(s, keep, scratch.ring0);
+    Ring(s, drop, scratch.ring1);
+    u32 common = 0;
+    for(s32 i = 0, j = 0; i < scratch.ring0.count() && j < scratch.ring1.count(); )
+    {
+        const u32 a = scratch.ring0[i];
+        const u32 b = scratch.ring1[j];
+        common += a == b ? 1 : 0;
+        i += a <= b ? 1 : 0;
+        j += b <= a ? 1 : 0;
+    }
+    return common == shared ? shared : 0;
+}
+
+static u32 ApplyCollapse(SimplifyState& s, const Collapse& col)
+{
+    const u32 keep = col.keep;
+    const u32 drop = col.drop;
+
+    u32 removed = 0;
+    u32 tail = NO_CORNER;
+    for(u32 c = s.first[drop]; c != NO_CORNER; c = s.next[c])
+    {
+        const u32 t = c / 3;
+        if(!s.dead[t])
+        {
+            const u32 k = c - t * 3;
+            if(s.corner(t * 3 + (k + 1) % 3) == keep || s.corner(t * 3 + (k + 2) % 3) == keep)
+            {
+                s.dead[t] = 1;
+                ++removed;
+            }
+            else
+            {
+                s.geom.indices[s32(c)] = keep;
+            }
+        }
+        tail = c;
+    }
+    if(tail != NO_CORNER)
+    {
+        s.next[tail] = s.first[keep];
+        s.first[keep] = s.first[drop];
+        s.first[drop] = NO_CORNER;
+    }
+    for(u32* link = &s.first[keep]; *link != NO_CORNER; )
+    {
+        if(s.dead[*link / 3])
+            *link = s.next[*link];
+        else
+            link = &s.next[*link];
+    }
+
+    MeshVertex& vk = s.geom.vertices[s32(keep)];
+    const MeshVertex& vd = s.geom.vertices[s32(drop)];
+    const vec3 e = vd.position - vk.position;
+    const float len2 = glm::dot(e, e);
+    const float t = len2 > 0.0f ? glm::clamp(glm::dot(col.position - vk.position, e) / len2, 0.0f, 1.0f) : 0.0f;
+    const vec3 N = glm::mix(vk.normal, vd.normal, t);
+    if(glm::dot(N, N) > 0.0f)
+    {
+        vk.normal = glm::normalize(N);
+    }
+    vk.color = glm::mix(vk.color, vd.color, t);
+    vk.material = glm::mix(vk.material, vd.material, t);
+    vk.position = col.position;
+
+    s.quadrics[keep].add(s.quadrics[drop]);
+    s.flags[keep] |= s.flags[drop] & VF_BOUNDARY;
+    s.flags[drop] |= VF_REMOVED;
+    ++s.stamp[keep];
+    ++s.stamp[drop];
+    return removed;
+}
+
+// pops collapses until budget triangles are gone or the next one costs more
+// than max_cost; bucketed keeps new edges inside the keep vertex's bucket.
+// buckets share one budget, so they may overshoot it by a collapse each.
+static u32 RunHeap(SimplifyState& s, SimplifyScratch& scratch, std::atomic<s32>& budget,
+    const double max_cost, const bool bucketed, double& worst)
+{
+    Vector<HeapEntry>& heap = scratch.heap;
+    std::make_heap(heap.begin(), heap.end());
+    u32 removed = 0;
+    while(budget > 0 && heap.count())
+    {
+        std::pop_heap(heap.begin(), heap.end());
+        const Collapse col = scratch.collapses[s32(heap.pop().collapse)];
+        if(col.cost > max_cost)
+            break;
+        if(s.stamp[col.keep] != col.keep_stamp || s.stamp[col.drop] != col.drop_stamp)
+            continue;
+        if(!CheckCollapse(s, col, scratch))
+            continue;
+
+        const u32 dead = ApplyCollapse(s, col);
+        removed += dead;
+        budget -= s32(dead);
+        worst = glm::max(worst, double(col.cost));
+
+        Ring(s, col.keep, scratch.ring0);
+        for(const u32 n : scratch.ring0)
+        {
+            if(bucketed && s.bucket[n] != s.bucket[col.keep])
+                continue;
+            Collapse c;
+            if(Evaluate(s, col.keep, n, c) && c.cost <= max_cost)
+            {
+                scratch.add(c);
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+    }
+    return removed;
+}
+
+// ------------------------------------------------------------------------
+
+Simplifier::~Simplifier()
+{
+    delete m_state;
+}
+
+void Simplifier::init(const Geometry& geom)
+{
+    delete m_state;
+    m_state = new SimplifyState;
+    SimplifyState& s = *m_state;
+    s.geom.vertices = geom.vertices;
+    s.geom.indices = geom.indices;
+    Weld(s.geom, 1e-5f, &s.seams);
+
+    s.num_verts = u32(s.geom.vertices.count());
+    s.num_tris = u32(s.geom.indices.count()) / 3;
+    s.live_tris = s.num_tris;
+    s.max_cost = 0.0;
+    s.quadrics = new Quadric[s.num_verts];
+    s.first = new u32[s.num_verts];
+    s.next = new u32[s.num_tris * 3];
+    s.stamp = new u32[s.num_verts];
+    s.bucket = new u32[s.num_verts];
+    s.flags = new u8[s.num_verts];
+    s.dead = new u8[s.num_tris];
+    for(u32 v = 0; v < s.num_verts; ++v)
+    {
+        s.first[v] = NO_CORNER;
+        s.stamp[v] = 0;
+        s.flags[v] = s.seams[s32(v)] ? VF_LOCKED : 0;
+    }
+    for(u32 c = s.num_tris * 3; c-- > 0; )
+    {
+        const u32 v = s.corner(c);
+        s.next[c] = s.first[v];
+        s.first[v] = c;
+    }
+    for(u32 t = 0; t < s.num_tris; ++t)
+    {
+        s.dead[t] = 0;
+    }
+
+    // face planes, plus a constraint plane along every open edge; an edge
+    // with more than two faces locks its vertices
+    const u32 block = 4096;
+    ParallelForStealing((s.num_verts + block - 1) / block, 0, [&](u32 index, u32)
+    {
+        const u32 end = glm::min(s.num_verts, (index + 1) * block);
+        for(u32 v = index * block; v < end; ++v)
+        {
+            Quadric& q = s.quadrics[v];
+            q.clear();
+            const glm::dvec3 p0 = glm::dvec3(s.position(v));
+            ForTris(s, v, [&](u32, u32 b, u32 c)
+            {
+                const glm::dvec3 p1 = glm::dvec3(s.position(b));
+                const glm::dvec3 p2 = glm::dvec3(s.position(c));
+                const glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+                const double len = glm::length(n);
+                if(len <= 0.0)
+                    return;
+                const glm::dvec3 N = n / len;
+                q.addPlane(N, -glm::dot(N, p0), 1.0);
+
+                // v->b leaves v in this triangle, c->v enters it
+                const u32 ends[2] = { b, c };
+                for(const u32 other : ends)
+                {
+                    u32 faces = 0;
+                    ForTris(s, v, [&](u32, u32 b2, u32 c2)
+                    {
+                        faces += (b2 == other || c2 == other) ? 1 : 0;
+                    });
+                    if(faces > 2)
+                    {
+                        s.flags[v] |= VF_LOCKED;
+                    }
+                    else if(faces == 1)
+                    {
+                        s.flags[v] |= VF_BOUNDARY;
+                        const glm::dvec3 edge = glm::dvec3(s.position(other)) - p0;
+                        const glm::dvec3 side = glm::cross(edge, N);
+                        const double side_len = glm::length(side);
+                        if(side_len > 0.0)
+                        {
+                            q.addPlane(side / side_len, -glm::dot(side / side_len, p0), BOUNDARY_WEIGHT);
+                        }
+                    }
+                }
+            });
+        }
+    });
+}
+
+u32 Simplifier::simplify(const u32 target_tris, const SimplifyParams& params)
+{
+    Assert(m_state);
+    SimplifyState& s = *m_state;
+    if(s.live_tris <= target_tris)
+        return s.live_tris;
+
+    const double max_cost = double(params.max_error) * double(params.max_error);
+    const u32 num_threads = ResolveThreadCount(params.num_threads);
+
+    // unlink the corners of triangles that died since the last call
+    const u32 block = 4096;
+    ParallelForStealing((s.num_verts + block - 1) / block, num_threads, [&](u32 index, u32)
+    {
+        const u32 end = glm::min(s.num_verts, (index + 1) * block);
+        for(u32 v = index * block; v < end; ++v)
+        {
+            for(u32* link = &s.first[v]; *link != NO_CORNER; )
+            {
+                if(s.dead[*link / 3])
+                    *link = s.next[*link];
+                else
+                    link = &s.next[*link];
+            }
+        }
+    });
+
+    // parallel rounds: buckets on a grid collapse edges whose ends only touch
+    // triangles of their own bucket. A round only takes edges up to the cost
+    // of the cheapest collapses the whole mesh still needs, border edges
+    // included, so buckets follow roughly the order one global heap would
+    // and don't eat into costly interior edges while cheap ones wait on a
+    // border.
+    if(num_threads > 1 && s.live_tris > 4096)
+    {
+        vec3 lo = vec3(FLT_MAX), hi = vec3(-FLT_MAX);
+        for(u32 v = 0; v < s.num_verts; ++v)
+        {
+            if(!(s.flags[v] & VF_REMOVED))
+            {
+                lo = glm::min(lo, s.position(v));
+                hi = glm::max(hi, s.position(v));
+            }
+        }
+        const s32 grid = s32(glm::ceil(glm::pow(float(num_threads * 4), 1.0f / 3.0f)));
+        const u32 num_buckets = u32(grid * grid * grid);
+        const vec3 scale = float(grid) / glm::max(hi - lo, vec3(1e-6f));
+        for(u32 v = 0; v < s.num_verts; ++v)
+        {
+            const ivec3 cell = glm::clamp(ivec3((s.position(v) - lo) * scale), ivec3(0), ivec3(grid - 1));
+            s.bucket[v] = (s.flags[v] & VF_REMOVED) ? NO_BUCKET : u32((cell.z * grid + cell.y) * grid + cell.x);
+        }
+        u8* border = new u8[s.num_verts];
+        for(u32 v = 0; v < s.num_verts; ++v)
+        {
+            border[v] = 0;
+        }
+        for(u32 t = 0; t < s.num_tris; ++t)
+        {
+            const u32 a = s.corner(t * 3), b = s.corner(t * 3 + 1), c = s.corner(t * 3 + 2);
+            if(!s.dead[t] && (s.bucket[a] != s.bucket[b] || s.bucket[a] != s.bucket[c]))
+                border[a] = border[b] = border[c] = 1;
+        }
+
+        // interior vertices grouped by bucket
+        u32* offsets = new u32[num_buckets + 1];
+        for(u32 b = 0; b <= num_buckets; ++b)
+        {
+            offsets[b] = 0;
+        }
+        Vector<u32> borders;
+        for(u32 v = 0; v < s.num_verts; ++v)
+        {
+            if(border[v])
+            {
+                s.bucket[v] = NO_BUCKET;
+                borders.grow() = v;
+            }
+            if(s.bucket[v] != NO_BUCKET)
+                ++offsets[s.bucket[v] + 1];
+        }
+        for(u32 b = 0; b < num_buckets; ++b)
+        {
+            offsets[b + 1] += offsets[b];
+        }
+        u32* order = new u32[offsets[num_buckets]];
+        for(u32 v = 0; v < s.num_verts; ++v)
+        {
+            if(s.bucket[v] != NO_BUCKET)
+                order[offsets[s.bucket[v]]++] = v;
+        }
+        for(u32 b = num_buckets; b > 0; --b)
+        {
+            offsets[b] = offsets[b - 1];
+        }
+        offsets[0] = 0;
+        delete[] border;
+
+        SimplifyScratch* buckets = new SimplifyScratch[num_buckets];
+        double* worst = new double[num_buckets];
+        Vector<float> costs;
+        for(u32 round = 0; round < 8 && s.live_tris > target_tris; ++round)
+        {
+            const u32 needed = s.live_tris - target_tris;
+            ParallelForStealing(num_buckets, num_threads, [&](u32 b, u32)
+            {
+                SimplifyScratch& sc = buckets[b];
+                sc.clear();
+                worst[b] = 0.0;
+                for(u32 i = offsets[b]; i < offsets[b + 1]; ++i)
+                {
+                    const u32 v = order[i];
+                    Ring(s, v, sc.ring0);
+                    for(const u32 n : sc.ring0)
+                    {
+                        Collapse c;
+                        if(n > v && s.bucket[n] == b && Evaluate(s, v, n, c) && c.cost <= max_cost)
+                            sc.add(c);
+                    }
+                }
+                // costs only: each edge with a border end, counted once
+                const u32 first = u32(u64(borders.count()) * b / num_buckets);
+                const u32 last = u32(u64(borders.count()) * (b + 1) / num_buckets);
+                for(u32 i = first; i < last; ++i)
+                {
+                    const u32 v = borders[i];
+                    Ring(s, v, sc.ring0);
+                    for(const u32 n : sc.ring0)
+                    {
+                        Collapse c;
+                        if((n > v || s.bucket[n] != NO_BUCKET) && Evaluate(s, v, n, c) && c.cost <= max_cost)
+                            sc.border_costs.grow() = c.cost;
+                    }
+                }
+            });
+            costs.clear();
+            for(u32 b = 0; b < num_buckets; ++b)
+            {
+                for(const HeapEntry& e : buckets[b].heap)
+                {
+                    costs.grow() = e.cost;
+                }
+                for(const float c : buckets[b].border_costs)
+                {
+                    costs.grow() = c;
+                }
+            }
+            // a collapse removes two triangles and a closed mesh has 1.5 edges
+            // per triangle
+            const double fraction = double(needed / 2) / (1.5 * s.live_tris);
+            const s32 k = glm::min(s32(fraction * costs.count()), costs.count() - 1);
+            if(k < 0)
+                break;
+            std::nth_element(costs.begin(), costs.begin() + k, costs.end());
+            const double threshold = glm::min(double(costs[k]), max_cost);
+
+            std::atomic<s32> budget{ s32(needed) };
+            ParallelForStealing(num_buckets, num_threads, [&](u32 b, u32)
+            {
+                RunHeap(s, buckets[b], budget, threshold, true, worst[b]);
+            });
+            const u32 removed = u32(s32(needed) - budget);
+            s.live_tris -= removed;
+            for(u32 b = 0; b < num_buckets; ++b)
+            {
+                s.max_cost = glm::max(s.max_cost, worst[b]);
+            }
+            if(removed < needed / 16)
+                break;
+        }
+        delete[] buckets;
+        delete[] worst;
+        delete[] offsets;
+        delete[] order;
+    }
+
+    // one heap over every live edge finishes across bucket borders. Edges are
+    // found from the triangle walking them with the smaller index first; open
+    // edges are only walked one way, so boundary pairs go in both ways and
+    // one of the two goes stale.
+    if(s.live_tris > target_tris)
+    {
+        const u32 num_blocks = (s.num_tris + block - 1) / block;
+        Vector<Collapse>* blocks = new Vector<Collapse>[num_blocks];
+        ParallelForStealing(num_blocks, num_threads, [&](u32 index, u32)
+        {
+            const u32 end = glm::min(s.num_tris, (index + 1) * block);
+            for(u32 t = index * block; t < end; ++t)
+            {
+                if(s.dead[t])
+                    continue;
+                for(u32 k = 0; k < 3; ++k)
+                {
+                    const u32 a = s.corner(t * 3 + k);
+                    const u32 b = s.corner(t * 3 + (k + 1) % 3);
+                    if(a > b && !(s.flags[a] & s.flags[b] & VF_BOUNDARY))
+                        continue;
+                    Collapse& c = blocks[index].grow();
+                    if(!Evaluate(s, a, b, c) || c.cost > max_cost)
+                        blocks[index].pop();
+                }
+            }
+        });
+        SimplifyScratch sc;
+        s32 total = 0;
+        for(u32 i = 0; i < num_blocks; ++i)
+        {
+            total += blocks[i].count();
+        }
+        sc.collapses.resize(total);
+        sc.heap.resize(total);
+        for(u32 i = 0; i < num_blocks; ++i)
+        {
+            for(const Collapse& c : blocks[i])
+            {
+                sc.add(c);
+            }
+        }
+        delete[] blocks;
+
+        double worst = 0.0;
+        std::atomic<s32> budget{ s32(s.live_tris - target_tris) };
+        s.live_tris -= RunHeap(s, sc, budget, max_cost, false, worst);
+        s.max_cost = glm::max(s.max_cost, worst);
+    }
+
+    return s.live_tris;
+}
+
+u32 Simplifier::triangleCount() const
+{
+    return m_state ? m_state->live_tris : 0;
+}
+
+float Simplifier::error() const
+{
+    return m_state ? float(glm::sqrt(m_state->max_cost)) : 0.0f;
+}
+
+void Simplifier::extract(Geometry& geom) const
+{
+    geom.vertices.clear();
+    geom.indices.clear();
+    if(!m_state)
+        return;
+
+    const SimplifyState& s = *m_state;
+    u32* remap = new u32[s.num_verts];
+    for(u32 v = 0; v < s.num_verts; ++v)
+    {
+        remap[v] = NO_CORNER;
+    }
+    geom.indices.resize(s32(s.live_tris * 3));
+    for(u32 t = 0; t < s.num_tris; ++t)
+    {
+        if(s.dead[t])
+            continue;
+        for(u32 k = 0; k < 3; ++k)
+        {
+            const u32 v = s.corner(t * 3 + k);
+            if(remap[v] == NO_CORNER)
+            {
+                remap[v] = u32(geom.vertices.count());
+                geom.vertices.grow() = s.geom.vertices[s32(v)];
+            }
+            geom.indices.grow() = remap[v];
+        }
+    }
+    delete[] remap;
+}
+
+float SimplifyMesh(const Geometry& src, Geometry& dst, const float ratio, const SimplifyParams& params)
+{
+    Simplifier simplifier;
+    simplifier.init(src);
+    simplifier.simplify(u32(simplifier.triangleCount() * ratio), params);
+    simplifier.extract(dst);
+    return simplifier.error();
+}
+
+// ------------------------------------------------------------------------
+
+void LodChain::build(const Geometry& geom, const float* ratios, const u32 num_ratios, const SimplifyParams& params)
+{
+    Simplifier simplifier;
+    simplifier.init(geom);
+    simplifier.extract(m_levels[0]);
+    m_errors[0] = 0.0f;
+    m_count = 1;
+
+    const u32 base = simplifier.triangleCount();
+    for(u32 i = 0; i < num_ratios && m_count < LOD_MAX_LEVELS; ++i)
+    {
+        const u32 prev = simplifier.triangleCount();
+        if(simplifier.simplify(u32(base * ratios[i]), params) >= prev)
+            break;
+        simplifier.extract(m_levels[m_count]);
+        m_errors[m_count] = simplifier.error();
+        ++m_count;
+    }
+
+    for(u32 i = 0; i < m_count; ++i)
+    {
+        OptimizeMesh(m_levels[i]);
+    }
+
+    vec3 lo = vec3(FLT_MAX), hi = vec3(-FLT_MAX);
+    for(const MeshVertex& v : m_levels[0].vertices)
+    {
+        lo = glm::min(lo, v.position);
+        hi = glm::max(hi, v.position);
+    }
+    m_center = (lo + hi) * 0.5f;
+    m_radius = 0.0f;
+    for(const MeshVertex& v : m_levels[0].vertices)
+    {
+        m_radius = glm::max(m_radius, glm::distance(v.position, m_center));
+    }
+}
+
+u32 SelectLod(const float* errors, const u32 count, const float distance, const float pixels_per_unit, const float max_error)
+{
+    const float dis = glm::max(distance, 1e-6f);
+    u32 level = 0;
+    for(u32 i = 1; i < count && errors[i] * pixels_per_unit / dis <= max_error; ++i)
+    {
+        level = i;
+    }
+    return level;
+}
+
+u32 LodChain::select(const float distance, const float pixels_per_unit, const float max_error) const
+{
+    return SelectLod(m_errors, m_count, distance, pixels_per_unit, max_error);
+}
+
+u32 LodChain::select(const vec3& eye, const float pixels_per_unit, const float max_error) const
+{
+    return select(glm::max(glm::distance(eye, m_center) - m_radius, 0.0f), pixels_per_unit, max_error);
+}
+
+// ------------------------------------------------------------------------
+
+void SimplifyBench()
+{
+    MeshTask task;
+    for(u32 i = 0; i < 12; ++i)
+    {
+        SDF& sdf = task.sdfs.grow();
+        sdf.type = (i & 1) ? SDF_SPHERE : SDF_BOX;
+        sdf.translation = vec3(randf(), randf(), randf()) * 4.0f - 2.0f;
+        sdf.material.setColor(vec3(randf(), randf(), randf()));
+    }
+    task.center = vec3(0.0f);
+    task.radius = 4.0f;
+    task.max_depth = 6;
+    SimplifyParams params;
+    float rms, max_err;
+
+    // soup from the tetrahedra mesher welds before simplifying
+    task.triangles = true;
+    GenerateMesh(task);
+    const s32 soup_tris = task.geom.vertices.count() / 3;
+    CPUTimer timer;
+    Geometry simple;
+    float error = SimplifyMesh(task.geom, simple, 0.25f, params);
+    double ms = timer.ms();
+    SurfaceError(task.sdfs, simple, rms, max_err);
+    printf("[Simplify] tetrahedra soup %7d tris -> %7d tris in %7.1f ms, error %.5f, rms %.5f, max %.5f\n",
+        soup_tris, simple.indices.count() / 3, ms, error, rms, max_err);
+
+    task.max_depth = 9;
+    GenerateMeshDC(task);
+    const s32 source_tris = task.geom.indices.count() / 3;
+
+    const float ratios[6] = { 0.5f, 0.25f, 0.125f, 0.0625f, 0.03125f, 0.015625f };
+    const u32 hw = ResolveThreadCount(0);
+    LodChain chain;
+    for(u32 t = 1; ; t = glm::min(t * 4, hw))
+    {
+        params.num_threads = t;
+        timer.begin();
+        chain.build(task.geom, ratios, 6, params);
+        ms = timer.ms();
+        printf("[Simplify] %d tris, %u levels, %2u threads: %8.1f ms, %6.2f Mtris/s\n",
+            source_tris, chain.m_count, t, ms, source_tris / ms * 1e-3);
+        if(t == hw)
+            break;
+    }
+    for(u32 i = 0; i < chain.m_count; ++i)
+    {
+        SurfaceError(task.sdfs, chain.m_levels[i], rms, max_err);
+        printf("[Simplify] level %u: %7d tris, error %.5f, rms %.5f, max %.5f\n",
+            i, chain.m_levels[i].indices.count() / 3, chain.m_errors[i], rms, max_err);
+    }
+
+    const u32 width = 640, height = 360;
+    const float fov = glm::radians(60.0f);
+    const mat4 P = glm::perspective(fov, float(width) / float(height), 0.1f, 1000.0f);
+    SplatView view;
+    view.pixels_per_unit = float(height) / (2.0f * glm::tan(fov * 0.5f));
+    const CPUSun sun;
+    const float max_pixels = 1.0f;
+    RasterTarget full(width, height), lod(width, height);
+    for(float dis = 8.0f; dis <= 256.0f; dis *= 2.0f)
+    {
+        view.eye = glm::normalize(vec3(1.0f, 0.6f, 1.0f)) * dis;
+        view.VP = P * glm::lookAt(view.eye, task.center, vec3(0.0f, 1.0f, 0.0f));
+
+        const s32 frames = 8;
+        timer.begin();
+        u32 level = 0;
+        for(s32 f = 0; f < frames; ++f)
+        {
+            lod.clear();
+            level = chain.select(view.eye, view.pixels_per_unit, max_pixels);
+            RasterTriangles(chain.m_levels[level], view, sun, lod);
+        }
+        const double lod_ms = timer.ms() / frames;
+
+        timer.begin();
+        for(s32 f = 0; f < frames; ++f)
+        {
+            full.clear();
+            RasterTriangles(chain.m_levels[0], view, sun, full);
+        }
+        const double full_ms = timer.ms() / frames;
+
+        u32 both = 0, either = 0;
+        for(u32 i = 0; i < width * height; ++i)
+        {
+            const bool a = lod.depth[i] != FLT_MAX;
+            const bool b = full.depth[i] != FLT_MAX;
+            both += (a && b) ? 1 : 0;
+            either += (a || b) ? 1 : 0;
+        }
+        printf("[Simplify] distance %5.0f: level %u %7d tris %7.2f ms | level 0 %7.2f ms | coverage agreement %5.1f%%\n",
+            dis, level, chain.m_levels[level].indices.count() / 3, lod_ms, full_ms,
+            either ? 100.0f * both / either : 100.0f);
+    }
+}
+
+#endif // MESH_GEN_ENABLED
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "meshgen.h"
+
+#if MESH_GEN_ENABLED
+
+// Quadric error edge collapse (Garland & Heckbert) over indexed Geometry.
+// Quadrics are plane sums, not area weighted, so sqrt of a collapse cost reads
+// as a distance in world units. Open edges get a constraint plane at right
+// angles to their face so boundaries only slide along themselves, and vertices
+// that share a position but not attributes (normal, color or material seams)
+// never move, so both sides of a seam keep matching.
+// The mesh is cut into spatial buckets that collapse their interior edges in
+// parallel, then one heap over the whole mesh finishes across bucket borders.
+
+#define LOD_MAX_LEVELS 8
+
+struct SimplifyParams
+{
+    float max_error = 1e30f;    // world units, no collapse past it
+    u32 num_threads = 0;
+};
+
+// merges vertices closer than weld_distance whose attributes match and turns
+// soup into indexed geometry; indexed input is rewelded the same way
+void WeldGeometry(Geometry& geom, const float weld_distance = 1e-5f);
+
+struct SimplifyState;
+
+class Simplifier
+{
+    SimplifyState* m_state = nullptr;
+public:
+    Simplifier(){}
+    ~Simplifier();
+    Simplifier(const Simplifier&) = delete;
+    Simplifier& operator=(const Simplifier&) = delete;
+
+    // copies and welds geom; later calls keep simplifying the same mesh, so
+    // errors are always measured against this one
+    void init(const Geometry& geom);
+    // collapses until at most target_tris remain or nothing is cheaper than
+    // params.max_error; returns the live triangle count
+    u32 simplify(const u32 target_tris, const SimplifyParams& params);
+    u32 triangleCount() const;
+    // largest collapse error so far, world units
+    float error() const;
+    void extract(Geometry& geom) const;
+};
+
+// one shot: dst holds about ratio of src's triangles
+float SimplifyMesh(const Geometry& src, Geometry& dst, const float ratio, const SimplifyParams& params);
+
+// level 0 is the welded source, each further level a fraction of it, all in
+// OptimizeMesh order. Picking a level only needs the distance to the object,
+// so it happens per draw.
+struct LodChain
+{
+    Geometry m_levels[LOD_MAX_LEVELS];
+    float m_errors[LOD_MAX_LEVELS];     // world space deviation from level 0
+    vec3 m_center = vec3(0.0f);
+    float m_radius = 0.0f;
+    u32 m_count = 0;
+
+    // ratios of the source's triangle count, decreasing
+    void build(const Geometry& geom, const float* ratios, const u32 num_ratios, const SimplifyParams& params);
+    // coarsest level whose error projects below max_error pixels at distance;
+    // pixels_per_unit as in SplatView
+    u32 select(const float distance, const float pixels_per_unit, const float max_error) const;
+    u32 select(const vec3& eye, const float pixels_per_unit, const float max_error) const;
+};
+
+// coarsest of count levels whose error projects below max_error pixels at
+// distance; shared by LodChain and the uploaded LodMesh
+u32 SelectLod(const float* errors, const u32 count, const float distance, const float pixels_per_unit, const float max_error);
+
+// simplification rate and error of every level, then level selection and
+// raster time as the camera backs away
+void SimplifyBench();
+
+#endif // MESH_GEN_ENABLED
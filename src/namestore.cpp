@@ -1,3 +1,245 @@
 #include "namestore.h"
+#include "store.h"
+#include "hash.h"
+#include "cputimer.h"
+#include <cstring>
+#include <cstdio>
+#include <thread>
 
-NameStore g_NameStore;
\ No newline at end of file
+#define NAME_CHUNK_SIZE     (64 * 1024)
+#define NAME_TABLE_MIN      256
+
+NameStore g_NameStore;
+
+NameStore::~NameStore()
+{
+    Table* table = m_table.load(std::memory_order_relaxed);
+    while(table)
+    {
+        Table* prev = table->m_prev;
+        delete[] table->m_slots;
+        delete table;
+        table = prev;
+    }
+    while(m_chunk)
+    {
+        char* prev;
+        memcpy(&prev, m_chunk, sizeof(prev));
+        delete[] m_chunk;
+        m_chunk = prev;
+    }
+}
+
+const char* NameStore::find(const Table* table, u32 name) const
+{
+    if(!table)
+        return nullptr;
+    for(u32 i = FlatHash(name) & table->m_mask; ; i = (i + 1) & table->m_mask)
+    {
+        const u32 hash = table->m_slots[i].m_hash.load(std::memory_order_acquire);
+        if(hash == name)
+            return table->m_slots[i].m_text;
+        if(!hash)
+            return nullptr;
+    }
+}
+
+// holding m_lock; rehashes into a new table and publishes it
+NameStore::Table* NameStore::grow(u32 capacity)
+{
+    Table* old = m_table.load(std::memory_order_relaxed);
+    Table* table = new Table;
+    table->m_slots = new Slot[capacity];
+    table->m_mask = capacity - 1;
+    table->m_prev = old;
+    for(u32 i = 0; i < capacity; ++i)
+    {
+        table->m_slots[i].m_hash.store(0, std::memory_order_relaxed);
+        table->m_slots[i].m_text = nullptr;
+    }
+    for(u32 i = 0; old && i <= old->m_mask; ++i)
+    {
+        const u32 hash = old->m_slots[i].m_hash.load(std::memory_order_relaxed);
+        if(!hash)
+            continue;
+        u32 j = FlatHash(hash) & table->m_mask;
+        while(table->m_slots[j].m_hash.load(std::memory_order_relaxed))
+        {
+            j = (j + 1) & table->m_mask;
+        }
+        table->m_slots[j].m_text = old->m_slots[i].m_text;
+        table->m_slots[j].m_hash.store(hash, std::memory_order_relaxed);
+    }
+    m_table.store(table, std::memory_order_release);
+    return table;
+}
+
+// holding m_lock; bump allocates val into the arena
+const char* NameStore::copy(const char* val)
+{
+    const u32 len = u32(strlen(val)) + 1;
+    if(!m_chunk || m_chunkUsed + len > m_chunkSize)
+    {
+        // each chunk starts with a pointer to the one before it
+        const u32 header = u32(sizeof(char*));
+        const u32 size = header + len > NAME_CHUNK_SIZE ? header + len : NAME_CHUNK_SIZE;
+        char* chunk = new char[size];
+        memcpy(chunk, &m_chunk, sizeof(char*));
+        m_chunk = chunk;
+        m_chunkUsed = header;
+        m_chunkSize = size;
+        m_bytes += size;
+    }
+    char* dst = m_chunk + m_chunkUsed;
+    memcpy(dst, val, len);
+    m_chunkUsed += len;
+    return dst;
+}
+
+const char* NameStore::insert(u32 name, const char* val)
+{
+    const char* text = get(name);
+    if(text)
+        return text;
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    Table* table = m_table.load(std::memory_order_relaxed);
+    text = find(table, name);
+    if(text)
+        return text;
+
+    // half full at most, so misses stop early
+    if(!table || (m_count + 1) * 2 > table->m_mask + 1)
+    {
+        table = grow(table ? (table->m_mask + 1) * 2 : NAME_TABLE_MIN);
+    }
+    u32 i = FlatHash(name) & table->m_mask;
+    while(table->m_slots[i].m_hash.load(std::memory_order_relaxed))
+    {
+        i = (i + 1) & table->m_mask;
+    }
+    text = copy(val);
+    table->m_slots[i].m_text = text;
+    table->m_slots[i].m_hash.store(name, std::memory_order_release);
+    ++m_count;
+    return text;
+}
+
+// ------------------------------------------------------------------------
+
+// the previous store: a 256 byte block per name, which is only safe across
+// threads behind a lock
+struct LockedBlockStore
+{
+    struct TextBlock
+    {
+        char m_text[256];
+    };
+    std::mutex m_lock;
+    Store<TextBlock, 16384> m_store;
+
+    const char* get(u32 name)
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        TextBlock* res = m_store.get(name);
+        return res ? res->m_text : nullptr;
+    }
+    void insert(u32 name, const char* val)
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        if(m_store.get(name))
+            return;
+        TextBlock block;
+        strncpy(block.m_text, val, sizeof(block.m_text) - 1);
+        block.m_text[sizeof(block.m_text) - 1] = 0;
+        m_store.insert(name, block);
+    }
+};
+
+template<typename S>
+static double NameBenchRun(S& store, const char* const* names, const u32* hashes, const u32 num_names,
+    const u32 num_threads, const u32 reps, const bool intern)
+{
+    std::thread threads[16];
+    CPUTimer timer;
+    for(u32 t = 0; t < num_threads; ++t)
+    {
+        threads[t] = std::thread([&, t]()
+        {
+            // every thread walks all names from its own offset, so inserts
+            // race on the same keys
+            u64 sum = 0;
+            for(u32 r = 0; r < reps; ++r)
+            {
+                for(u32 n = 0; n < num_names; ++n)
+                {
+                    // interning hashes the name as HashString does, lookups
+                    // start from the hash as str() does
+                    const u32 idx = (n + t * 977) % num_names;
+                    if(intern)
+                    {
+                        store.insert(fnv(names[idx]), names[idx]);
+                    }
+                    else
+                    {
+                        sum += u64(store.get(hashes[idx]) != nullptr);
+                    }
+                }
+            }
+            if(!intern && sum != u64(reps) * num_names)
+            {
+                printf("[NameStore] lookup missed a name\n");
+            }
+        });
+    }
+    for(u32 t = 0; t < num_threads; ++t)
+    {
+        threads[t].join();
+    }
+    return double(num_threads) * reps * num_names / timer.seconds() * 1e-6;
+}
+
+void NameStoreBench()
+{
+    const u32 num_names = 8192;
+    const u32 num_threads = 16;
+    char* text = new char[num_names * 48];
+    const char** names = new const char*[num_names];
+    u32* hashes = new u32[num_names];
+    for(u32 i = 0; i < num_names; ++i)
+    {
+        char* name = text + i * 48;
+        snprintf(name, 48, "%s_%u", (i & 1) ? "material.albedoSampler" : "light", i * 2654435761u);
+        names[i] = name;
+        hashes[i] = fnv(name);
+    }
+
+    NameStore* arena = new NameStore;
+    LockedBlockStore* blocks = new LockedBlockStore;
+    const double arena_intern = NameBenchRun(*arena, names, hashes, num_names, num_threads, 1, true);
+    const double arena_lookup = NameBenchRun(*arena, names, hashes, num_names, num_threads, 32, false);
+    const double block_intern = NameBenchRun(*blocks, names, hashes, num_names, num_threads, 1, true);
+    const double block_lookup = NameBenchRun(*blocks, names, hashes, num_names, num_threads, 32, false);
+
+    // names sharing an fnv hash intern as whichever came first
+    u32 collisions = 0;
+    bool ok = true;
+    for(u32 i = 0; i < num_names; ++i)
+    {
+        const char* interned = arena->get(hashes[i]);
+        ok = ok && interned;
+        collisions += u32(interned && strcmp(interned, names[i]) != 0);
+    }
+    ok = ok && arena->count() + collisions == num_names;
+
+    printf("[NameStore] %u names, %u threads: intern %.1f M/s (locked blocks %.1f), lookup %.1f M/s (locked blocks %.1f), %u KB arena vs %u KB blocks, %u fnv collisions, %s\n",
+        num_names, num_threads, arena_intern, block_intern, arena_lookup, block_lookup,
+        u32(arena->bytes() / 1024), u32(u64(num_names) * sizeof(LockedBlockStore::TextBlock) / 1024),
+        collisions, ok ? "ok" : "MISMATCH");
+
+    delete arena;
+    delete blocks;
+    delete[] names;
+    delete[] hashes;
+    delete[] text;
+}
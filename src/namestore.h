@@ -1,44 +1,64 @@
-#pragma once 
+#pragma once
 
-#include "store.h"
 #include "ints.h"
+#include <atomic>
+#include <mutex>
 
-struct NameStore
+// Interned names keyed by their fnv hash.
+// Strings are copied end to end into arena chunks that are never moved or
+// freed before the store, so a returned pointer stays valid and names of any
+// length fit. Lookups take no lock: slots publish their hash with release
+// after the text pointer is written, and the table pointer is swapped the
+// same way when it grows. Inserts serialise on m_lock, and only when the
+// lock free lookup misses. Replaced tables stay alive until the store dies,
+// since a reader may still be probing one.
+class NameStore
 {
-    struct TextBlock
+    struct Slot
     {
-        enum : u32
-        {
-            Capacity = 256,
-        };
-        char m_text[Capacity] = {0};
-        TextBlock(){};
-        TextBlock(const char* val)
-        {
-            for(u32 i = 0; i < Capacity - 1 && val[i]; ++i)
-            {
-                m_text[i] = val[i];
-            }
-        }
+        std::atomic<u32> m_hash;    // 0 when empty; fnv never returns 0
+        const char* m_text;         // written before m_hash
     };
+    struct Table
+    {
+        Slot* m_slots;
+        u32 m_mask;
+        Table* m_prev;              // retired tables
+    };
+
+    std::atomic<Table*> m_table;
+    std::mutex m_lock;
+    u32 m_count = 0;
+    char* m_chunk = nullptr;        // current arena chunk, linked to the previous
+    u32 m_chunkUsed = 0;
+    u32 m_chunkSize = 0;
+    u64 m_bytes = 0;                // arena bytes allocated
+
+    const char* find(const Table* table, u32 name) const;
+    Table* grow(u32 capacity);
+    const char* copy(const char* val);
 
-    Store<TextBlock, 256> m_store;
+public:
+    // constant initialised, so HS() may run during other globals' construction
+    constexpr NameStore() : m_table(nullptr){}
+    ~NameStore();
+    NameStore(const NameStore&) = delete;
+    NameStore& operator=(const NameStore&) = delete;
 
-    const char* get(u32 name)
+    const char* get(u32 name) const
     {
-        TextBlock* res = m_store.get(name);
-        return res ? res->m_text : nullptr;
+        return find(m_table.load(std::memory_order_acquire), name);
     }
-    const char* operator[](u32 name){ return get(name); }
-    void insert(u32 name, const char* val)
-    {
-        if(m_store.get(name))
-        {
-            return;
-        }
+    const char* operator[](u32 name) const { return get(name); }
+    // keeps the first string seen for a hash; returns the interned copy
+    const char* insert(u32 name, const char* val);
 
-        m_store.insert(name, TextBlock(val));
-    }
+    u32 count() const { return m_count; }
+    u64 bytes() const { return m_bytes; }
 };
 
 extern NameStore g_NameStore;
+
+// intern and lookup rates from 16 threads against a locked table of fixed
+// 256 byte blocks, the old layout
+void NameStoreBench();
@@ -0,0 +1,54 @@
+#version 450 core
+
+// PackedVertex: normalized attributes arrive as floats in 0..1 or -1..1
+layout(location = 0) in vec3 position;  // across the mesh bounds
+layout(location = 1) in vec2 material;  // roughness, metalness
+layout(location = 2) in vec2 normal;    // octahedral
+layout(location = 3) in vec4 color;     // rgb, ao
+
+out vec3 Position;
+out vec3 Normal;
+out vec3 Albedo;
+out vec3 Material;
+
+#define SHARED_UNIFORMS_BINDING 13
+
+struct SharedUniforms
+{
+    mat4 MVP;
+    mat4 IVP;
+    mat4 sunMatrix;
+    vec4 sunDirection;
+    vec4 sunColor; // w -> intensity
+    vec4 eye;
+    vec4 render_resolution; // zw -> sunNearFar
+    vec4 df_translation; // w -> df_pitch;
+    vec4 df_scale;
+    ivec4 seed_flags; // x -> seed, y -> draw mode
+    ivec4 sampler_states; // x -> env_cm; y -> sunDepth;
+};
+
+layout(std430, binding = SHARED_UNIFORMS_BINDING) buffer SU_BUFFER
+{
+    SharedUniforms SU;
+};
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    // df_translation is the bounds' lo, df_scale their extent
+    const vec3 pos = position.xyz * SU.df_scale.xyz + SU.df_translation.xyz;
+    Position.xyz = pos.xyz;
+    Normal = octDecode(normal);
+    Albedo = color.rgb;
+    Material = vec3(material.xy, color.a);
+    gl_Position = SU.MVP * vec4(pos.xyz, 1.0);
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "ints.h"
+#include <thread>
+#include <mutex>
+
+inline u32 ResolveThreadCount(u32 num_threads)
+{
+    if(!num_threads)
+    {
+        num_threads = std::thread::hardware_concurrency();
+        num_threads = num_threads ? num_threads : 1;
+    }
+    return num_threads < 64 ? num_threads : 64;
+}
+
+// splits [0, count) into one contiguous range per thread and blocks until done.
+// ranges are multiples of align so only the last one may be partial.
+// num_threads of 0 picks std::thread::hardware_concurrency().
+template<typename Fn>
+void ParallelFor(const u32 count, u32 num_threads, const u32 min_count, const u32 align, Fn fn)
+{
+    num_threads = ResolveThreadCount(num_threads);
+
+    if(count < min_count || num_threads == 1)
+    {
+        fn(0u, count);
+        return;
+    }
+
+    u32 chunk = (count + num_threads - 1) / num_threads;
+    chunk = ((chunk + align - 1) / align) * align;
+    std::thread threads[64];
+    u32 num_started = 0;
+    for(u32 begin = 0; begin < count; begin += chunk)
+    {
+        const u32 end = begin + chunk < count ? begin + chunk : count;
+        threads[num_started++] = std::thread(fn, begin, end);
+    }
+    for(u32 i = 0; i < num_started; ++i)
+    {
+        threads[i].join();
+    }
+}
+
+// calls fn(index, thread) for every index in [0, count). each thread starts on
+// its own contiguous range and, once that runs dry, steals the back half of
+// the fullest remaining range, so uneven items still balance across threads.
+template<typename Fn>
+void ParallelForStealing(const u32 count, u32 num_threads, Fn fn)
+{
+    num_threads = ResolveThreadCount(num_threads);
+    num_threads = num_threads < count ? num_threads : count;
+    if(num_threads <= 1)
+    {
+        for(u32 i = 0; i < count; ++i)
+        {
+            fn(i, 0u);
+        }
+        return;
+    }
+
+    struct Range
+    {
+        std::mutex lock;
+        u32 begin;
+        u32 end;
+    };
+    Range ranges[64];
+    for(u32 i = 0; i < num_threads; ++i)
+    {
+        ranges[i].begin = u32(u64(count) * i / num_threads);
+        ranges[i].end = u32(u64(count) * (i + 1) / num_threads);
+    }
+
+    auto worker = [&](const u32 self)
+    {
+        Range& own = ranges[self];
+        while(true)
+        {
+            own.lock.lock();
+            if(own.begin < own.end)
+            {
+                const u32 item = own.begin++;
+                own.lock.unlock();
+                fn(item, self);
+                continue;
+            }
+            own.lock.unlock();
+
+            u32 victim = self;
+            u32 most = 0;
+            for(u32 i = 0; i < num_threads; ++i)
+            {
+                if(i == self)
+                    continue;
+                ranges[i].lock.lock();
+                const u32 left = ranges[i].end - ranges[i].begin;
+                ranges[i].lock.unlock();
+                if(left > most)
+                {
+                    most = left;
+                    victim = i;
+                }
+            }
+            if(victim == self)
+            {
+                return;
+            }
+
+            Range& other = ranges[victim];
+            other.lock.lock();
+            const u32 left = other.end - other.begin;
+            const u32 take = left / 2 + (left & 1);
+            const u32 end = other.end;
+            other.end -= take;
+            other.lock.unlock();
+
+            if(take)
+            {
+                own.lock.lock();
+                own.begin = end - take;
+                own.end = end;
+                own.lock.unlock();
+            }
+        }
+    };
+
+    std::thread threads[64];
+    for(u32 i = 1; i < num_threads; ++i)
+    {
+        threads[i] = std::thread(worker, i);
+    }
+    worker(0);
+    for(u32 i = 1; i < num_threads; ++i)
+    {
+        threads[i].join();
+    }
+}
@@ -0,0 +1,373 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "probebake.h"
+#include "sdfopt.h"
+#include "parallelfor.h"
+#include "randf.h"
+#include "cputimer.h"
+#include <cstdio>
+#include <cfloat>
+#include <cstring>
+
+#define SH_Y0 0.282095f
+#define SH_Y1 0.488603f
+
+// IEEE half floats for the probe file, rounding to nearest even
+static u16 FloatToHalf(const float f)
+{
+    u32 x;
+    memcpy(&x, &f, sizeof(x));
+    const u32 sign = (x >> 16) & 0x8000;
+    x &= 0x7fffffff;
+    if(x >= 0x7f800000)
+    {
+        return u16(sign | 0x7c00 | (x > 0x7f800000 ? 0x200 : 0));
+    }
+    if(x >= 0x47800000)
+    {
+        return u16(sign | 0x7c00);
+    }
+    if(x < 0x38800000)
+    {
+        // below the smallest normal half, in units of 2^-24
+        if(x < 0x33000000)
+            return u16(sign);
+        const u32 shift = 126 - (x >> 23);
+        const u32 m = (x & 0x7fffff) | 0x800000;
+        const u32 rem = m & ((1u << shift) - 1);
+        const u32 half = 1u << (shift - 1);
+        u32 h = m >> shift;
+        h += (rem > half || (rem == half && (h & 1))) ? 1 : 0;
+        return u16(sign | h);
+    }
+    // a rounding carry walks into the exponent, up to infinity
+    u32 h = (x - 0x38000000) >> 13;
+    const u32 rem = x & 0x1fff;
+    h += (rem > 0x1000 || (rem == 0x1000 && (h & 1))) ? 1 : 0;
+    return u16(sign | h);
+}
+
+static float HalfToFloat(const u16 h)
+{
+    const u32 sign = u32(h & 0x8000) << 16;
+    const u32 e = (h >> 10) & 0x1f;
+    const u32 m = h & 0x3ff;
+    u32 x;
+    if(e == 0x1f)
+    {
+        x = sign | 0x7f800000 | (m << 13);
+    }
+    else if(e)
+    {
+        x = sign | ((e + 112) << 23) | (m << 13);
+    }
+    else
+    {
+        const float f = float(m) * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    }
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+struct ProbeFileHeader
+{
+    u32 magic;
+    u32 dims[3];
+    float origin[3];
+    float spacing;
+};
+
+void ProbeGrid::resize(const uvec3& dims)
+{
+    delete[] m_probes;
+    m_dims = dims;
+    m_probes = count() ? new ProbeSH[count()] : nullptr;
+}
+
+vec3 ProbeIrradiance(const ProbeSH& sh, const vec3& N)
+{
+    const float A0 = 3.141592f;
+    const float A1 = 2.094395f;
+    const vec3 E = A0 * SH_Y0 * sh.c[0]
+        + A1 * SH_Y1 * (sh.c[1] * N.y + sh.c[2] * N.z + sh.c[3] * N.x);
+    return glm::max(E, vec3(0.0f));
+}
+
+vec3 ProbeGrid::irradiance(const vec3& p, const vec3& N) const
+{
+    const vec3 hi = vec3(m_dims) - 1.0001f;
+    const vec3 v = glm::clamp((p - m_origin) / m_spacing, vec3(0.0f), glm::max(hi, vec3(0.0f)));
+    const uvec3 i0 = uvec3(v);
+    const uvec3 i1 = glm::min(i0 + 1u, m_dims - 1u);
+    const vec3 f = v - vec3(i0);
+
+    vec3 E = vec3(0.0f);
+    for(u32 k = 0; k < 8; ++k)
+    {
+        const uvec3 i = uvec3((k & 1) ? i1.x : i0.x, (k & 2) ? i1.y : i0.y, (k & 4) ? i1.z : i0.z);
+        const float w = ((k & 1) ? f.x : 1.0f - f.x) * ((k & 2) ? f.y : 1.0f - f.y) * ((k & 4) ? f.z : 1.0f - f.z);
+        E += w * ProbeIrradiance(at(i.x, i.y, i.z), N);
+    }
+    return E;
+}
+
+bool ProbeGrid::save(const char* path) const
+{
+    FILE* pFile = fopen(path, "wb");
+    if(!pFile)
+    {
+        printf("[ProbeGrid] could not open %s\n", path);
+        return false;
+    }
+
+    ProbeFileHeader header;
+    header.magic = PROBE_FILE_MAGIC;
+    for(s32 i = 0; i < 3; ++i)
+    {
+        header.dims[i] = m_dims[i];
+        header.origin[i] = m_origin[i];
+    }
+    header.spacing = m_spacing;
+    fwrite(&header, sizeof(header), 1, pFile);
+
+    u16 packed[PROBE_SH_COEFFS * 3];
+    for(u32 i = 0; i < count(); ++i)
+    {
+        for(u32 c = 0; c < PROBE_SH_COEFFS; ++c)
+        {
+            for(s32 ch = 0; ch < 3; ++ch)
+            {
+                packed[c * 3 + ch] = FloatToHalf(m_probes[i].c[c][ch]);
+            }
+        }
+        fwrite(packed, sizeof(packed), 1, pFile);
+    }
+
+    fclose(pFile);
+    return true;
+}
+
+bool ProbeGrid::load(const char* path)
+{
+    FILE* pFile = fopen(path, "rb");
+    if(!pFile)
+    {
+        printf("[ProbeGrid] could not open %s\n", path);
+        return false;
+    }
+
+    ProbeFileHeader header;
+    if(fread(&header, sizeof(header), 1, pFile) != 1 || header.magic != PROBE_FILE_MAGIC)
+    {
+        printf("[ProbeGrid] %s is not a probe file\n", path);
+        fclose(pFile);
+        return false;
+    }
+
+    resize(uvec3(header.dims[0], header.dims[1], header.dims[2]));
+    m_origin = vec3(header.origin[0], header.origin[1], header.origin[2]);
+    m_spacing = header.spacing;
+
+    u16 packed[PROBE_SH_COEFFS * 3];
+    bool ok = true;
+    for(u32 i = 0; i < count() && ok; ++i)
+    {
+        ok = fread(packed, sizeof(packed), 1, pFile) == 1;
+        for(u32 c = 0; c < PROBE_SH_COEFFS; ++c)
+        {
+            for(s32 ch = 0; ch < 3; ++ch)
+            {
+                m_probes[i].c[c][ch] = HalfToFloat(packed[c * 3 + ch]);
+            }
+        }
+    }
+
+    fclose(pFile);
+    if(!ok)
+    {
+        printf("[ProbeGrid] %s is truncated\n", path);
+        resize(uvec3(0));
+    }
+    return ok;
+}
+
+// ------------------------------------------------------------------------
+
+// albedo of the primitive closest to p
+static vec3 SurfaceAlbedo(const SDFList& sdfs, const vec3& p)
+{
+    s32 best = 0;
+    float best_dis = FLT_MAX;
+    for(s32 i = 0; i < sdfs.count(); ++i)
+    {
+        const float dis = glm::abs(sdfs[i].distance(p));
+        if(dis < best_dis)
+        {
+            best_dis = dis;
+            best = i;
+        }
+    }
+    return sdfs.count() ? sdfs[best].material.getColor() : vec3(0.0f);
+}
+
+static void BakeProbe(const SDFList& sdfs, const CPUSun& sun, const ProbeBakeParams& params,
+    const RayCastParams& trace, const vec3* dirs, vec3 p, Ray* rays, RayHit* hits, ProbeSH& sh)
+{
+    // probes that land inside geometry would only see black, so push them out
+    for(s32 i = 0; i < 4; ++i)
+    {
+        const float dis = SDFDis(sdfs, p);
+        if(dis > trace.epsilon * 10.0f)
+            break;
+        const float e = 0.001f;
+        const vec3 N = glm::normalize(vec3(
+            SDFDis(sdfs, p + vec3(e, 0.0f, 0.0f)) - SDFDis(sdfs, p - vec3(e, 0.0f, 0.0f)),
+            SDFDis(sdfs, p + vec3(0.0f, e, 0.0f)) - SDFDis(sdfs, p - vec3(0.0f, e, 0.0f)),
+            SDFDis(sdfs, p + vec3(0.0f, 0.0f, e)) - SDFDis(sdfs, p - vec3(0.0f, 0.0f, e))) + 0.000001f);
+        p += N * (trace.epsilon * 10.0f - dis) * SafeRelaxation(sdfs);
+    }
+
+    const u32 n = params.rays;
+    for(u32 i = 0; i < n; ++i)
+    {
+        rays[i].origin = p;
+        rays[i].direction = dirs[i];
+        rays[i].tmax = 100.0f;
+    }
+    RayCast(sdfs, rays, hits, n, trace);
+
+    // shadow rays from every hit towards the sun
+    const vec3 L = glm::normalize(sun.direction);
+    for(u32 i = 0; i < n; ++i)
+    {
+        rays[n + i].origin = hits[i].position + hits[i].normal * (trace.epsilon * 4.0f);
+        rays[n + i].direction = L;
+        rays[n + i].tmax = hits[i].hit ? 100.0f : 0.0f;
+    }
+    RayCast(sdfs, rays + n, hits + n, n, trace);
+
+    for(u32 c = 0; c < PROBE_SH_COEFFS; ++c)
+    {
+        sh.c[c] = vec3(0.0f);
+    }
+    const vec3 radiance = sun.color * sun.intensity;
+    for(u32 i = 0; i < n; ++i)
+    {
+        vec3 L_in = params.sky;
+        if(hits[i].hit)
+        {
+            const float NdL = glm::max(0.0f, glm::dot(hits[i].normal, L));
+            const float visible = hits[n + i].hit ? 0.0f : 1.0f;
+            L_in = SurfaceAlbedo(sdfs, hits[i].position) / 3.141592f * radiance * NdL * visible;
+        }
+        const vec3& d = dirs[i];
+        sh.c[0] += L_in * SH_Y0;
+        sh.c[1] += L_in * (SH_Y1 * d.y);
+        sh.c[2] += L_in * (SH_Y1 * d.z);
+        sh.c[3] += L_in * (SH_Y1 * d.x);
+    }
+
+    const float weight = 4.0f * 3.141592f / float(n);
+    for(u32 c = 0; c < PROBE_SH_COEFFS; ++c)
+    {
+        sh.c[c] *= weight;
+    }
+}
+
+void BakeProbes(const SDFList& sdfs, const CPUSun& sun, const ProbeBakeParams& params, ProbeGrid& grid)
+{
+    const AABB bounds = SDFListBounds(sdfs);
+    grid.m_spacing = params.spacing;
+    grid.m_origin = bounds.lo;
+    grid.resize(uvec3(glm::max(bounds.span() / params.spacing, vec3(0.0f))) + 2u);
+
+    RayCastParams trace = params.trace;
+    trace.num_threads = 1;
+    trace.relaxation = glm::min(trace.relaxation, SafeRelaxation(sdfs));
+
+    // spherical fibonacci directions, shared by every probe
+    const u32 n = params.rays;
+    vec3* dirs = new vec3[n];
+    for(u32 i = 0; i < n; ++i)
+    {
+        const float z = 1.0f - (2.0f * i + 1.0f) / float(n);
+        const float r = glm::sqrt(glm::max(0.0f, 1.0f - z * z));
+        const float phi = 2.399963f * float(i);
+        dirs[i] = vec3(r * glm::cos(phi), r * glm::sin(phi), z);
+    }
+
+    const u32 num_threads = ResolveThreadCount(params.num_threads);
+    Ray* rays = new Ray[num_threads * n * 2];
+    RayHit* hits = new RayHit[num_threads * n * 2];
+
+    ParallelForStealing(grid.count(), num_threads, [&](u32 index, u32 thread)
+    {
+        const u32 x = index % grid.m_dims.x;
+        const u32 y = (index / grid.m_dims.x) % grid.m_dims.y;
+        const u32 z = index / (grid.m_dims.x * grid.m_dims.y);
+        BakeProbe(sdfs, sun, params, trace, dirs, grid.position(x, y, z),
+            rays + thread * n * 2, hits + thread * n * 2, grid.at(x, y, z));
+    });
+
+    delete[] dirs;
+    delete[] rays;
+    delete[] hits;
+}
+
+// ------------------------------------------------------------------------
+
+void ProbeBakeBench()
+{
+    SDFList sdfs;
+    {
+        SDF& floor = sdfs.grow();
+        floor.type = SDF_BOX;
+        floor.translation = vec3(0.0f, -1.5f, 0.0f);
+        floor.scale = vec3(4.0f, 0.25f, 4.0f);
+        floor.material.setColor(vec3(0.8f));
+    }
+    for(u32 i = 0; i < 15; ++i)
+    {
+        SDF& sdf = sdfs.grow();
+        sdf.type = (i & 1) ? SDF_BOX : SDF_SPHERE;
+        sdf.translation = vec3(randf() * 3.0f - 1.5f, randf() * 2.0f - 1.0f, randf() * 3.0f - 1.5f);
+        sdf.scale = vec3(0.2f + randf() * 0.3f);
+        sdf.material.setColor(vec3(randf(), randf(), randf()));
+    }
+
+    const CPUSun sun;
+    ProbeBakeParams params;
+    ProbeGrid grid;
+    const u32 hw = ResolveThreadCount(0);
+    for(u32 t = 1; ; t = glm::min(t * 2, hw))
+    {
+        params.num_threads = t;
+        CPUTimer timer;
+        BakeProbes(sdfs, sun, params, grid);
+        const double secs = timer.seconds();
+        printf("[ProbeBake] %ux%ux%u probes, %u rays each, %2u threads: %.3f s, %.2f Mrays/s\n",
+            grid.m_dims.x, grid.m_dims.y, grid.m_dims.z, params.rays, t, secs,
+            grid.count() * params.rays * 2.0 / secs * 1e-6);
+        if(t == hw)
+            break;
+    }
+
+    const char* path = "probe_bench.prb";
+    ProbeGrid loaded;
+    if(grid.save(path) && loaded.load(path))
+    {
+        float max_err = 0.0f;
+        for(u32 i = 0; i < grid.count(); ++i)
+        {
+            const vec3 N = glm::normalize(vec3(randf(), randf(), randf()) * 2.0f - 1.0f);
+            const vec3 a = ProbeIrradiance(grid.m_probes[i], N);
+            const vec3 b = ProbeIrradiance(loaded.m_probes[i], N);
+            max_err = glm::max(max_err, glm::length(a - b) / glm::max(glm::length(a), 0.001f));
+        }
+        printf("[ProbeBake] %u probes in %u bytes, max relative error after half packing: %.4f\n",
+            grid.count(), u32(sizeof(ProbeFileHeader) + grid.count() * PROBE_SH_COEFFS * 3 * sizeof(u16)), max_err);
+        remove(path);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ints.h"
+#include "linmath.h"
+#include "sdf.h"
+#include "cpurender.h"
+
+// Offline irradiance probes: a regular grid over the scene bounds, each probe
+// storing incoming radiance as L1 spherical harmonics (4 coefficients per
+// colour channel) from one bounce of sun light off the SDFs plus the sky.
+// irradiance for a normal n is, per channel,
+//     E(n) = PI * Y0 * c[0] + (2 * PI / 3) * Y1 * (c[1] * n.y + c[2] * n.z + c[3] * n.x)
+// with Y0 = 0.282095 and Y1 = 0.488603, so a shader needs 8 trilinear probe
+// fetches in place of stochastic per pixel rays.
+
+#define PROBE_SH_COEFFS 4
+#define PROBE_FILE_MAGIC 0x31425250 // "PRB1"
+
+struct ProbeSH
+{
+    vec3 c[PROBE_SH_COEFFS];
+};
+
+struct ProbeBakeParams
+{
+    float spacing = 0.5f;           // world units between probes
+    u32 rays = 256;                 // per probe
+    u32 num_threads = 0;            // 0 picks std::thread::hardware_concurrency()
+    vec3 sky = vec3(0.1f, 0.15f, 0.25f);
+    RayCastParams trace;            // relaxation is capped to SafeRelaxation of the scene
+};
+
+struct ProbeGrid
+{
+    vec3 m_origin;                  // world position of probe (0, 0, 0)
+    float m_spacing = 1.0f;
+    uvec3 m_dims = uvec3(0);
+    ProbeSH* m_probes = nullptr;
+
+    ProbeGrid(){}
+    ~ProbeGrid(){ delete[] m_probes; }
+    ProbeGrid(const ProbeGrid&) = delete;
+    ProbeGrid& operator=(const ProbeGrid&) = delete;
+
+    void resize(const uvec3& dims);
+    u32 count() const { return m_dims.x * m_dims.y * m_dims.z; }
+    ProbeSH& at(u32 x, u32 y, u32 z){ return m_probes[(z * m_dims.y + y) * m_dims.x + x]; }
+    const ProbeSH& at(u32 x, u32 y, u32 z) const { return m_probes[(z * m_dims.y + y) * m_dims.x + x]; }
+    vec3 position(u32 x, u32 y, u32 z) const { return m_origin + vec3(x, y, z) * m_spacing; }
+    // trilinear blend of the 8 surrounding probes, evaluated for normal N
+    vec3 irradiance(const vec3& p, const vec3& N) const;
+
+    // header, then every probe as 12 halfs (24 bytes)
+    bool save(const char* path) const;
+    bool load(const char* path);
+};
+
+vec3 ProbeIrradiance(const ProbeSH& sh, const vec3& N);
+
+void BakeProbes(const SDFList& sdfs, const CPUSun& sun, const ProbeBakeParams& params, ProbeGrid& grid);
+
+void ProbeBakeBench();
@@ -8,6 +8,8 @@
 
 #define RMT_USE_OPENGL 1
 #include "remotery.h"
+#include <cstdio>
+#include <cstdarg>
 
 extern Remotery* g_rmt;
 
@@ -36,6 +38,16 @@ struct ProfilerEvent
         rmt_EndCPUSample();
     }
 };
+inline void ProfilerLog(const char* fmt, ...)
+{
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    rmt_LogText(buf);
+}
+
 struct ProfilerGPUEvent
 {
     const char* m_sym;
@@ -57,6 +69,7 @@ struct ProfilerGPUEvent
 #define ProfilerDeinit() 
 #define ProfilerEvent(x) 
 #define ProfilerGPUEvent(x) 
+#define ProfilerLog(...) 
 
 #endif // PROFILING_ENABLED
 // ---------------------------------------------------------------
\ No newline at end of file
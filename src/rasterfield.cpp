@@ -4,6 +4,10 @@
 #include "mesh.h"
 #include "glprogram.h"
 #include "shared_uniform.h"
+#include "camera.h"
+#include "brickcache.h"
+#include "profiler.h"
+#include "raycast.h"
 #include <thread>
 
 u32 texHandle = 0;
@@ -53,7 +57,7 @@ void DrawRasterField(const RasterField& field, GLProgram& prog)
     g_sharedUniforms.df_translation = vec4(field.m_translation.x, field.m_translation.y, field.m_translation.z, 1.0f / RF_CAP);
     g_sharedUniforms.df_scale = vec4(field.m_scale.x, field.m_scale.y, field.m_scale.z, g_sharedUniforms.df_scale.w);
 
-    prog.bind3DTexture(RASTER_FIELD_BINDING, texHandle, "distance_field");
+    prog.bind3DTexture(RASTER_FIELD_BINDING, texHandle, HS("distance_field"));
     glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, RF_CAP, RF_CAP, RF_CAP, 0, GL_RED, GL_FLOAT, field.m_field); DebugGL();
 
     mesh.draw();
@@ -68,7 +72,7 @@ void RasterField::updateColumn(const SDFList& sdfs, const u32 column)
         {
             for(u32 uz = 0; uz < RF_CAP; ++uz)
             {
-                const vec3 p = m_scale * (m_translation + vec3(float(ux), float(uy), float(uz)));
+                const vec3 p = voxelPosition(vec3(float(ux), float(uy), float(uz)));
                 m_field[ux][uy][uz] = SDFDis(sdfs, p);
             }
         }
@@ -89,8 +93,299 @@ void RasterField::update(const SDFList& sdfs, const u32 num_threads)
         threads[i].join();
     }
     #endif
-    for(u32 i = 0; i < RF_CAP; ++i)
+
+    // full bake, still routed through bricks so unchanged regions hit the brick cache
+    m_numBaked = 0;
+    for(u32 bx = 0; bx < RF_BRICKS; ++bx)
+    {
+        for(u32 by = 0; by < RF_BRICKS; ++by)
+        {
+            for(u32 bz = 0; bz < RF_BRICKS; ++bz)
+            {
+                m_bricks[bx][by][bz] = BRICK_SURFACE;
+                bakeBrick(sdfs, bx, by, bz);
+            }
+        }
+    }
+}
+
+// ------------------------------------------------------------------------
+
+void RasterField::updateCoarse(const SDFList& sdfs)
+{
+    // bricks whose samples all share a sign and sit further than a brick radius 
+    // from the surface are never baked; they hold the coarse value less the
+    // brick radius.
+    const float radius = 0.5f * glm::length(m_scale * float(RF_BRICK));
+    const float edge = float(RF_BRICK - 1);
+    m_numBaked = 0;
+
+    for(u32 bx = 0; bx < RF_BRICKS; ++bx)
+    {
+        for(u32 by = 0; by < RF_BRICKS; ++by)
+        {
+            for(u32 bz = 0; bz < RF_BRICKS; ++bz)
+            {
+                const vec3 lo = vec3(float(bx), float(by), float(bz)) * float(RF_BRICK);
+                const float dis = SDFDis(sdfs, voxelPosition(lo + vec3(0.5f * edge)));
+
+                bool surface = glm::abs(dis) < radius;
+                for(u32 i = 0; i < 8 && !surface; ++i)
+                {
+                    vec3 corner = lo;
+                    corner.x += (i & 1) ? edge : 0.0f;
+                    corner.y += (i & 2) ? edge : 0.0f;
+                    corner.z += (i & 4) ? edge : 0.0f;
+                    const float cdis = SDFDis(sdfs, voxelPosition(corner));
+                    surface = (cdis < 0.0f) != (dis < 0.0f);
+                }
+
+                m_coarse[bx][by][bz] = dis;
+                m_bricks[bx][by][bz] = surface ? BRICK_SURFACE : BRICK_EMPTY;
+
+                // the centre value is no bound for the rest of the brick: pull it
+                // toward zero by the brick radius so tracing never oversteps.
+                // empty bricks have |dis| >= radius, so the sign is kept.
+                const float fill = dis > 0.0f ? dis - radius : dis + radius;
+                for(u32 x = bx * RF_BRICK; x < (bx + 1) * RF_BRICK; ++x)
+                {
+                    for(u32 y = by * RF_BRICK; y < (by + 1) * RF_BRICK; ++y)
+                    {
+                        for(u32 z = bz * RF_BRICK; z < (bz + 1) * RF_BRICK; ++z)
+                        {
+                            m_field[x][y][z] = fill;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void RasterField::bakeBrick(const SDFList& sdfs, const u32 bx, const u32 by, const u32 bz)
+{
+    Assert(bx < RF_BRICKS && by < RF_BRICKS && bz < RF_BRICKS);
+    if(m_bricks[bx][by][bz] == BRICK_BAKED)
+        return;
+
+    const vec3 lo = vec3(float(bx), float(by), float(bz)) * float(RF_BRICK);
+    const vec3 origin = voxelPosition(lo);
+    const vec3 center = voxelPosition(lo + vec3(0.5f * float(RF_BRICK - 1)));
+    const float radius = 0.5f * glm::length(m_scale * float(RF_BRICK));
+
+    // unions and differences that stay positive over the whole brick cannot 
+    // move its surface; they are folded into a conservative floor instead.
+    // distances are scaled by lipschitz as primitives shrunk below unit scale
+    // overestimate them.
+    // long lists spill into the thread's arena, reset when the brick is done
+    ArenaScope scope;
+    ArenaVector<u16, 16> indices;
+    float floorDis = 1000.0f;
+    const float lipschitz = SafeRelaxation(sdfs);
+    const u16 numSdfs = u16(sdfs.count());
+    for(u16 i = 0; i < numSdfs; ++i)
+    {
+        const SDF& sdf = sdfs[i];
+        const bool smooth = sdf.blend_type >= SDF_S_UNION;
+        const bool cullable = sdf.blend_type != SDF_INTER && sdf.blend_type != SDF_S_INTER;
+        const float margin = radius + (smooth ? sdf.smoothness : 0.0f);
+        const float dis = sdf.distance(center) * lipschitz;
+        if(cullable && dis > margin)
+        {
+            if(sdf.blend_type == SDF_UNION || sdf.blend_type == SDF_S_UNION)
+            {
+                floorDis = glm::min(floorDis, dis - radius);
+            }
+        }
+        else
+        {
+            indices.grow() = i;
+        }
+    }
+
+    const float head[4] = { m_scale.x, m_scale.y, m_scale.z, floorDis };
+    u64 key = hash64(head, sizeof(head));
+    for(const u16 i : indices)
+    {
+        key = sdfs[i].hash(origin, key);
+    }
+
+    const float* cached = g_BrickCache.get(key);
+    if(cached)
+    {
+        for(u32 x = 0; x < RF_BRICK; ++x)
+        {
+            for(u32 y = 0; y < RF_BRICK; ++y)
+            {
+                for(u32 z = 0; z < RF_BRICK; ++z)
+                {
+                    m_field[bx * RF_BRICK + x][by * RF_BRICK + y][bz * RF_BRICK + z] = *cached++;
+                }
+            }
+        }
+    }
+    else
+    {
+        float* dst = g_BrickCache.insert(key);
+        for(u32 x = 0; x < RF_BRICK; ++x)
+        {
+            for(u32 y = 0; y < RF_BRICK; ++y)
+            {
+                for(u32 z = 0; z < RF_BRICK; ++z)
+                {
+                    const vec3 p = voxelPosition(lo + vec3(float(x), float(y), float(z)));
+                    const float dis = glm::min(SDFDis(sdfs, indices, p), floorDis);
+                    m_field[bx * RF_BRICK + x][by * RF_BRICK + y][bz * RF_BRICK + z] = dis;
+                    *dst++ = dis;
+                }
+            }
+        }
+    }
+
+    m_bricks[bx][by][bz] = BRICK_BAKED;
+    ++m_numBaked;
+}
+
+// walks the brick grid along one ray (in brick space) and bakes every surface 
+// brick it crosses, stopping once the ray enters a solid interior brick.
+static u32 TraceBricks(RasterField& field, const SDFList& sdfs, const vec3 ro, vec3 rd)
+{
+    for(s32 i = 0; i < 3; ++i)
     {
-        updateColumn(sdfs, i);
+        if(glm::abs(rd[i]) < 0.000001f)
+        {
+            rd[i] = rd[i] < 0.0f ? -0.000001f : 0.000001f;
+        }
     }
+
+    const vec3 inv = 1.0f / rd;
+    const vec3 t0 = (vec3(0.0f) - ro) * inv;
+    const vec3 t1 = (vec3(float(RF_BRICKS)) - ro) * inv;
+    const vec3 tlo = glm::min(t0, t1);
+    const vec3 thi = glm::max(t0, t1);
+    const float tenter = glm::max(0.0f, glm::max(tlo.x, glm::max(tlo.y, tlo.z)));
+    const float texit = glm::min(1.0f, glm::min(thi.x, glm::min(thi.y, thi.z)));
+    if(tenter > texit)
+        return 0;
+
+    const vec3 start = ro + rd * tenter;
+    ivec3 cell = glm::clamp(ivec3(glm::floor(start)), ivec3(0), ivec3(RF_BRICKS - 1));
+    const ivec3 step = ivec3(glm::sign(rd));
+    const vec3 tdelta = glm::abs(inv);
+    vec3 tmax;
+    for(s32 i = 0; i < 3; ++i)
+    {
+        const float boundary = float(cell[i] + (step[i] > 0 ? 1 : 0));
+        tmax[i] = tenter + (boundary - start[i]) * inv[i];
+    }
+
+    // one sample per voxel when walking through baked bricks
+    const float tvoxel = 1.0f / (float(RF_BRICK) * glm::length(rd));
+
+    u32 baked = 0;
+    float tcell = tenter;
+    while(true)
+    {
+        s32 axis = 0;
+        if(tmax.y < tmax[axis]) axis = 1;
+        if(tmax.z < tmax[axis]) axis = 2;
+        const float tnext = glm::min(tmax[axis], texit);
+
+        BrickState& state = field.m_bricks[cell.x][cell.y][cell.z];
+        if(state == BRICK_SURFACE)
+        {
+            field.bakeBrick(sdfs, u32(cell.x), u32(cell.y), u32(cell.z));
+            ++baked;
+        }
+        else if(state == BRICK_EMPTY && field.m_coarse[cell.x][cell.y][cell.z] < 0.0f)
+        {
+            break;
+        }
+
+        if(state == BRICK_BAKED)
+        {
+            bool hit = false;
+            for(float t = tcell; t <= tnext && !hit; t += tvoxel)
+            {
+                const ivec3 v = glm::clamp(ivec3((ro + rd * t) * float(RF_BRICK)), ivec3(0), ivec3(RF_CAP - 1));
+                hit = field.m_field[v.x][v.y][v.z] < 0.0f;
+            }
+            if(hit)
+                break;
+        }
+
+        if(tmax[axis] > texit)
+            break;
+
+        tcell = tmax[axis];
+        cell[axis] += step[axis];
+        if(cell[axis] < 0 || cell[axis] >= RF_BRICKS)
+            break;
+        tmax[axis] += tdelta[axis];
+    }
+
+    return baked;
+}
+
+u32 RasterField::updateVisible(const SDFList& sdfs, const Camera& cam, const u32 rays_x, const u32 rays_y)
+{
+    const mat4 IVP = glm::inverse(cam.getVP());
+    const vec3 ro = toVoxel(cam.getEye()) / float(RF_BRICK);
+
+    u32 baked = 0;
+    for(u32 ry = 0; ry < rays_y; ++ry)
+    {
+        for(u32 rx = 0; rx < rays_x; ++rx)
+        {
+            const vec2 ndc = vec2(
+                (float(rx) + 0.5f) / float(rays_x), 
+                (float(ry) + 0.5f) / float(rays_y)) * 2.0f - 1.0f;
+            const vec4 farPt = IVP * vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+            const vec3 target = toVoxel(vec3(farPt) / farPt.w) / float(RF_BRICK);
+            baked += TraceBricks(*this, sdfs, ro, target - ro);
+        }
+    }
+
+    return baked;
+}
+
+void RasterFieldLazyBakeTest(const SDFList& sdfs)
+{
+    // covers [-2, 2]^3 in world space
+    RasterField* field = new RasterField();
+    field->m_scale = vec3(4.0f / float(RF_CAP));
+    field->m_translation = vec3(-0.5f * float(RF_CAP));
+    field->updateCoarse(sdfs);
+
+    u32 num_surface = 0;
+    const BrickState* b = &field->m_bricks[0][0][0];
+    for(u32 i = 0; i < field->totalBricks(); ++i)
+    {
+        num_surface += b[i] != BRICK_EMPTY ? 1 : 0;
+    }
+    printf("[RasterField] %u surface bricks of %u total\n", num_surface, field->totalBricks());
+    if(!ALLOC_COUNTING)
+        printf("[RasterField] built without ALLOC_COUNTING, alloc counts read 0\n");
+
+    // orbit around the field, then dolly in towards the origin
+    const u32 num_steps = 16;
+    for(u32 i = 0; i < num_steps; ++i)
+    {
+        const float angle = glm::radians(360.0f * float(i) / float(num_steps));
+        const float dist = i < num_steps / 2 ? 4.0f : 4.0f - 2.5f * float(i - num_steps / 2) / float(num_steps / 2);
+        const vec3 eye = vec3(glm::cos(angle), 0.35f, glm::sin(angle)) * dist;
+
+        Camera cam;
+        cam.setEye(eye);
+        cam.yaw(-90.0f - glm::degrees(glm::atan(-eye.z, -eye.x)));
+        cam.update();
+
+        const u64 allocs = AllocCount();
+        const u32 baked = field->updateVisible(sdfs, cam);
+        printf("[RasterField] step %2u: +%3u bricks, %4u / %u baked (%.1f%%), %u allocs\n", 
+            i, baked, field->bakedBricks(), field->totalBricks(), 
+            100.0f * float(field->bakedBricks()) / float(field->totalBricks()), u32(AllocCount() - allocs));
+    }
+
+    delete field;
 }
\ No newline at end of file
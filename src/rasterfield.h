@@ -6,29 +6,68 @@
 #include "sdf.h"
 
 #define RF_CAP 64
+#define RF_BRICK 8
+#define RF_BRICKS (RF_CAP / RF_BRICK)
 #define RASTER_FIELD_BINDING 9
 
 struct GLProgram;
+class Camera;
+
+enum BrickState : u8
+{
+    BRICK_EMPTY = 0,    // coarse pass found no surface in this brick
+    BRICK_SURFACE,      // near the surface, not yet baked
+    BRICK_BAKED,        // fine values written into m_field
+};
 
 struct RasterField
 {
     float m_field[RF_CAP][RF_CAP][RF_CAP];
+    float m_coarse[RF_BRICKS][RF_BRICKS][RF_BRICKS];
+    BrickState m_bricks[RF_BRICKS][RF_BRICKS][RF_BRICKS];
     vec3 m_translation;
     vec3 m_scale;
+    u32 m_numBaked;
     RasterField()
     {
         m_translation = vec3(0.0f);
         m_scale = vec3(1.0f);
+        m_numBaked = 0;
         float* p = &m_field[0][0][0];
         const u32 count = RF_CAP * RF_CAP * RF_CAP;
         for(u32 i = 0; i < count; ++i)
         {
             p[i] = 0.0f;
         }
+        float* c = &m_coarse[0][0][0];
+        BrickState* b = &m_bricks[0][0][0];
+        const u32 num_bricks = RF_BRICKS * RF_BRICKS * RF_BRICKS;
+        for(u32 i = 0; i < num_bricks; ++i)
+        {
+            c[i] = 0.0f;
+            b[i] = BRICK_EMPTY;
+        }
     }
+    vec3 voxelPosition(const vec3& v) const
+    {
+        return m_scale * (m_translation + v);
+    }
+    vec3 toVoxel(const vec3& p) const
+    {
+        return p / m_scale - m_translation;
+    }
+    u32 bakedBricks() const { return m_numBaked; }
+    u32 totalBricks() const { return RF_BRICKS * RF_BRICKS * RF_BRICKS; }
     void updateColumn(const SDFList& sdfs, const u32 column);
     void update(const SDFList& sdfs, const u32 num_threads=8);
+
+    // demand driven baking: updateCoarse classifies bricks cheaply, 
+    // updateVisible bakes only the surface bricks the camera can see.
+    void updateCoarse(const SDFList& sdfs);
+    void bakeBrick(const SDFList& sdfs, const u32 bx, const u32 by, const u32 bz);
+    u32 updateVisible(const SDFList& sdfs, const Camera& cam, const u32 rays_x=64, const u32 rays_y=36);
 };
 
 void InitRasterFields();
 void DrawRasterField(const RasterField& field, GLProgram& prog);
+void RasterFieldLazyBakeTest(const SDFList& sdfs);
@@ -0,0 +1,234 @@
+#include "raycast.h"
+#include "sdfsampler.h"
+#include "parallelfor.h"
+#include "randf.h"
+#include "cputimer.h"
+#include <cstdio>
+
+template<typename S>
+static void TracePacket(const S& sampler, const Ray* rays, RayHit* hits, const u32 n, const RayCastParams& params)
+{
+    const s32 G = RAY_PACKET_SIZE / 4;
+
+    vec3x4 ro[G], rd[G];
+    f4 tmax[G], t[G], tPrev[G], prevR[G], stepLen[G], omega[G], steps[G], active[G], hit[G];
+
+    const f4 zero(0.0f), one(1.0f), eps(params.epsilon);
+    const f4 lanes(0.0f, 1.0f, 2.0f, 3.0f);
+    for(s32 g = 0; g < G; ++g)
+    {
+        float ox[4], oy[4], oz[4], dx[4], dy[4], dz[4], tm[4];
+        for(s32 l = 0; l < 4; ++l)
+        {
+            const u32 idx = u32(g * 4 + l);
+            const Ray& ray = rays[idx < n ? idx : n - 1];
+            ox[l] = ray.origin.x; oy[l] = ray.origin.y; oz[l] = ray.origin.z;
+            dx[l] = ray.direction.x; dy[l] = ray.direction.y; dz[l] = ray.direction.z;
+            tm[l] = ray.tmax;
+        }
+        ro[g] = vec3x4(f4::load(ox), f4::load(oy), f4::load(oz));
+        rd[g] = vec3x4(f4::load(dx), f4::load(dy), f4::load(dz));
+        tmax[g] = f4::load(tm);
+        t[g] = zero;
+        tPrev[g] = zero;
+        prevR[g] = zero;
+        stepLen[g] = zero;
+        omega[g] = f4(params.relaxation);
+        steps[g] = zero;
+        active[g] = (lanes + f4(float(g * 4))) < f4(float(n));
+        hit[g] = zero < zero;
+    }
+
+    for(u32 i = 0; i < params.max_steps; ++i)
+    {
+        bool any_active = false;
+        for(s32 g = 0; g < G; ++g)
+        {
+            if(!any(active[g]))
+                continue;
+            any_active = true;
+
+            const f4 dis = sampler.distance(ro[g] + rd[g] * t[g]);
+            steps[g] = steps[g] + (active[g] & one);
+
+            // the unbounding spheres of the last two steps no longer overlap:
+            // the relaxed step may have skipped a surface
+            const f4 fail = active[g] & (omega[g] > one) & ((abs(dis) + prevR[g]) < stepLen[g]);
+            const f4 ok = andnot(fail, active[g]);
+            const f4 hitNow = ok & (dis < eps);
+            const f4 missNow = andnot(hitNow, ok & (t[g] > tmax[g]));
+            const f4 done = hitNow | missNow;
+            const f4 advance = andnot(done, ok);
+
+            hit[g] = hit[g] | hitNow;
+            active[g] = andnot(done, active[g]);
+
+            t[g] = select(fail, tPrev[g] + prevR[g], t[g]);
+            omega[g] = select(fail, one, omega[g]);
+
+            const f4 step = omega[g] * dis;
+            tPrev[g] = select(advance, t[g], tPrev[g]);
+            prevR[g] = select(advance, abs(dis), prevR[g]);
+            stepLen[g] = select(advance, step, stepLen[g]);
+            t[g] = select(advance, t[g] + step, t[g]);
+        }
+        if(!any_active)
+            break;
+    }
+
+    for(s32 g = 0; g < G; ++g)
+    {
+        const vec3x4 p = ro[g] + rd[g] * t[g];
+        f4 dis;
+        vec3x4 N;
+        sampler.sample(p, dis, N);
+        const s32 hitBits = movemask(hit[g]);
+        for(s32 l = 0; l < 4; ++l)
+        {
+            const u32 idx = u32(g * 4 + l);
+            if(idx >= n)
+                break;
+            RayHit& h = hits[idx];
+            h.position = vec3(p.x[l], p.y[l], p.z[l]);
+            h.normal = vec3(N.x[l], N.y[l], N.z[l]);
+            h.t = t[g][l];
+            h.steps = u32(steps[g][l]);
+            h.hit = (hitBits >> l) & 1;
+        }
+    }
+}
+
+template<typename S>
+static void TraceRays(const S& sampler, const Ray* rays, RayHit* hits, const u32 count, const RayCastParams& params)
+{
+    const u32 num_packets = (count + RAY_PACKET_SIZE - 1) / RAY_PACKET_SIZE;
+    ParallelFor(num_packets, params.num_threads, 64, 1, [&](u32 begin, u32 end)
+    {
+        for(u32 i = begin; i < end; ++i)
+        {
+            const u32 first = i * RAY_PACKET_SIZE;
+            const u32 n = glm::min(u32(RAY_PACKET_SIZE), count - first);
+            TracePacket(sampler, rays + first, hits + first, n, params);
+        }
+    });
+}
+
+void RayCast(const SDFList& sdfs, const Ray* rays, RayHit* hits, const u32 count, const RayCastParams& params)
+{
+    TraceRays(ListSampler(sdfs), rays, hits, count, params);
+}
+
+void RayCast(const RasterField& field, const Ray* rays, RayHit* hits, const u32 count, const RayCastParams& params)
+{
+    TraceRays(FieldSampler(field), rays, hits, count, params);
+}
+
+RayHit RayCast(const SDFList& sdfs, const Ray& ray, const RayCastParams& params)
+{
+    RayHit hit;
+    TracePacket(ListSampler(sdfs), &ray, &hit, 1, params);
+    return hit;
+}
+
+bool LineOfSight(const SDFList& sdfs, const vec3& from, const vec3& to, const RayCastParams& params)
+{
+    Ray ray;
+    ray.origin = from;
+    ray.tmax = glm::length(to - from);
+    ray.direction = (to - from) / glm::max(ray.tmax, 0.000001f);
+    const RayHit hit = RayCast(sdfs, ray, params);
+    return !hit.hit || hit.t >= ray.tmax;
+}
+
+float SafeRelaxation(const SDFList& sdfs)
+{
+    float relaxation = 1.0f;
+    for(const SDF& sdf : sdfs)
+    {
+        relaxation = glm::min(relaxation, glm::min(sdf.scale.x, glm::min(sdf.scale.y, sdf.scale.z)));
+    }
+    return relaxation;
+}
+
+// ------------------------------------------------------------------------
+
+void RayCastBench()
+{
+    // unit scale primitives keep the field an exact distance, which relaxation relies on
+    SDFList sdfs;
+    for(u32 i = 0; i < 16; ++i)
+    {
+        SDF& sdf = sdfs.grow();
+        sdf.type = (i & 1) ? SDF_BOX : SDF_SPHERE;
+        sdf.translation = vec3(randf() * 12.0f - 6.0f, randf() * 2.0f - 1.0f, randf() * 12.0f - 16.0f);
+        sdf.scale = vec3(1.0f);
+    }
+
+    const u32 width = 256, height = 256;
+    const u32 count = width * height;
+    Ray* rays = new Ray[count];
+    RayHit* hits = new RayHit[count];
+    const vec3 eye = vec3(0.0f, 0.5f, 4.0f);
+    for(u32 y = 0; y < height; ++y)
+    {
+        for(u32 x = 0; x < width; ++x)
+        {
+            const vec2 uv = vec2((float(x) + 0.5f) / width, (float(y) + 0.5f) / height) * 2.0f - 1.0f;
+            Ray& ray = rays[y * width + x];
+            ray.origin = eye;
+            ray.direction = glm::normalize(vec3(uv.x * 0.6f, uv.y * 0.6f, -1.0f));
+            ray.tmax = 20.0f;
+        }
+    }
+
+    // plain scalar sphere tracing, one ray at a time
+    {
+        RayCastParams params;
+        CPUTimer timer;
+        u64 steps = 0;
+        u32 num_hit = 0;
+        for(u32 i = 0; i < count; ++i)
+        {
+            const Ray& ray = rays[i];
+            float t = 0.0f;
+            for(u32 s = 0; s < params.max_steps; ++s)
+            {
+                ++steps;
+                const float dis = SDFDis(sdfs, ray.origin + ray.direction * t);
+                if(dis < params.epsilon)
+                {
+                    ++num_hit;
+                    break;
+                }
+                t += dis;
+                if(t > ray.tmax)
+                    break;
+            }
+        }
+        printf("[RayCast] scalar    : %6.3f Mrays/s/core, %5.1f steps/ray, %u hits\n",
+            count / timer.seconds() * 1e-6, double(steps) / count, num_hit);
+    }
+
+    const float relaxations[2] = { 1.0f, 1.6f };
+    for(const float relaxation : relaxations)
+    {
+        RayCastParams params;
+        params.relaxation = relaxation;
+        CPUTimer timer;
+        RayCast(sdfs, rays, hits, count, params);
+        const double secs = timer.seconds();
+
+        u64 steps = 0;
+        u32 num_hit = 0;
+        for(u32 i = 0; i < count; ++i)
+        {
+            steps += hits[i].steps;
+            num_hit += hits[i].hit ? 1 : 0;
+        }
+        printf("[RayCast] packet x%d, relaxation %.1f: %6.3f Mrays/s/core, %5.1f steps/ray, %u hits\n",
+            RAY_PACKET_SIZE, relaxation, count / secs * 1e-6, double(steps) / count, num_hit);
+    }
+
+    delete[] rays;
+    delete[] hits;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ints.h"
+#include "linmath.h"
+#include "sdf.h"
+
+struct RasterField;
+
+// rays are traced in packets of RAY_PACKET_SIZE, as groups of 4 simd lanes
+#define RAY_PACKET_SIZE 8
+
+struct Ray
+{
+    vec3 origin;
+    vec3 direction;     // normalised
+    float tmax = 100.0f;
+};
+
+struct RayHit
+{
+    vec3 position;
+    vec3 normal;
+    float t;
+    u32 steps;
+    bool hit;
+};
+
+struct RayCastParams
+{
+    float epsilon = 0.001f;
+    float relaxation = 1.6f;    // over-relaxation factor, 1 is plain sphere tracing
+    u32 max_steps = 128;
+    u32 num_threads = 1;        // 0 picks std::thread::hardware_concurrency()
+};
+
+// Over-relaxed sphere tracing (Keinert et al. 2014): each step is scaled by
+// relaxation until consecutive unbounding spheres stop overlapping, at which
+// point the lane falls back to the last safe step and plain sphere tracing.
+// the overlap test assumes the field never overestimates distance; primitives
+// scaled below 1 do, so trace those with SafeRelaxation, which under-relaxes.
+void RayCast(const SDFList& sdfs, const Ray* rays, RayHit* hits, const u32 count, const RayCastParams& params = RayCastParams());
+void RayCast(const RasterField& field, const Ray* rays, RayHit* hits, const u32 count, const RayCastParams& params = RayCastParams());
+
+// single ray convenience for picking and line of sight
+RayHit RayCast(const SDFList& sdfs, const Ray& ray, const RayCastParams& params = RayCastParams());
+bool LineOfSight(const SDFList& sdfs, const vec3& from, const vec3& to, const RayCastParams& params = RayCastParams());
+
+// SDF::distance is in the primitive's local units, so it overestimates by up to
+// 1 / scale; a relaxation of the smallest scale keeps every step conservative.
+float SafeRelaxation(const SDFList& sdfs);
+
+void RayCastBench();
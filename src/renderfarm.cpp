@@ -0,0 +1,708 @@
+#include "renderfarm.h"
+#include "randf.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <thread>
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+
+static const FarmSocket FARM_INVALID = (FarmSocket)INVALID_SOCKET;
+static void CloseSocket(FarmSocket s){ closesocket((SOCKET)s); }
+static void InitSockets()
+{
+    static bool init = false;
+    if(!init)
+    {
+        WSADATA data;
+        WSAStartup(MAKEWORD(2, 2), &data);
+        init = true;
+    }
+}
+
+#else
+
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <signal.h>
+#include <unistd.h>
+
+static const FarmSocket FARM_INVALID = -1;
+static void CloseSocket(FarmSocket s){ close(s); }
+static void InitSockets()
+{
+    // a worker dying mid send must not take the coordinator with it
+    signal(SIGPIPE, SIG_IGN);
+}
+
+#endif
+
+// ------------------------------------------------------------------------
+
+enum FarmMessage : u32
+{
+    FARM_JOB = 1,   // FarmJob followed by the scene's SDFs
+    FARM_TILE,      // FarmTileMsg
+    FARM_RESULT,    // FarmTileMsg followed by the tile's rgba8 rows
+    FARM_QUIT,
+};
+
+enum TileState : u8
+{
+    TILE_PENDING = 0,
+    TILE_INFLIGHT,
+    TILE_DONE,
+};
+
+struct FarmHeader
+{
+    u32 type;
+    u32 size;
+};
+
+struct FarmJob
+{
+    u32 frame;
+    u32 num_sdfs;
+    vec3 eye;
+    mat4 IVP;
+    CPUSun sun;
+    CPURenderParams params;
+};
+
+struct FarmTileMsg
+{
+    u32 frame;
+    u32 index;
+};
+
+static bool SendAll(FarmSocket s, const void* data, u32 size)
+{
+    const char* p = (const char*)data;
+    while(size)
+    {
+        const s32 n = (s32)::send(s, p, size, 0);
+        if(n <= 0)
+            return false;
+        p += n;
+        size -= u32(n);
+    }
+    return true;
+}
+
+static bool RecvAll(FarmSocket s, void* data, u32 size)
+{
+    char* p = (char*)data;
+    while(size)
+    {
+        const s32 n = (s32)::recv(s, p, size, 0);
+        if(n <= 0)
+            return false;
+        p += n;
+        size -= u32(n);
+    }
+    return true;
+}
+
+static void SetNoDelay(FarmSocket s)
+{
+    s32 one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+}
+
+// ------------------------------------------------------------------------
+
+RenderFarm::RenderFarm() : m_numConns(0), m_listen(FARM_INVALID), m_port(0), m_frame(0), m_numLocal(0)
+{
+}
+
+RenderFarm::~RenderFarm()
+{
+    shutdown();
+}
+
+bool RenderFarm::listen(const u16 port)
+{
+    InitSockets();
+
+    m_listen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if(m_listen == FARM_INVALID)
+    {
+        puts("[RenderFarm] could not create socket");
+        return false;
+    }
+
+    s32 one = 1;
+    setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if(bind(m_listen, (const sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(m_listen, FARM_MAX_WORKERS) != 0)
+    {
+        printf("[RenderFarm] could not listen on port %u\n", u32(port));
+        CloseSocket(m_listen);
+        m_listen = FARM_INVALID;
+        return false;
+    }
+
+    socklen_t len = sizeof(addr);
+    getsockname(m_listen, (sockaddr*)&addr, &len);
+    m_port = ntohs(addr.sin_port);
+    return true;
+}
+
+bool RenderFarm::spawnLocal(const u32 count)
+{
+    if(m_listen == FARM_INVALID && !listen(0))
+        return false;
+
+    for(u32 i = 0; i < count && m_numLocal < FARM_MAX_WORKERS; ++i)
+    {
+#ifdef _WIN32
+        char exe[MAX_PATH];
+        GetModuleFileNameA(nullptr, exe, MAX_PATH);
+        char cmd[MAX_PATH + 64];
+        snprintf(cmd, sizeof(cmd), "\"%s\" --worker 127.0.0.1 %u", exe, u32(m_port));
+
+        STARTUPINFOA si;
+        memset(&si, 0, sizeof(si));
+        si.cb = sizeof(si);
+        PROCESS_INFORMATION pi;
+        if(!CreateProcessA(nullptr, cmd, nullptr, nullptr, FALSE, 0, nullptr, nullptr, &si, &pi))
+        {
+            puts("[RenderFarm] could not start worker process");
+            return false;
+        }
+        CloseHandle(pi.hThread);
+        m_local[m_numLocal++] = (s64)pi.hProcess;
+#else
+        fflush(stdout);
+        const pid_t pid = fork();
+        if(pid < 0)
+        {
+            puts("[RenderFarm] could not fork worker process");
+            return false;
+        }
+        if(pid == 0)
+        {
+            // the child only keeps its own connection
+            CloseSocket(m_listen);
+            for(u32 j = 0; j < m_numConns; ++j)
+            {
+                CloseSocket(m_conns[j].m_socket);
+            }
+            _exit(FarmWorker("127.0.0.1", m_port));
+        }
+        m_local[m_numLocal++] = pid;
+#endif
+    }
+    return true;
+}
+
+void RenderFarm::killLocal(const u32 index)
+{
+    Assert(index < m_numLocal);
+#ifdef _WIN32
+    TerminateProcess((HANDLE)m_local[index], 1);
+#else
+    kill((pid_t)m_local[index], SIGKILL);
+#endif
+}
+
+void RenderFarm::accept()
+{
+    const FarmSocket s = ::accept(m_listen, nullptr, nullptr);
+    if(s == FARM_INVALID)
+        return;
+    if(m_numConns >= FARM_MAX_WORKERS)
+    {
+        CloseSocket(s);
+        return;
+    }
+
+    SetNoDelay(s);
+    FarmConnection& conn = m_conns[m_numConns++];
+    conn.m_socket = s;
+    conn.m_frame = ~0u;
+    conn.m_numInflight = 0;
+    conn.m_buffer = nullptr;
+    conn.m_buffered = 0;
+    conn.m_capacity = 0;
+    conn.m_lastSeen.begin();
+}
+
+void RenderFarm::drop(const u32 i, u8* tile_state, u8* tile_copies, FarmStats& stats)
+{
+    FarmConnection& conn = m_conns[i];
+    for(u32 k = 0; k < conn.m_numInflight; ++k)
+    {
+        const u32 tile = conn.m_inflight[k];
+        if(tile_state[tile] != TILE_DONE && --tile_copies[tile] == 0)
+        {
+            tile_state[tile] = TILE_PENDING;
+            ++stats.requeued;
+        }
+    }
+    ++stats.workers_lost;
+
+    CloseSocket(conn.m_socket);
+    delete[] conn.m_buffer;
+    m_conns[i] = m_conns[--m_numConns];
+}
+
+bool RenderFarm::send(FarmConnection& conn, const u32 type, const void* a, const u32 a_size, const void* b, const u32 b_size)
+{
+    const FarmHeader header = { type, a_size + b_size };
+    return SendAll(conn.m_socket, &header, sizeof(header))
+        && SendAll(conn.m_socket, a, a_size)
+        && (!b_size || SendAll(conn.m_socket, b, b_size));
+}
+
+bool RenderFarm::render(const SDFList& sdfs, const vec3& eye, const mat4& VP, const CPUSun& sun,
+    const CPURenderParams& params, u8* rgba, FarmStats* stats)
+{
+    if(m_listen == FARM_INVALID)
+        return false;
+
+    FarmStats local_stats;
+    FarmStats& st = stats ? *stats : local_stats;
+    st = FarmStats();
+
+    ++m_frame;
+    FarmJob job;
+    job.frame = m_frame;
+    job.num_sdfs = u32(sdfs.count());
+    job.eye = eye;
+    job.IVP = glm::inverse(VP);
+    job.sun = sun;
+    job.params = params;
+
+    const u32 num_tiles = CPUTileCount(params);
+    const u32 stride = params.width * 4;
+    u8* state = new u8[num_tiles]();
+    u8* copies = new u8[num_tiles]();
+    u32* serial = new u32[num_tiles];
+    u32 next_serial = 0;
+    u32 next_pending = 0;
+    u32 num_done = 0;
+    st.tiles = num_tiles;
+
+    for(u32 i = 0; i < m_numConns; ++i)
+    {
+        m_conns[i].m_numInflight = 0;
+    }
+
+    bool ok = true;
+    CPUTimer alone;
+    while(num_done < num_tiles)
+    {
+        // hand out queued tiles first, then duplicates of the oldest outstanding ones
+        for(u32 i = 0; i < m_numConns; ++i)
+        {
+            FarmConnection& conn = m_conns[i];
+            bool lost = false;
+            if(conn.m_frame != m_frame)
+            {
+                lost = !send(conn, FARM_JOB, &job, sizeof(job), sdfs.begin(), u32(sdfs.bytes()));
+                conn.m_frame = m_frame;
+            }
+            while(!lost && conn.m_numInflight < FARM_IN_FLIGHT)
+            {
+                while(next_pending < num_tiles && state[next_pending] != TILE_PENDING)
+                {
+                    ++next_pending;
+                }
+
+                u32 tile = next_pending;
+                if(tile == num_tiles)
+                {
+                    u32 oldest = ~0u;
+                    for(u32 t = 0; t < num_tiles; ++t)
+                    {
+                        if(state[t] != TILE_INFLIGHT || copies[t] != 1 || serial[t] >= oldest)
+                            continue;
+                        bool held = false;
+                        for(u32 k = 0; k < conn.m_numInflight; ++k)
+                        {
+                            held = held || conn.m_inflight[k] == t;
+                        }
+                        if(!held)
+                        {
+                            oldest = serial[t];
+                            tile = t;
+                        }
+                    }
+                    if(tile == num_tiles)
+                        break;
+                    ++st.stolen;
+                }
+
+                const FarmTileMsg msg = { m_frame, tile };
+                if(!send(conn, FARM_TILE, &msg, sizeof(msg)))
+                {
+                    lost = true;
+                    break;
+                }
+                if(state[tile] == TILE_PENDING)
+                {
+                    state[tile] = TILE_INFLIGHT;
+                    serial[tile] = next_serial++;
+                }
+                ++copies[tile];
+                if(!conn.m_numInflight)
+                {
+                    conn.m_lastSeen.begin();
+                }
+                conn.m_inflight[conn.m_numInflight++] = tile;
+            }
+            if(lost)
+            {
+                puts("[RenderFarm] lost a worker while sending");
+                drop(i--, state, copies, st);
+                next_pending = 0;
+            }
+        }
+
+        if(m_numConns)
+        {
+            alone.begin();
+        }
+        else if(alone.ms() > m_timeoutMs)
+        {
+            puts("[RenderFarm] no workers connected");
+            ok = false;
+            break;
+        }
+
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(m_listen, &fds);
+        FarmSocket max_socket = m_listen;
+        for(u32 i = 0; i < m_numConns; ++i)
+        {
+            FD_SET(m_conns[i].m_socket, &fds);
+            max_socket = m_conns[i].m_socket > max_socket ? m_conns[i].m_socket : max_socket;
+        }
+        timeval timeout = { 0, 100000 };
+        if(select(s32(max_socket + 1), &fds, nullptr, nullptr, &timeout) < 0)
+            continue;
+
+        if(FD_ISSET(m_listen, &fds))
+        {
+            accept();
+        }
+
+        for(u32 i = 0; i < m_numConns; ++i)
+        {
+            FarmConnection& conn = m_conns[i];
+            bool lost = false;
+            if(FD_ISSET(conn.m_socket, &fds))
+            {
+                if(conn.m_capacity - conn.m_buffered < 65536)
+                {
+                    const u32 capacity = glm::max(conn.m_capacity * 2, conn.m_buffered + 65536);
+                    u8* buffer = new u8[capacity];
+                    if(conn.m_buffered)
+                    {
+                        memcpy(buffer, conn.m_buffer, conn.m_buffered);
+                    }
+                    delete[] conn.m_buffer;
+                    conn.m_buffer = buffer;
+                    conn.m_capacity = capacity;
+                }
+
+                const s32 n = (s32)recv(conn.m_socket, (char*)conn.m_buffer + conn.m_buffered, conn.m_capacity - conn.m_buffered, 0);
+                lost = n <= 0;
+                conn.m_buffered += lost ? 0 : u32(n);
+                conn.m_lastSeen.begin();
+
+                u32 offset = 0;
+                while(!lost && conn.m_buffered - offset >= sizeof(FarmHeader))
+                {
+                    FarmHeader header;
+                    memcpy(&header, conn.m_buffer + offset, sizeof(header));
+                    if(conn.m_buffered - offset - sizeof(header) < header.size)
+                        break;
+
+                    const u8* payload = conn.m_buffer + offset + sizeof(header);
+                    offset += sizeof(header) + header.size;
+                    if(header.type != FARM_RESULT || header.size < sizeof(FarmTileMsg))
+                    {
+                        lost = true;
+                        break;
+                    }
+
+                    FarmTileMsg msg;
+                    memcpy(&msg, payload, sizeof(msg));
+                    if(msg.frame != m_frame || msg.index >= num_tiles)
+                        continue;
+
+                    for(u32 k = 0; k < conn.m_numInflight; ++k)
+                    {
+                        if(conn.m_inflight[k] == msg.index)
+                        {
+                            conn.m_inflight[k] = conn.m_inflight[--conn.m_numInflight];
+                            break;
+                        }
+                    }
+                    if(state[msg.index] == TILE_DONE)
+                        continue;
+
+                    const CPUTile tile = CPUTileRect(params, msg.index);
+                    if(header.size != sizeof(msg) + tile.width * tile.height * 4)
+                    {
+                        lost = true;
+                        break;
+                    }
+                    const u8* pixels = payload + sizeof(msg);
+                    for(u32 y = 0; y < tile.height; ++y)
+                    {
+                        memcpy(rgba + (tile.y + y) * stride + tile.x * 4, pixels + y * tile.width * 4, tile.width * 4);
+                    }
+                    state[msg.index] = TILE_DONE;
+                    ++num_done;
+                }
+                if(!lost)
+                {
+                    memmove(conn.m_buffer, conn.m_buffer + offset, conn.m_buffered - offset);
+                    conn.m_buffered -= offset;
+                }
+            }
+            else if(conn.m_numInflight && conn.m_lastSeen.ms() > m_timeoutMs)
+            {
+                puts("[RenderFarm] worker timed out");
+                lost = true;
+            }
+
+            if(lost)
+            {
+                drop(i--, state, copies, st);
+                next_pending = 0;
+            }
+        }
+    }
+
+    delete[] state;
+    delete[] copies;
+    delete[] serial;
+    return ok;
+}
+
+void RenderFarm::shutdown()
+{
+    for(u32 i = 0; i < m_numConns; ++i)
+    {
+        FarmConnection& conn = m_conns[i];
+        send(conn, FARM_QUIT, nullptr, 0);
+        CloseSocket(conn.m_socket);
+        delete[] conn.m_buffer;
+    }
+    m_numConns = 0;
+
+    if(m_listen != FARM_INVALID)
+    {
+        CloseSocket(m_listen);
+        m_listen = FARM_INVALID;
+    }
+
+    for(u32 i = 0; i < m_numLocal; ++i)
+    {
+#ifdef _WIN32
+        WaitForSingleObject((HANDLE)m_local[i], 5000);
+        CloseHandle((HANDLE)m_local[i]);
+#else
+        waitpid((pid_t)m_local[i], nullptr, 0);
+#endif
+    }
+    m_numLocal = 0;
+}
+
+// ------------------------------------------------------------------------
+
+s32 FarmWorker(const char* host, const u16 port)
+{
+    InitSockets();
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    char service[16];
+    snprintf(service, sizeof(service), "%u", u32(port));
+    addrinfo* addr = nullptr;
+    if(getaddrinfo(host, service, &hints, &addr) != 0 || !addr)
+    {
+        printf("[FarmWorker] could not resolve %s\n", host);
+        return 1;
+    }
+
+    // the coordinator may still be starting up
+    FarmSocket s = FARM_INVALID;
+    for(s32 attempt = 0; attempt < 50 && s == FARM_INVALID; ++attempt)
+    {
+        s = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if(s != FARM_INVALID && connect(s, addr->ai_addr, s32(addr->ai_addrlen)) != 0)
+        {
+            CloseSocket(s);
+            s = FARM_INVALID;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    freeaddrinfo(addr);
+    if(s == FARM_INVALID)
+    {
+        printf("[FarmWorker] could not connect to %s:%u\n", host, u32(port));
+        return 1;
+    }
+    SetNoDelay(s);
+
+    SDFList sdfs;
+    FarmJob job;
+    bool have_job = false;
+    u8* buffer = nullptr;
+    u32 capacity = 0;
+    while(true)
+    {
+        FarmHeader header;
+        if(!RecvAll(s, &header, sizeof(header)))
+            break;
+
+        if(header.type == FARM_JOB)
+        {
+            if(header.size < sizeof(job) || !RecvAll(s, &job, sizeof(job)))
+                break;
+            if(header.size != sizeof(job) + job.num_sdfs * sizeof(SDF))
+                break;
+
+            sdfs.clear();
+            bool ok = true;
+            for(u32 i = 0; i < job.num_sdfs && ok; ++i)
+            {
+                ok = RecvAll(s, &sdfs.grow(), sizeof(SDF));
+            }
+            if(!ok)
+                break;
+            have_job = true;
+        }
+        else if(header.type == FARM_TILE)
+        {
+            FarmTileMsg msg;
+            if(header.size != sizeof(msg) || !RecvAll(s, &msg, sizeof(msg)))
+                break;
+            if(!have_job || msg.frame != job.frame || msg.index >= CPUTileCount(job.params))
+                break;
+
+            const CPUTile tile = CPUTileRect(job.params, msg.index);
+            const u32 size = sizeof(msg) + tile.width * tile.height * 4;
+            if(size > capacity)
+            {
+                delete[] buffer;
+                buffer = new u8[size];
+                capacity = size;
+            }
+            memcpy(buffer, &msg, sizeof(msg));
+            CPURenderTile(sdfs, job.eye, job.IVP, job.sun, job.params, tile, buffer + sizeof(msg), tile.width * 4);
+
+            const FarmHeader reply = { FARM_RESULT, size };
+            if(!SendAll(s, &reply, sizeof(reply)) || !SendAll(s, buffer, size))
+                break;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    delete[] buffer;
+    CloseSocket(s);
+    return 0;
+}
+
+// ------------------------------------------------------------------------
+
+void FarmBench()
+{
+    SDFList sdfs;
+    {
+        SDF& floor = sdfs.grow();
+        floor.type = SDF_BOX;
+        floor.translation = vec3(0.0f, -1.5f, 0.0f);
+        floor.scale = vec3(4.0f, 0.25f, 4.0f);
+    }
+    for(u32 i = 0; i < 15; ++i)
+    {
+        SDF& sdf = sdfs.grow();
+        sdf.type = (i & 1) ? SDF_BOX : SDF_SPHERE;
+        sdf.translation = vec3(randf() * 3.0f - 1.5f, randf() * 2.0f - 1.0f, randf() * 3.0f - 1.5f);
+        sdf.scale = vec3(0.2f + randf() * 0.3f);
+    }
+
+    CPURenderParams params;
+    params.width = 640;
+    params.height = 360;
+    params.num_threads = 1;
+    const vec3 eye = vec3(0.0f, 0.5f, 4.0f);
+    const mat4 VP = glm::perspective(glm::radians(90.0f), float(params.width) / float(params.height), 0.1f, 100.0f)
+        * glm::lookAt(eye, vec3(0.0f), vec3(0.0f, 1.0f, 0.0f));
+    const CPUSun sun;
+    const u32 size = params.width * params.height * 4;
+    u8* reference = new u8[size];
+    u8* rgba = new u8[size];
+    CPURender(sdfs, eye, VP, sun, params, reference);
+
+    const u32 worker_counts[3] = { 1, 2, 4 };
+    for(const u32 num_workers : worker_counts)
+    {
+        RenderFarm farm;
+        if(!farm.spawnLocal(num_workers))
+            break;
+
+        // the first frame also pays for workers connecting
+        FarmStats stats;
+        farm.render(sdfs, eye, VP, sun, params, rgba, &stats);
+        memset(rgba, 0, size);
+        CPUTimer timer;
+        const bool ok = farm.render(sdfs, eye, VP, sun, params, rgba, &stats);
+        const double secs = timer.seconds();
+        printf("[RenderFarm] %u workers: %7.3f Mpix/s, %u tiles, %u stolen, %s\n",
+            num_workers, params.width * params.height / secs * 1e-6, stats.tiles, stats.stolen,
+            ok && !memcmp(rgba, reference, size) ? "matches CPURender" : "MISMATCH");
+    }
+
+    {
+        RenderFarm farm;
+        if(farm.spawnLocal(3))
+        {
+            memset(rgba, 0, size);
+            std::thread killer([&]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                farm.killLocal(0);
+            });
+            FarmStats stats;
+            const bool ok = farm.render(sdfs, eye, VP, sun, params, rgba, &stats);
+            killer.join();
+            printf("[RenderFarm] 3 workers, one killed mid frame: %u lost, %u requeued, %u stolen, %s\n",
+                stats.workers_lost, stats.requeued, stats.stolen,
+                ok && !memcmp(rgba, reference, size) ? "matches CPURender" : "MISMATCH");
+        }
+    }
+
+    delete[] reference;
+    delete[] rgba;
+}
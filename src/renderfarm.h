@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ints.h"
+#include "cpurender.h"
+#include "cputimer.h"
+
+// Multi-process tile farm for CPURender. A coordinator listens on a TCP port,
+// sends each connected worker the scene once per frame and then tile indices;
+// workers answer with finished pixels. Workers keep FARM_IN_FLIGHT tiles
+// queued so they never sit idle waiting on the coordinator. Once every tile is
+// handed out, idle workers steal duplicates of the oldest outstanding tiles and
+// the first copy back wins. A worker that disconnects or goes quiet for
+// timeout_ms is dropped and its tiles go back in the queue.
+// messages are raw structs, so every process must run the same build.
+
+#define FARM_DEFAULT_PORT   27960
+#define FARM_MAX_WORKERS    60
+#define FARM_IN_FLIGHT      2
+
+#ifdef _WIN32
+typedef u64 FarmSocket;
+#else
+typedef s32 FarmSocket;
+#endif
+
+struct FarmStats
+{
+    u32 tiles = 0;
+    u32 stolen = 0;         // duplicate dispatches of outstanding tiles
+    u32 requeued = 0;       // tiles returned to the queue by a lost worker
+    u32 workers_lost = 0;
+};
+
+struct FarmConnection
+{
+    FarmSocket m_socket;
+    u32 m_frame;                        // last frame whose job was sent
+    u32 m_inflight[FARM_IN_FLIGHT];     // tiles of the current frame awaiting results
+    u32 m_numInflight;
+    u8* m_buffer;
+    u32 m_buffered;
+    u32 m_capacity;
+    CPUTimer m_lastSeen;
+};
+
+class RenderFarm
+{
+    FarmConnection m_conns[FARM_MAX_WORKERS];
+    u32 m_numConns;
+    FarmSocket m_listen;
+    u16 m_port;
+    u32 m_frame;
+
+    s64 m_local[FARM_MAX_WORKERS];      // pids or process handles of spawned workers
+    u32 m_numLocal;
+
+    void accept();
+    void drop(const u32 i, u8* tile_state, u8* tile_copies, FarmStats& stats);
+    bool send(FarmConnection& conn, const u32 type, const void* a, const u32 a_size, const void* b = nullptr, const u32 b_size = 0);
+public:
+    u32 m_timeoutMs = 10000;
+
+    RenderFarm();
+    ~RenderFarm();
+    // port 0 picks a free one, see port()
+    bool listen(const u16 port = FARM_DEFAULT_PORT);
+    u16 port() const { return m_port; }
+    u32 numWorkers() const { return m_numConns; }
+    // starts count worker processes connected over loopback
+    bool spawnLocal(const u32 count);
+    // hard kills a spawned worker, for exercising worker loss
+    void killLocal(const u32 index);
+    // blocks until every tile of the frame is back
+    bool render(const SDFList& sdfs, const vec3& eye, const mat4& VP, const CPUSun& sun,
+        const CPURenderParams& params, u8* rgba, FarmStats* stats = nullptr);
+    void shutdown();
+};
+
+// worker side: connects to host:port and renders tiles until the coordinator quits
+s32 FarmWorker(const char* host, const u16 port);
+
+void FarmBench();
@@ -10,9 +10,148 @@
 #include "shared_uniform.h"
 #include "randf.h"
 #include "camera.h"
+#include "brickcache.h"
+#include "meshblob.h"
+#include <cfloat>
 
 Renderables g_Renderables;
 
+void LodMesh::upload(const LodChain& chain)
+{
+    m_bounds.lo = vec3(FLT_MAX);
+    m_bounds.hi = vec3(-FLT_MAX);
+    for(const MeshVertex& v : chain.m_levels[0].vertices)
+    {
+        m_bounds.lo = glm::min(m_bounds.lo, v.position);
+        m_bounds.hi = glm::max(m_bounds.hi, v.position);
+    }
+    if(!chain.m_levels[0].vertices.count())
+        m_bounds.lo = m_bounds.hi = vec3(0.0f);
+
+    Vector<PackedVertex> packed;
+    m_count = chain.m_count;
+    for(u32 i = 0; i < m_count; ++i)
+    {
+        const Geometry& geom = chain.m_levels[i];
+        PackGeometry(geom, m_bounds, packed);
+        m_meshes[i].init();
+        m_meshes[i].upload(packed.begin(), u32(packed.count()), geom.indices.begin(), u32(geom.indices.count()));
+        m_errors[i] = chain.m_errors[i];
+    }
+    m_center = chain.m_center;
+    m_radius = chain.m_radius;
+    m_level = 0;
+}
+
+bool LodMesh::load(const char* path)
+{
+    m_meshes[0].init();
+    if(!LoadMeshBlob(path, m_meshes[0], m_bounds))
+    {
+        m_meshes[0].deinit();
+        m_count = 0;
+        return false;
+    }
+    m_errors[0] = 0.0f;
+    m_center = m_bounds.center();
+    m_radius = m_bounds.cornerRadius();
+    m_count = 1;
+    m_level = 0;
+    return true;
+}
+
+void LodMesh::translate(const vec3& offset)
+{
+    m_bounds.lo += offset;
+    m_bounds.hi += offset;
+    m_center += offset;
+}
+
+void LodMesh::deinit()
+{
+    for(u32 i = 0; i < m_count; ++i)
+    {
+        m_meshes[i].deinit();
+    }
+    m_count = 0;
+}
+
+void LodMesh::upload(const Geometry& geom, const AABB& bounds)
+{
+    if(!m_count)
+        m_meshes[0].init();
+
+    Vector<PackedVertex> packed;
+    PackGeometry(geom, bounds, packed);
+    m_meshes[0].upload(packed.begin(), u32(packed.count()), geom.indices.begin(), u32(geom.indices.count()));
+    m_errors[0] = 0.0f;
+    m_count = 1;
+    m_level = 0;
+    m_bounds = bounds;
+    m_center = bounds.center();
+    m_radius = bounds.cornerRadius();
+}
+
+u32 LodMesh::select(const vec3& eye, const float pixels_per_unit, const float max_error) const
+{
+    const float distance = glm::max(glm::distance(eye, m_center) - m_radius, 0.0f);
+    return SelectLod(m_errors, m_count, distance, pixels_per_unit, max_error);
+}
+
+void LodMesh::draw() const
+{
+    if(!m_count)
+        return;
+    g_sharedUniforms.df_translation = vec4(m_bounds.lo, g_sharedUniforms.df_translation.w);
+    g_sharedUniforms.df_scale = vec4(PackExtent(m_bounds), g_sharedUniforms.df_scale.w);
+    m_meshes[m_level].draw();
+}
+
+// ------------------------------------------------------------------------
+
+void SplatCloud::upload(const SplatTree& tree)
+{
+    m_tree = &tree;
+    m_bounds.lo = vec3(FLT_MAX);
+    m_bounds.hi = vec3(-FLT_MAX);
+    for(const SplatNode& node : tree.m_nodes)
+    {
+        m_bounds.lo = glm::min(m_bounds.lo, node.position);
+        m_bounds.hi = glm::max(m_bounds.hi, node.position);
+    }
+    if(!tree.m_nodes.count())
+        m_bounds.lo = m_bounds.hi = vec3(0.0f);
+
+    const vec3 extent = PackExtent(m_bounds);
+    Vector<SplatVertex> verts;
+    verts.reserve(tree.m_nodes.count());
+    for(const SplatNode& node : tree.m_nodes)
+    {
+        SplatVertex& v = verts.grow();
+        v.vertex = PackVertex(node.position, node.normal, node.color, node.material, m_bounds.lo, extent);
+        v.radius = node.radius;
+    }
+    m_mesh.init();
+    m_mesh.upload(verts.begin(), u32(verts.count()));
+}
+
+void SplatCloud::deinit()
+{
+    m_mesh.deinit();
+    m_tree = nullptr;
+}
+
+void SplatCloud::draw(const float pixels_per_unit, const vec2& viewport) const
+{
+    const vec4 res = g_sharedUniforms.render_resolution;
+    g_sharedUniforms.render_resolution = vec4(viewport, res.z, res.w);
+    g_sharedUniforms.df_translation = vec4(m_bounds.lo, g_sharedUniforms.df_translation.w);
+    g_sharedUniforms.df_scale = vec4(PackExtent(m_bounds), pixels_per_unit);
+    m_mesh.draw();
+}
+
+// ------------------------------------------------------------------------
+
 void Renderables::init()
 {
     ProfilerEvent("Renderables::init");
@@ -20,6 +159,7 @@ void Renderables::init()
     glEnable(GL_DEPTH_TEST); DebugGL();
     glEnable(GL_CULL_FACE); DebugGL();
     glCullFace(GL_BACK); DebugGL();
+    glEnable(GL_PROGRAM_POINT_SIZE); DebugGL();
 
     DrawMode::init();
 
@@ -32,9 +172,29 @@ void Renderables::init()
         "fwdVert.glsl",
         "fwdFrag.glsl"
     };
+    const char* meshZFilenames[] = {
+        "packedVert.glsl",
+        "zfrag.glsl"
+    };
+    const char* meshFwdFilenames[] = {
+        "packedVert.glsl",
+        "meshFrag.glsl"
+    };
+    const char* splatZFilenames[] = {
+        "splatVert.glsl",
+        "zfrag.glsl"
+    };
+    const char* splatFwdFilenames[] = {
+        "splatVert.glsl",
+        "meshFrag.glsl"
+    };
 
     fwdProg.setup(fwdFilenames, 2);
     zProg.setup(zFilenames, 2);
+    meshZProg.setup(meshZFilenames, 2);
+    meshFwdProg.setup(meshFwdFilenames, 2);
+    splatZProg.setup(splatZFilenames, 2);
+    splatFwdProg.setup(splatFwdFilenames, 2);
 
     m_light.init(1024);
     m_light.m_direction = glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f));
@@ -53,8 +213,25 @@ void Renderables::deinit()
 {
     ProfilerEvent("Renderables::deinit");
     
+    for(LodMesh& mesh : meshes)
+    {
+        mesh.deinit();
+    }
+    meshes.clear();
+    for(SplatCloud& cloud : splats)
+    {
+        cloud.deinit();
+    }
+    splats.clear();
+    m_chunkMeshes.clear();
+    m_chunkVersions.clear();
+    m_chunks = nullptr;
     zProg.deinit();
     fwdProg.deinit();
+    meshZProg.deinit();
+    meshFwdProg.deinit();
+    splatZProg.deinit();
+    splatFwdProg.deinit();
     m_light.deinit();
 
     ShutdownSharedUniforms();
@@ -72,6 +249,135 @@ void Renderables::shadowPass(const Camera& cam)
     depthPass(cam.getEye(), cam.getVP());
 }
 
+void Renderables::bakeVisible(const Camera& cam)
+{
+    ProfilerEvent("Renderables::bakeVisible");
+
+    u32 baked = 0;
+    for(RenderResource& res : resources)
+    {
+        baked += res.bakeVisible(cam);
+    }
+
+    if(baked)
+    {
+        ProfilerLog("BrickCache: %.1f%% hit rate, %u / %u bricks, %llu evictions", 
+            100.0f * g_BrickCache.hitRate(), g_BrickCache.count(), 
+            g_BrickCache.capacity(), g_BrickCache.evictions());
+    }
+}
+
+void Renderables::selectLods(const Camera& cam, s32 height)
+{
+    // height / (2 * tan(fovy / 2)), as SplatView
+    const float pixels_per_unit = float(height) * 0.5f * cam.getP()[1][1];
+    const vec3 eye = cam.getEye();
+    for(LodMesh& mesh : meshes)
+    {
+        mesh.m_level = mesh.select(eye, pixels_per_unit, m_lodPixels);
+    }
+
+    SplatView view;
+    view.eye = eye;
+    view.VP = cam.getVP();
+    view.pixels_per_unit = pixels_per_unit;
+    m_pixelsPerUnit = pixels_per_unit;
+    // P[1][1] / P[0][0] is the aspect ratio
+    m_viewport = vec2(float(height) * cam.getP()[1][1] / cam.getP()[0][0], float(height));
+    for(SplatCloud& cloud : splats)
+    {
+        cloud.m_tree->selectCut(view, m_splatPixels, m_cut);
+        cloud.m_mesh.uploadCut(m_cut.begin(), u32(m_cut.count()));
+    }
+}
+
+void Renderables::setChunks(ChunkGrid* grid)
+{
+    for(SlotHandle handle : m_chunkMeshes)
+    {
+        releaseMesh(handle);
+    }
+    m_chunkMeshes.clear();
+    m_chunkVersions.clear();
+    m_chunks = grid;
+    if(!grid)
+        return;
+
+    // version 0 is never meshed, so every chunk uploads on the first update
+    for(s32 i = 0; i < grid->count(); ++i)
+    {
+        m_chunkMeshes.grow() = meshes.insert();
+        m_chunkVersions.grow() = 0;
+    }
+}
+
+void Renderables::updateChunks(const Camera& cam)
+{
+    if(!m_chunks)
+        return;
+
+    ProfilerEvent("Renderables::updateChunks");
+
+    m_chunks->setLods(cam.getEye(), m_chunkLod0);
+    if(!m_chunks->update())
+        return;
+
+    for(s32 i = 0; i < m_chunks->count(); ++i)
+    {
+        const Chunk& chunk = m_chunks->at(i);
+        if(chunk.version != m_chunkVersions[i])
+        {
+            meshes[m_chunkMeshes[i]].upload(chunk.geom, m_chunks->bounds(m_chunks->coord(i)));
+            m_chunkVersions[i] = chunk.version;
+        }
+    }
+}
+
+SlotHandle Renderables::requestMesh(const LodChain& chain)
+{
+    const SlotHandle handle = meshes.insert();
+    meshes[handle].upload(chain);
+    return handle;
+}
+
+SlotHandle Renderables::requestMesh(const char* blob_path)
+{
+    const SlotHandle handle = meshes.insert();
+    if(!meshes[handle].load(blob_path))
+    {
+        meshes.remove(handle);
+        return SLOT_NULL;
+    }
+    return handle;
+}
+
+void Renderables::releaseMesh(SlotHandle handle)
+{
+    LodMesh* mesh = meshes.get(handle);
+    if(mesh)
+    {
+        mesh->deinit();
+        meshes.remove(handle);
+    }
+}
+
+SlotHandle Renderables::requestSplats(const SplatTree& tree)
+{
+    const SlotHandle handle = splats.insert();
+    splats[handle].upload(tree);
+    return handle;
+}
+
+void Renderables::releaseSplats(SlotHandle handle)
+{
+    SplatCloud* cloud = splats.get(handle);
+    if(cloud)
+    {
+        cloud->deinit();
+        splats.remove(handle);
+    }
+}
+
 void Renderables::depthPass(const glm::vec3& eye, const mat4& VP)
 {
     ProfilerEvent("Renderables::depthPass");
@@ -85,10 +391,8 @@ void Renderables::depthPass(const glm::vec3& eye, const mat4& VP)
     g_sharedUniforms.eye = vec4(eye.x, eye.y, eye.z, g_sharedUniforms.eye.w);
 
     zProg.bind();
-    for(const RenderResource& res : resources)
-    {
-        res.draw(zProg);
-    }
+    buildDrawList(zProg, meshZProg, splatZProg, eye);
+    drawSorted(zProg, meshZProg, splatZProg);
 }
 
 void Renderables::fwdPass(const glm::vec3& eye, const mat4& VP, u32 dflag)
@@ -108,8 +412,63 @@ void Renderables::fwdPass(const glm::vec3& eye, const mat4& VP, u32 dflag)
     g_sharedUniforms.sunColor = vec4(m_light.m_color.x, m_light.m_color.y, m_light.m_color.z, m_light.m_intensity);
 
     fwdProg.bind();
-    for(const RenderResource& res : resources)
+    buildDrawList(fwdProg, meshFwdProg, splatFwdProg, eye);
+    drawSorted(fwdProg, meshFwdProg, splatFwdProg);
+}
+
+void Renderables::buildDrawList(const GLProgram& prog, const GLProgram& meshProg, const GLProgram& splatProg, const glm::vec3& eye)
+{
+    m_drawList.clear();
+    const RenderResource* res = resources.begin();
+    const u16 count = u16(resources.count());
+    for(u16 i = 0; i < count; ++i)
+    {
+        const vec3 center = res[i].m_field->voxelPosition(vec3(RF_CAP * 0.5f));
+        m_drawList.add(prog.m_id, glm::distance(eye, center), i);
+    }
+    const LodMesh* lods = meshes.begin();
+    const u16 num_meshes = u16(meshes.count());
+    for(u16 i = 0; i < num_meshes; ++i)
+    {
+        m_drawList.add(meshProg.m_id, glm::distance(eye, lods[i].m_center), i);
+    }
+    const SplatCloud* clouds = splats.begin();
+    const u16 num_clouds = u16(splats.count());
+    for(u16 i = 0; i < num_clouds; ++i)
+    {
+        m_drawList.add(splatProg.m_id, glm::distance(eye, clouds[i].m_bounds.center()), i);
+    }
+    m_drawList.sort();
+}
+
+void Renderables::drawSorted(GLProgram& prog, GLProgram& meshProg, GLProgram& splatProg)
+{
+    // the pass binds prog first; keys are grouped by program, so this
+    // switches at most once per program
+    const RenderResource* res = resources.begin();
+    const LodMesh* lods = meshes.begin();
+    const SplatCloud* clouds = splats.begin();
+    const u32 mesh_id = meshProg.m_id & 0xffff;
+    const u32 splat_id = splatProg.m_id & 0xffff;
+    u32 bound = prog.m_id & 0xffff;
+    for(s32 i = 0; i < m_drawList.count(); ++i)
     {
-        res.draw(fwdProg);
+        const u32 program = m_drawList.program(i);
+        if(program != bound)
+        {
+            if(program == mesh_id)
+                meshProg.bind();
+            else if(program == splat_id)
+                splatProg.bind();
+            else
+                prog.bind();
+            bound = program;
+        }
+        if(program == mesh_id)
+            lods[m_drawList.index(i)].draw();
+        else if(program == splat_id)
+            clouds[m_drawList.index(i)].draw(m_pixelsPerUnit, m_viewport);
+        else
+            res[m_drawList.index(i)].draw(prog);
     }
 }
\ No newline at end of file
@@ -1,10 +1,16 @@
 #pragma once 
 
-#include "twister.h"
+#include "slotmap.h"
 #include "glprogram.h"
 #include "directional_light.h"
 #include "rasterfield.h"
 #include "linmath.h"
+#include "array.h"
+#include "sort.h"
+#include "mesh.h"
+#include "meshsimplify.h"
+#include "chunkmesh.h"
+#include "splat.h"
 
 // ------------------------------------------------------------------------
 
@@ -44,29 +50,155 @@
 
 struct RenderResource 
 {
-    RasterField m_field;
+    // the field is about 1 MB, so it lives on the heap and the slot map only
+    // moves the pointer when it grows or swaps a removal
+    RasterField* m_field;
+    SDFList m_sdfs;
 
-    void updateField(const SDFList& list){ m_field.update(list); }
-    void draw(GLProgram& prog) const { DrawRasterField(m_field, prog); }
+    RenderResource() : m_field(new RasterField()){}
+    ~RenderResource(){ delete m_field; }
+    RenderResource(const RenderResource&) = delete;
+    RenderResource& operator=(const RenderResource&) = delete;
+    RenderResource(RenderResource&& other) noexcept : m_field(other.m_field), m_sdfs(std::move(other.m_sdfs))
+    {
+        other.m_field = nullptr;
+    }
+    RenderResource& operator=(RenderResource&& other) noexcept
+    {
+        std::swap(m_field, other.m_field);
+        m_sdfs = std::move(other.m_sdfs);
+        return *this;
+    }
+
+    void updateField(const SDFList& list){ m_field->update(list); }
+    void setSDFs(const SDFList& list)
+    { 
+        m_sdfs = list; 
+        m_field->updateCoarse(m_sdfs); 
+    }
+    u32 bakeVisible(const Camera& cam){ return m_field->updateVisible(m_sdfs, cam); }
+    void draw(GLProgram& prog) const { DrawRasterField(*m_field, prog); }
+};
+
+// A LodChain on the GPU: one PackedMesh per level, all packed against the
+// level 0 bounds. Only the errors and bounds stay on the CPU, and
+// Renderables::selectLods picks m_level from the camera each frame.
+struct LodMesh
+{
+    PackedMesh m_meshes[LOD_MAX_LEVELS];
+    float m_errors[LOD_MAX_LEVELS];
+    AABB m_bounds;
+    vec3 m_center;
+    float m_radius = 0.0f;
+    u32 m_count = 0;
+    u32 m_level = 0;
+
+    void upload(const LodChain& chain);
+    // a baked .mesh as a single level; false when it won't open
+    bool load(const char* path);
+    void deinit();
+    void translate(const vec3& offset);
+    // geom as a single level packed against bounds, reusing the buffers of an
+    // earlier call so a remeshed chunk replaces its last upload
+    void upload(const Geometry& geom, const AABB& bounds);
+    u32 select(const vec3& eye, const float pixels_per_unit, const float max_error) const;
+    // for packedVert.glsl
+    void draw() const;
+};
+
+// A SplatTree drawn as points over the cut selectLods picks each frame. The
+// tree is referenced, not copied, and must outlive the cloud.
+struct SplatCloud
+{
+    const SplatTree* m_tree = nullptr;
+    SplatMesh m_mesh;
+    AABB m_bounds;
+
+    void upload(const SplatTree& tree);
+    void deinit();
+    // for splatVert.glsl
+    void draw(const float pixels_per_unit, const vec2& viewport) const;
+};
+
+// Draws as 64 bit keys: program in the top 16 bits, then view depth, then the
+// dense resource index, so one radix sort groups draws by program and orders
+// each group front to back for early depth rejection.
+struct DrawList
+{
+    Vector<u64> m_keys;
+    Vector<u64> m_scratch;
+
+    void clear(){ m_keys.clear(); }
+    void add(u32 program, float depth, u16 index)
+    {
+        m_keys.grow() = (u64(program & 0xffff) << 48) | (u64(SortKey(depth)) << 16) | u64(index);
+    }
+    void sort()
+    {
+        // scratch only needs the capacity; radix sort writes it raw
+        m_scratch.reserve(m_keys.count());
+        RadixSort(m_keys.begin(), m_scratch.begin(), u32(m_keys.count()));
+    }
+    s32 count() const { return m_keys.count(); }
+    u32 program(s32 i) const { return u32(m_keys[i] >> 48); }
+    u16 index(s32 i) const { return u16(m_keys[i] & 0xffff); }
 };
 
 struct Renderables 
 {
-    TwArray<RenderResource, 64> resources;
+    SlotMap<RenderResource> resources;
+    SlotMap<LodMesh> meshes;
+    SlotMap<SplatCloud> splats;
     GLProgram fwdProg;
     GLProgram zProg;
+    GLProgram meshFwdProg;
+    GLProgram meshZProg;
+    GLProgram splatFwdProg;
+    GLProgram splatZProg;
 
     DirectionalLight m_light;
+    DrawList m_drawList;
+    float m_lodPixels = 1.0f;   // screen space error a mesh LOD may add
+    float m_splatPixels = 0.25f; // pixels a splat may reach past the surface
+    float m_pixelsPerUnit = 0.0f;
+    vec2 m_viewport = vec2(0.0f);
+    Vector<u32> m_cut;
+
+    // a chunked world drawn as one single level mesh per chunk
+    ChunkGrid* m_chunks = nullptr;
+    Vector<SlotHandle> m_chunkMeshes;
+    Vector<u32> m_chunkVersions;
+    float m_chunkLod0 = 8.0f;   // chunks within this distance mesh at lod 0
 
     void init();
     void deinit();
     void bindSun(GLProgram& prog, int channel = TX_SUN_CHANNEL){ m_light.bind(prog, channel); }
     void shadowPass(const Camera& cam);
+    void bakeVisible(const Camera& cam);
+    // picks each mesh's level and each splat cloud's cut for a viewport
+    // height in pixels
+    void selectLods(const Camera& cam, s32 height);
+    // draws grid through meshes from now on; it must outlive them
+    void setChunks(ChunkGrid* grid);
+    // sets chunk lods around the camera, remeshes the dirty chunks and
+    // uploads the ones whose geometry changed
+    void updateChunks(const Camera& cam);
     void depthPass(const vec3& eye, const mat4& VP);
     void fwdPass(const vec3& eye, const mat4& VP, u32 dflag);
-    u16 request(){ return resources.request(); }
-    void release(u16 handle){ resources.remove(handle); }
-    RenderResource& operator[](u16 i){ return resources[i]; }
+    // fields draw with prog, meshes with meshProg, splats with splatProg
+    void buildDrawList(const GLProgram& prog, const GLProgram& meshProg, const GLProgram& splatProg, const vec3& eye);
+    void drawSorted(GLProgram& prog, GLProgram& meshProg, GLProgram& splatProg);
+    SlotHandle request(){ return resources.insert(); }
+    void release(SlotHandle handle){ resources.remove(handle); }
+    // uploads every level of chain; the chain can go afterwards
+    SlotHandle requestMesh(const LodChain& chain);
+    // maps a baked .mesh; SLOT_NULL when it won't load
+    SlotHandle requestMesh(const char* blob_path);
+    void releaseMesh(SlotHandle handle);
+    // uploads every node of tree; the tree must outlive the cloud
+    SlotHandle requestSplats(const SplatTree& tree);
+    void releaseSplats(SlotHandle handle);
+    RenderResource& operator[](SlotHandle handle){ return resources[handle]; }
     RenderResource* begin(){ return resources.begin(); }
     RenderResource* end(){ return resources.end(); }
 };
@@ -3,6 +3,7 @@
 #include "ints.h"
 #include "array.h"
 #include "linmath.h"
+#include "hash.h"
 
 enum SDFType : u8
 {
@@ -66,11 +67,15 @@ struct SDF
     SDFBlend blend_type = SDF_UNION;
 
     float distance(vec3 p)const;
+    float lowerBound(vec3 p)const;
     float blend(float a, float b)const;
+    u64 hash(const vec3& origin, u64 seed)const;
 };
 
 typedef Vector<SDF> SDFList;
-typedef Vector<u16> SDFIndices;
+// most cells see a handful of sdfs, so short lists stay off the heap; the
+// evaluators below take any list of u16, so scratch can use an ArenaVector
+typedef SmallVector<u16, 16> SDFIndices;
 
 inline void findBasis(vec3 N, vec3& T, vec3& B)
 {
@@ -100,6 +105,36 @@ inline float SDF::distance(vec3 p) const
     return 1000.0f;
 }
 
+// never greater than distance(p); the primitive fits inside a sphere 
+// of radius 1 (sphere) or sqrt(3) (box) in its local space.
+inline float SDF::lowerBound(vec3 p) const
+{
+    const float s = glm::max(scale.x, glm::max(scale.y, scale.z));
+    const float r = type == SDF_BOX ? 1.732051f : 1.0f;
+    return glm::length(p - translation) / s - r;
+}
+
+// fields are packed into a buffer so struct padding never leaks into the key.
+// translation is taken relative to origin so repeated instances match.
+inline u64 SDF::hash(const vec3& origin, u64 seed) const
+{
+    const vec3 rel = translation - origin;
+    u8 bytes[sizeof(vec3) * 3 + sizeof(float) + 7];
+    u8* p = bytes;
+    memcpy(p, &rel, sizeof(vec3)); p += sizeof(vec3);
+    memcpy(p, &scale, sizeof(vec3)); p += sizeof(vec3);
+    memcpy(p, &rotation, sizeof(vec3)); p += sizeof(vec3);
+    memcpy(p, &smoothness, sizeof(float)); p += sizeof(float);
+    *p++ = material.red;
+    *p++ = material.green;
+    *p++ = material.blue;
+    *p++ = material.roughness;
+    *p++ = material.metalness;
+    *p++ = u8(type);
+    *p++ = u8(blend_type);
+    return hash64(bytes, sizeof(bytes), seed);
+}
+
 inline float SDF::blend(float a, float b) const
 {
     switch(blend_type)
@@ -135,12 +170,22 @@ inline float SDF::blend(float a, float b) const
     return a;
 }
 
-inline float SDFDis(const SDFList& sdfs, const SDFIndices& indices, const vec3 p)
+// a hard union cannot lower the distance unless its bound does, so boxes 
+// are rejected early; this pays off once the closest primitives come first.
+inline bool SDFSkippable(const SDF& sdf, const vec3 p, const float dis)
+{
+    return sdf.blend_type == SDF_UNION && sdf.type == SDF_BOX && sdf.lowerBound(p) >= dis;
+}
+
+template<typename Indices>
+inline float SDFDis(const SDFList& sdfs, const Indices& indices, const vec3 p)
 {
     float dis = 1000.0f;
     for(const u16 i : indices)
     {
         const SDF& sdf = sdfs[i];
+        if(SDFSkippable(sdf, p, dis))
+            continue;
         dis = sdf.blend(dis, sdf.distance(p));
     }
     return dis;
@@ -151,12 +196,15 @@ inline float SDFDis(const SDFList& sdfs, const vec3 p)
     float dis = 1000.0f;
     for(const SDF& sdf : sdfs)
     {
+        if(SDFSkippable(sdf, p, dis))
+            continue;
         dis = sdf.blend(dis, sdf.distance(p));
     }
     return dis;
 }
 
-inline vec3 SDFNorm(const SDFList& sdfs, const SDFIndices& indices, const vec3 p)
+template<typename Indices>
+inline vec3 SDFNorm(const SDFList& sdfs, const Indices& indices, const vec3 p)
 {
     const float e = 0.001f;
     return normalize(vec3(
@@ -166,7 +214,8 @@ inline vec3 SDFNorm(const SDFList& sdfs, const SDFIndices& indices, const vec3 p
     ));
 }
 
-inline Material SDFMaterial(const SDFList& sdfs, const SDFIndices& indices, const vec3 p)
+template<typename Indices>
+inline Material SDFMaterial(const SDFList& sdfs, const Indices& indices, const vec3 p)
 {
     if(indices.count() == 1)
     {
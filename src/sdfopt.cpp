@@ -0,0 +1,396 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "sdfopt.h"
+#include "randf.h"
+#include "cputimer.h"
+#include <cstdio>
+
+AABB SDFBounds(const SDF& sdf)
+{
+    // both primitives are unit sized in local space: radius 1 or half extent 1
+    vec3 extent = glm::abs(sdf.scale);
+    if(sdf.blend_type >= SDF_S_UNION)
+    {
+        extent += vec3(sdf.smoothness);
+    }
+
+    AABB box;
+    box.lo = sdf.translation - extent;
+    box.hi = sdf.translation + extent;
+    return box;
+}
+
+AABB SDFListBounds(const SDFList& sdfs)
+{
+    AABB box;
+    box.lo = vec3(0.0f);
+    box.hi = vec3(0.0f);
+
+    bool first = true;
+    for(const SDF& sdf : sdfs)
+    {
+        if(sdf.blend_type != SDF_UNION && sdf.blend_type != SDF_S_UNION)
+            continue;
+
+        const AABB b = SDFBounds(sdf);
+        box.lo = first ? b.lo : glm::min(box.lo, b.lo);
+        box.hi = first ? b.hi : glm::max(box.hi, b.hi);
+        first = false;
+    }
+    return box;
+}
+
+static bool Contains(const AABB& outer, const AABB& inner)
+{
+    return glm::all(glm::lessThanEqual(outer.lo, inner.lo))
+        && glm::all(glm::greaterThanEqual(outer.hi, inner.hi));
+}
+
+static bool Overlaps(const AABB& a, const AABB& b)
+{
+    return glm::all(glm::lessThanEqual(a.lo, b.hi))
+        && glm::all(glm::greaterThanEqual(a.hi, b.lo));
+}
+
+static bool Degenerate(const SDF& sdf)
+{
+    for(s32 i = 0; i < 3; ++i)
+    {
+        const float s = sdf.scale[i];
+        if(!(glm::abs(s) > 0.000001f) || glm::isinf(s))
+            return true;
+    }
+    return false;
+}
+
+static void EraseOrdered(SDFList& sdfs, s32 idx)
+{
+    for(s32 i = idx; i + 1 < sdfs.count(); ++i)
+    {
+        sdfs[i] = sdfs[i + 1];
+    }
+    sdfs.pop();
+}
+
+static void GridSamples(const AABB& box, const u32 samples, Vector<vec3>& out)
+{
+    const vec3 span = box.span();
+    const float inv = 1.0f / float(samples > 1 ? samples - 1 : 1);
+    for(u32 x = 0; x < samples; ++x)
+    {
+        for(u32 y = 0; y < samples; ++y)
+        {
+            for(u32 z = 0; z < samples; ++z)
+            {
+                out.grow() = box.lo + span * vec3(float(x), float(y), float(z)) * inv;
+            }
+        }
+    }
+}
+
+// samples around the candidate and over the whole scene, comparing the
+// field with and without it
+static bool Unaffected(const SDFList& sdfs, const s32 idx, const u32 samples,
+    const float tolerance, const Vector<vec3>& global)
+{
+    SDFList without;
+    without.reserve(sdfs.count());
+    for(s32 i = 0; i < sdfs.count(); ++i)
+    {
+        if(i != idx)
+            without.grow() = sdfs[i];
+    }
+
+    AABB local = SDFBounds(sdfs[idx]);
+    const vec3 pad = local.span() * 0.5f;
+    local.lo -= pad;
+    local.hi += pad;
+
+    Vector<vec3> pts;
+    GridSamples(local, samples, pts);
+
+    for(const vec3& p : pts)
+    {
+        if(glm::abs(SDFDis(sdfs, p) - SDFDis(without, p)) > tolerance)
+            return false;
+    }
+    for(const vec3& p : global)
+    {
+        if(glm::abs(SDFDis(sdfs, p) - SDFDis(without, p)) > tolerance)
+            return false;
+    }
+    return true;
+}
+
+SDFOptStats OptimiseSDFList(SDFList& sdfs, const u32 samples, const float tolerance)
+{
+    SDFOptStats stats;
+
+    for(s32 i = sdfs.count() - 1; i >= 0; --i)
+    {
+        if(Degenerate(sdfs[i]))
+        {
+            EraseOrdered(sdfs, i);
+            ++stats.removed_degenerate;
+        }
+    }
+
+    AABB domain = SDFListBounds(sdfs);
+    {
+        const vec3 pad = domain.span() * 0.1f + vec3(0.1f);
+        domain.lo -= pad;
+        domain.hi += pad;
+    }
+    Vector<vec3> global;
+    GridSamples(domain, 8, global);
+
+    // back to front, so a removal never changes the candidates already tested
+    for(s32 i = sdfs.count() - 1; i >= 0; --i)
+    {
+        const SDF& sdf = sdfs[i];
+        const AABB bounds = SDFBounds(sdf);
+        bool candidate = false;
+        bool isDiff = false;
+
+        switch(sdf.blend_type)
+        {
+            case SDF_UNION:
+            case SDF_S_UNION:
+            {
+                for(s32 j = 0; j < sdfs.count() && !candidate; ++j)
+                {
+                    const SDF& other = sdfs[j];
+                    const bool additive = other.blend_type == SDF_UNION || other.blend_type == SDF_S_UNION;
+                    candidate = j != i && additive && Contains(SDFBounds(other), bounds);
+                }
+            }
+            break;
+            case SDF_DIFF:
+            case SDF_S_DIFF:
+            {
+                isDiff = true;
+                candidate = true;
+                for(s32 j = 0; j < i && candidate; ++j)
+                {
+                    const SDF& other = sdfs[j];
+                    const bool additive = other.blend_type == SDF_UNION || other.blend_type == SDF_S_UNION;
+                    candidate = !(additive && Overlaps(SDFBounds(other), bounds));
+                }
+            }
+            break;
+            default:
+            break;
+        }
+
+        if(candidate && Unaffected(sdfs, i, samples, tolerance, global))
+        {
+            EraseOrdered(sdfs, i);
+            if(isDiff)
+                ++stats.removed_noop;
+            else
+                ++stats.removed_hidden;
+        }
+    }
+
+    // min() is commutative, so runs of hard unions may be freely reordered
+    GridSamples(domain, 16, global);
+    s32 begin = 0;
+    while(begin < sdfs.count())
+    {
+        if(sdfs[begin].blend_type != SDF_UNION)
+        {
+            ++begin;
+            continue;
+        }
+        s32 end = begin;
+        while(end < sdfs.count() && sdfs[end].blend_type == SDF_UNION)
+        {
+            ++end;
+        }
+
+        if(end - begin > 1)
+        {
+            Vector<u32> wins;
+            wins.reserve(end - begin);
+            for(s32 i = begin; i < end; ++i)
+            {
+                wins.grow() = 0;
+            }
+
+            for(const vec3& p : global)
+            {
+                s32 closest = begin;
+                float closestDis = sdfs[begin].distance(p);
+                for(s32 i = begin + 1; i < end; ++i)
+                {
+                    const float dis = sdfs[i].distance(p);
+                    if(dis < closestDis)
+                    {
+                        closestDis = dis;
+                        closest = i;
+                    }
+                }
+                ++wins[closest - begin];
+            }
+
+            // insertion sort, stable so ties keep editor order
+            bool changed = false;
+            for(s32 i = 1; i < end - begin; ++i)
+            {
+                const u32 w = wins[i];
+                const SDF sdf = sdfs[begin + i];
+                s32 j = i - 1;
+                for(; j >= 0 && wins[j] < w; --j)
+                {
+                    wins[j + 1] = wins[j];
+                    sdfs[begin + j + 1] = sdfs[begin + j];
+                    changed = true;
+                }
+                wins[j + 1] = w;
+                sdfs[begin + j + 1] = sdf;
+            }
+            stats.reordered_runs += changed ? 1 : 0;
+        }
+
+        begin = end;
+    }
+
+    return stats;
+}
+
+// ------------------------------------------------------------------------
+
+bool LoadSDFList(const char* path, SDFList& sdfs)
+{
+    FILE* pFile = fopen(path, "rb");
+    if(!pFile)
+    {
+        printf("[SDFOpt] Could not open file: %s\n", path);
+        return false;
+    }
+    sdfs.load(pFile);
+    fclose(pFile);
+    return true;
+}
+
+bool SaveSDFList(const char* path, SDFList& sdfs)
+{
+    FILE* pFile = fopen(path, "wb");
+    if(!pFile)
+    {
+        printf("[SDFOpt] Could not open file: %s\n", path);
+        return false;
+    }
+    sdfs.serialize(pFile);
+    fclose(pFile);
+    return true;
+}
+
+struct EvalCost
+{
+    double ns_per_sample;
+    double evals_per_sample;
+};
+
+static EvalCost MeasureCost(const SDFList& sdfs, const Vector<vec3>& pts)
+{
+    EvalCost cost;
+
+    u64 evals = 0;
+    for(const vec3& p : pts)
+    {
+        float dis = 1000.0f;
+        for(const SDF& sdf : sdfs)
+        {
+            if(SDFSkippable(sdf, p, dis))
+                continue;
+            dis = sdf.blend(dis, sdf.distance(p));
+            ++evals;
+        }
+    }
+    cost.evals_per_sample = double(evals) / double(pts.count());
+
+    volatile float sink = 0.0f;
+    CPUTimer timer;
+    for(const vec3& p : pts)
+    {
+        sink += SDFDis(sdfs, p);
+    }
+    cost.ns_per_sample = timer.seconds() * 1e9 / double(pts.count());
+
+    return cost;
+}
+
+void SDFOptimiseReport(const SDFList& sdfs, const char* name)
+{
+    SDFList optimised = sdfs;
+    CPUTimer timer;
+    const SDFOptStats stats = OptimiseSDFList(optimised);
+    const double optMs = timer.ms();
+
+    AABB domain = SDFListBounds(sdfs);
+    Vector<vec3> pts;
+    GridSamples(domain, 48, pts);
+
+    const EvalCost before = MeasureCost(sdfs, pts);
+    const EvalCost after = MeasureCost(optimised, pts);
+
+    printf("[SDFOpt] %s: %d -> %d primitives (%u degenerate, %u hidden, %u no-op), %u runs reordered, %.1f ms\n",
+        name, sdfs.count(), optimised.count(),
+        stats.removed_degenerate, stats.removed_hidden, stats.removed_noop,
+        stats.reordered_runs, optMs);
+    printf("[SDFOpt] %s: %.2f -> %.2f evals/sample, %.1f -> %.1f ns/sample\n",
+        name, before.evals_per_sample, after.evals_per_sample,
+        before.ns_per_sample, after.ns_per_sample);
+}
+
+void SDFOptimiseReport(const char* path)
+{
+    SDFList sdfs;
+    if(LoadSDFList(path, sdfs))
+    {
+        SDFOptimiseReport(sdfs, path);
+    }
+}
+
+void SDFOptimiseTest()
+{
+    // mimics an editor scene: a floor, props, and the usual leftovers
+    SDFList sdfs;
+    {
+        SDF& floor = sdfs.grow();
+        floor.type = SDF_BOX;
+        floor.translation = vec3(0.0f, -1.0f, 0.0f);
+        floor.scale = vec3(8.0f, 0.25f, 8.0f);
+    }
+    for(u32 i = 0; i < 48; ++i)
+    {
+        SDF& sdf = sdfs.grow();
+        sdf.type = (i & 1) ? SDF_BOX : SDF_SPHERE;
+        sdf.translation = vec3(randf() * 14.0f - 7.0f, randf() * 2.0f, randf() * 14.0f - 7.0f);
+        sdf.scale = vec3(0.25f + randf() * 0.5f);
+    }
+    for(u32 i = 0; i < 16; ++i)
+    {
+        // spheres buried in the floor
+        SDF& sdf = sdfs.grow();
+        sdf.translation = vec3(randf() * 12.0f - 6.0f, -1.0f, randf() * 12.0f - 6.0f);
+        sdf.scale = vec3(0.05f + 0.15f * randf());
+    }
+    for(u32 i = 0; i < 4; ++i)
+    {
+        // cuts made far away from anything
+        SDF& sdf = sdfs.grow();
+        sdf.blend_type = SDF_DIFF;
+        sdf.translation = vec3(20.0f + 4.0f * float(i), 10.0f, 0.0f);
+        sdf.scale = vec3(1.0f);
+    }
+    for(u32 i = 0; i < 4; ++i)
+    {
+        SDF& sdf = sdfs.grow();
+        sdf.translation = vec3(randf(), randf(), randf());
+        sdf.scale = vec3(0.0f);
+    }
+
+    SDFOptimiseReport(sdfs, "editor test scene");
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "sdf.h"
+#include "aabb.h"
+
+struct SDFOptStats
+{
+    u32 removed_degenerate = 0;     // zero or non-finite scale
+    u32 removed_hidden = 0;         // unions covered by other primitives
+    u32 removed_noop = 0;           // differences that cut nothing
+    u32 reordered_runs = 0;         // union runs whose order changed
+};
+
+AABB SDFBounds(const SDF& sdf);
+AABB SDFListBounds(const SDFList& sdfs);
+
+// Drops primitives that cannot affect the field and sorts runs of hard unions
+// so the most often closest primitive is evaluated first.
+// Candidates come from conservative bounds and are only removed once every
+// sample around them evaluates within tolerance of the unmodified list.
+SDFOptStats OptimiseSDFList(SDFList& sdfs, const u32 samples = 12, const float tolerance = 0.00001f);
+
+bool LoadSDFList(const char* path, SDFList& sdfs);
+bool SaveSDFList(const char* path, SDFList& sdfs);
+
+// prints primitive counts and evaluation cost before and after optimising
+void SDFOptimiseReport(const SDFList& sdfs, const char* name);
+void SDFOptimiseReport(const char* path);
+void SDFOptimiseTest();
@@ -0,0 +1,284 @@
+#include "sdfquery.h"
+#include "sdfsampler.h"
+#include "parallelfor.h"
+#include "randf.h"
+#include "cputimer.h"
+#include <cstdio>
+
+float SampleField(const RasterField& field, const vec3& p, vec3* gradient)
+{
+    const vec3 hi = vec3(float(RF_CAP - 1) - 0.0001f);
+    const vec3 v = field.toVoxel(p);
+    const vec3 vc = glm::clamp(v, vec3(0.0f), hi);
+
+    const ivec3 i0 = ivec3(vc);
+    const ivec3 i1 = glm::min(i0 + ivec3(1), ivec3(RF_CAP - 1));
+    const vec3 f = vc - vec3(i0);
+
+    const float c000 = field.m_field[i0.x][i0.y][i0.z];
+    const float c100 = field.m_field[i1.x][i0.y][i0.z];
+    const float c010 = field.m_field[i0.x][i1.y][i0.z];
+    const float c110 = field.m_field[i1.x][i1.y][i0.z];
+    const float c001 = field.m_field[i0.x][i0.y][i1.z];
+    const float c101 = field.m_field[i1.x][i0.y][i1.z];
+    const float c011 = field.m_field[i0.x][i1.y][i1.z];
+    const float c111 = field.m_field[i1.x][i1.y][i1.z];
+
+    const float c00 = glm::mix(c000, c100, f.x);
+    const float c10 = glm::mix(c010, c110, f.x);
+    const float c01 = glm::mix(c001, c101, f.x);
+    const float c11 = glm::mix(c011, c111, f.x);
+    const float c0 = glm::mix(c00, c10, f.y);
+    const float c1 = glm::mix(c01, c11, f.y);
+    float dis = glm::mix(c0, c1, f.z);
+
+    // outside the field the clamped sample is extended by the distance to the box
+    const vec3 pc = field.voxelPosition(vc);
+    const float outside = glm::length(p - pc);
+    dis += outside;
+
+    if(gradient)
+    {
+        if(outside > 0.0001f)
+        {
+            *gradient = (p - pc) / outside;
+        }
+        else
+        {
+            const float dx = glm::mix(
+                glm::mix(c100 - c000, c110 - c010, f.y),
+                glm::mix(c101 - c001, c111 - c011, f.y), f.z);
+            const float dy = glm::mix(
+                glm::mix(c010 - c000, c110 - c100, f.x),
+                glm::mix(c011 - c001, c111 - c101, f.x), f.z);
+            const float dz = c1 - c0;
+            *gradient = vec3(dx, dy, dz) / field.m_scale;
+        }
+    }
+
+    return dis;
+}
+
+// ------------------------------------------------------------------------
+
+static void StoreResults(QueryResult* results, const u32 n,
+    const f4 radius, const f4 dis, const vec3x4& N, const vec3x4& closest)
+{
+    const f4 gap = dis - radius;
+    const vec3x4 push = N * max(-gap, f4(0.0f));
+    for(u32 l = 0; l < n; ++l)
+    {
+        QueryResult& r = results[l];
+        r.closest = vec3(closest.x[l], closest.y[l], closest.z[l]);
+        r.normal = vec3(N.x[l], N.y[l], N.z[l]);
+        r.push = vec3(push.x[l], push.y[l], push.z[l]);
+        r.distance = gap[l];
+    }
+}
+
+// two projection steps along the gradient land on the surface even when
+// the field is not an exact distance
+template<typename S>
+static vec3x4 ClosestPoint(const S& sampler, const vec3x4& c, const f4 dis, const vec3x4& N)
+{
+    vec3x4 p = c - N * dis;
+    f4 d;
+    vec3x4 n;
+    sampler.sample(p, d, n);
+    return p - n * d;
+}
+
+template<typename S>
+static void SphereKernel(const S& sampler, const SphereQuery* queries, QueryResult* results, const u32 begin, const u32 end)
+{
+    for(u32 i = begin; i < end; i += 4)
+    {
+        const u32 n = glm::min(4u, end - i);
+        float cx[4], cy[4], cz[4], rad[4];
+        for(u32 l = 0; l < 4; ++l)
+        {
+            const SphereQuery& q = queries[i + (l < n ? l : n - 1)];
+            cx[l] = q.center.x;
+            cy[l] = q.center.y;
+            cz[l] = q.center.z;
+            rad[l] = q.radius;
+        }
+
+        const vec3x4 c(f4::load(cx), f4::load(cy), f4::load(cz));
+        f4 dis;
+        vec3x4 N;
+        sampler.sample(c, dis, N);
+        StoreResults(results + i, n, f4::load(rad), dis, N, ClosestPoint(sampler, c, dis, N));
+    }
+}
+
+template<typename S>
+static void CapsuleKernel(const S& sampler, const CapsuleQuery* queries, QueryResult* results, const u32 begin, const u32 end)
+{
+    for(u32 i = begin; i < end; i += 4)
+    {
+        const u32 n = glm::min(4u, end - i);
+        float ax[4], ay[4], az[4], bx[4], by[4], bz[4], rad[4];
+        for(u32 l = 0; l < 4; ++l)
+        {
+            const CapsuleQuery& q = queries[i + (l < n ? l : n - 1)];
+            ax[l] = q.a.x; ay[l] = q.a.y; az[l] = q.a.z;
+            bx[l] = q.b.x; by[l] = q.b.y; bz[l] = q.b.z;
+            rad[l] = q.radius;
+        }
+
+        const vec3x4 a(f4::load(ax), f4::load(ay), f4::load(az));
+        const vec3x4 ab = vec3x4(f4::load(bx), f4::load(by), f4::load(bz)) - a;
+
+        // coarse scan along the segment, then narrow in on the closest parameter
+        f4 bestT(0.0f), bestDis(1000000.0f);
+        vec3x4 N;
+        const s32 num_steps = 4;
+        for(s32 s = 0; s <= num_steps; ++s)
+        {
+            const f4 t(float(s) / float(num_steps));
+            f4 dis;
+            sampler.sample(a + ab * t, dis, N);
+            const f4 closer = dis < bestDis;
+            bestT = select(closer, t, bestT);
+            bestDis = select(closer, dis, bestDis);
+        }
+
+        f4 h(0.5f / float(num_steps));
+        for(s32 s = 0; s < 3; ++s)
+        {
+            const f4 tl = max(bestT - h, f4(0.0f));
+            const f4 tr = min(bestT + h, f4(1.0f));
+            f4 dl, dr;
+            sampler.sample(a + ab * tl, dl, N);
+            sampler.sample(a + ab * tr, dr, N);
+            const f4 left = (dl < bestDis) & (dl <= dr);
+            const f4 right = andnot(left, dr < bestDis);
+            bestT = select(left, tl, select(right, tr, bestT));
+            bestDis = select(left, dl, select(right, dr, bestDis));
+            h = h * f4(0.5f);
+        }
+
+        const vec3x4 c = a + ab * bestT;
+        f4 dis;
+        sampler.sample(c, dis, N);
+        StoreResults(results + i, n, f4::load(rad), dis, N, ClosestPoint(sampler, c, dis, N));
+    }
+}
+
+void QuerySpheres(const SDFList& sdfs, const SphereQuery* queries, QueryResult* results, const u32 count, u32 num_threads)
+{
+    const ListSampler sampler(sdfs);
+    ParallelFor(count, num_threads, SDF_QUERY_THREAD_MIN, 4, [&](u32 begin, u32 end)
+    {
+        SphereKernel(sampler, queries, results, begin, end);
+    });
+}
+
+void QuerySpheres(const RasterField& field, const SphereQuery* queries, QueryResult* results, const u32 count, u32 num_threads)
+{
+    const FieldSampler sampler(field);
+    ParallelFor(count, num_threads, SDF_QUERY_THREAD_MIN, 4, [&](u32 begin, u32 end)
+    {
+        SphereKernel(sampler, queries, results, begin, end);
+    });
+}
+
+void QueryCapsules(const SDFList& sdfs, const CapsuleQuery* queries, QueryResult* results, const u32 count, u32 num_threads)
+{
+    const ListSampler sampler(sdfs);
+    ParallelFor(count, num_threads, SDF_QUERY_THREAD_MIN, 4, [&](u32 begin, u32 end)
+    {
+        CapsuleKernel(sampler, queries, results, begin, end);
+    });
+}
+
+void QueryCapsules(const RasterField& field, const CapsuleQuery* queries, QueryResult* results, const u32 count, u32 num_threads)
+{
+    const FieldSampler sampler(field);
+    ParallelFor(count, num_threads, SDF_QUERY_THREAD_MIN, 4, [&](u32 begin, u32 end)
+    {
+        CapsuleKernel(sampler, queries, results, begin, end);
+    });
+}
+
+// ------------------------------------------------------------------------
+
+void SDFQueryBench()
+{
+    SDFList sdfs;
+    {
+        SDF& floor = sdfs.grow();
+        floor.type = SDF_BOX;
+        floor.translation = vec3(0.0f, -1.5f, 0.0f);
+        floor.scale = vec3(2.0f, 0.25f, 2.0f);
+    }
+    for(u32 i = 0; i < 15; ++i)
+    {
+        SDF& sdf = sdfs.grow();
+        sdf.type = (i & 1) ? SDF_BOX : SDF_SPHERE;
+        sdf.translation = vec3(randf() * 3.0f - 1.5f, randf() * 2.0f - 1.0f, randf() * 3.0f - 1.5f);
+        sdf.scale = vec3(0.2f + randf() * 0.3f);
+    }
+
+    RasterField* field = new RasterField();
+    field->m_scale = vec3(4.0f / float(RF_CAP));
+    field->m_translation = vec3(-0.5f * float(RF_CAP));
+    field->update(sdfs);
+
+    const u32 count = 1 << 18;
+    SphereQuery* spheres = new SphereQuery[count];
+    CapsuleQuery* capsules = new CapsuleQuery[count];
+    QueryResult* results = new QueryResult[count];
+    for(u32 i = 0; i < count; ++i)
+    {
+        const vec3 p = vec3(randf(), randf(), randf()) * 4.0f - 2.0f;
+        spheres[i].center = p;
+        spheres[i].radius = 0.1f;
+        capsules[i].a = p;
+        capsules[i].b = p + vec3(randf(), randf(), randf()) * 0.5f - 0.25f;
+        capsules[i].radius = 0.1f;
+    }
+
+    // scalar reference: one SDFDis for the value, six for the gradient
+    {
+        CPUTimer timer;
+        const float e = 0.001f;
+        for(u32 i = 0; i < count; ++i)
+        {
+            const vec3 p = spheres[i].center;
+            const float dis = SDFDis(sdfs, p);
+            const vec3 N = glm::normalize(vec3(
+                SDFDis(sdfs, p + vec3(e, 0.0f, 0.0f)) - SDFDis(sdfs, p - vec3(e, 0.0f, 0.0f)),
+                SDFDis(sdfs, p + vec3(0.0f, e, 0.0f)) - SDFDis(sdfs, p - vec3(0.0f, e, 0.0f)),
+                SDFDis(sdfs, p + vec3(0.0f, 0.0f, e)) - SDFDis(sdfs, p - vec3(0.0f, 0.0f, e))));
+            results[i].distance = dis - spheres[i].radius;
+            results[i].normal = N;
+        }
+        printf("[SDFQuery] spheres  / list  scalar 1 thread : %8.2f Mq/s\n", count / timer.seconds() * 1e-6);
+    }
+
+    const u32 hw = glm::max(1u, std::thread::hardware_concurrency());
+    const u32 thread_counts[2] = { 1, hw };
+    for(u32 i = 0; i < (hw > 1 ? 2u : 1u); ++i)
+    {
+        const u32 t = thread_counts[i];
+        CPUTimer timer;
+        QuerySpheres(sdfs, spheres, results, count, t);
+        printf("[SDFQuery] spheres  / list  simd %2u threads: %8.2f Mq/s\n", t, count / timer.seconds() * 1e-6);
+        timer.begin();
+        QuerySpheres(*field, spheres, results, count, t);
+        printf("[SDFQuery] spheres  / field simd %2u threads: %8.2f Mq/s\n", t, count / timer.seconds() * 1e-6);
+        timer.begin();
+        QueryCapsules(sdfs, capsules, results, count, t);
+        printf("[SDFQuery] capsules / list  simd %2u threads: %8.2f Mq/s\n", t, count / timer.seconds() * 1e-6);
+        timer.begin();
+        QueryCapsules(*field, capsules, results, count, t);
+        printf("[SDFQuery] capsules / field simd %2u threads: %8.2f Mq/s\n", t, count / timer.seconds() * 1e-6);
+    }
+
+    delete[] spheres;
+    delete[] capsules;
+    delete[] results;
+    delete field;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ints.h"
+#include "linmath.h"
+#include "sdf.h"
+
+struct RasterField;
+
+struct SphereQuery
+{
+    vec3 center;
+    float radius;
+};
+
+struct CapsuleQuery
+{
+    vec3 a;
+    vec3 b;
+    float radius;
+};
+
+struct QueryResult
+{
+    vec3 closest;       // closest point on the field surface to the query shape
+    vec3 normal;        // field gradient at the closest point on the query shape
+    vec3 push;          // smallest translation that resolves penetration; zero if separated
+    float distance;     // signed gap between shape and surface, negative when overlapping
+    bool overlap() const { return distance < 0.0f; }
+};
+
+// Batched proximity queries against either a baked field (trilinear value and
+// gradient, sampled one lane at a time) or an SDFList evaluated 4 queries at
+// a time.
+// batches larger than SDF_QUERY_THREAD_MIN are split across num_threads
+// threads; 0 picks std::thread::hardware_concurrency().
+#define SDF_QUERY_THREAD_MIN 4096
+
+void QuerySpheres(const SDFList& sdfs, const SphereQuery* queries, QueryResult* results, const u32 count, u32 num_threads = 0);
+void QuerySpheres(const RasterField& field, const SphereQuery* queries, QueryResult* results, const u32 count, u32 num_threads = 0);
+void QueryCapsules(const SDFList& sdfs, const CapsuleQuery* queries, QueryResult* results, const u32 count, u32 num_threads = 0);
+void QueryCapsules(const RasterField& field, const CapsuleQuery* queries, QueryResult* results, const u32 count, u32 num_threads = 0);
+
+void SDFQueryBench();
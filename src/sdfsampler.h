@@ -0,0 +1,56 @@
+#pragma once
+
+#include "sdfsimd.h"
+#include "rasterfield.h"
+
+// trilinear sample of a baked field in world space, with analytic gradient
+float SampleField(const RasterField& field, const vec3& p, vec3* gradient = nullptr);
+
+// 4 wide distance sources shared by the cpu query and ray casting paths
+
+struct ListSampler
+{
+    const SDFList& sdfs;
+    ListSampler(const SDFList& list) : sdfs(list){}
+    f4 distance(const vec3x4& p) const
+    {
+        return SDFDis4(sdfs, p);
+    }
+    void sample(const vec3x4& p, f4& dis, vec3x4& N) const
+    {
+        dis = SDFDis4(sdfs, p);
+        N = normalize(SDFGrad4(sdfs, p));
+    }
+};
+
+// each lane is a scalar SampleField call: the eight texel fetches per lane
+// are gathers SSE2 cannot do, so batching only saves the per query dispatch
+struct FieldSampler
+{
+    const RasterField& field;
+    FieldSampler(const RasterField& f) : field(f){}
+    f4 distance(const vec3x4& p) const
+    {
+        float d[4];
+        for(s32 i = 0; i < 4; ++i)
+        {
+            d[i] = SampleField(field, vec3(p.x[i], p.y[i], p.z[i]));
+        }
+        return f4::load(d);
+    }
+    void sample(const vec3x4& p, f4& dis, vec3x4& N) const
+    {
+        float d[4], nx[4], ny[4], nz[4];
+        for(s32 i = 0; i < 4; ++i)
+        {
+            vec3 g;
+            d[i] = SampleField(field, vec3(p.x[i], p.y[i], p.z[i]), &g);
+            g = g / glm::max(glm::length(g), 0.0000001f);
+            nx[i] = g.x;
+            ny[i] = g.y;
+            nz[i] = g.z;
+        }
+        dis = f4::load(d);
+        N = vec3x4(f4::load(nx), f4::load(ny), f4::load(nz));
+    }
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "sdf.h"
+#include "simd.h"
+
+// 4 points at a time versions of SDF::distance, SDF::blend and SDFDis.
+// results match the scalar versions lane for lane.
+
+inline f4 SDFDistance4(const SDF& sdf, const vec3x4& p)
+{
+    const vec3x4 q(
+        (p.x - f4(sdf.translation.x)) / f4(sdf.scale.x),
+        (p.y - f4(sdf.translation.y)) / f4(sdf.scale.y),
+        (p.z - f4(sdf.translation.z)) / f4(sdf.scale.z));
+
+    switch(sdf.type)
+    {
+        default:
+        case SDF_SPHERE:
+            return length(q) - f4(1.0f);
+        case SDF_BOX:
+        {
+            const f4 zero(0.0f);
+            const vec3x4 a(abs(q.x) - f4(1.0f), abs(q.y) - f4(1.0f), abs(q.z) - f4(1.0f));
+            const f4 inside = min(max(a.x, max(a.y, a.z)), zero);
+            const vec3x4 o(max(a.x, zero), max(a.y, zero), max(a.z, zero));
+            return inside + length(o);
+        }
+    }
+}
+
+inline f4 SDFBlend4(const SDF& sdf, f4 a, f4 b)
+{
+    switch(sdf.blend_type)
+    {
+        default:
+        case SDF_UNION:
+            return min(a, b);
+        case SDF_DIFF:
+            return max(a, -b);
+        case SDF_INTER:
+            return max(a, b);
+        case SDF_S_UNION:
+        {
+            const f4 k(sdf.smoothness);
+            const f4 e = max(k - abs(a - b), f4(0.0f));
+            return min(a, b) - e * e * f4(0.25f) / k;
+        }
+        case SDF_S_DIFF:
+        {
+            b = -b;
+            const f4 k(sdf.smoothness);
+            const f4 e = max(k - abs(a - b), f4(0.0f));
+            return max(a, b) - e * e * f4(0.25f) / k;
+        }
+        case SDF_S_INTER:
+        {
+            const f4 k(sdf.smoothness);
+            const f4 e = max(k - abs(a - b), f4(0.0f));
+            return max(a, b) - e * e * f4(0.25f) / k;
+        }
+    }
+}
+
+inline bool SDFSkippable4(const SDF& sdf, const vec3x4& p, f4 dis)
+{
+    if(sdf.blend_type != SDF_UNION || sdf.type != SDF_BOX)
+        return false;
+
+    const float s = glm::max(sdf.scale.x, glm::max(sdf.scale.y, sdf.scale.z));
+    const vec3x4 d(p.x - f4(sdf.translation.x), p.y - f4(sdf.translation.y), p.z - f4(sdf.translation.z));
+    const f4 bound = length(d) / f4(s) - f4(1.732051f);
+    return all(bound >= dis);
+}
+
+inline f4 SDFDis4(const SDFList& sdfs, const vec3x4& p)
+{
+    f4 dis(1000.0f);
+    for(const SDF& sdf : sdfs)
+    {
+        if(SDFSkippable4(sdf, p, dis))
+            continue;
+        dis = SDFBlend4(sdf, dis, SDFDistance4(sdf, p));
+    }
+    return dis;
+}
+
+template<typename Indices>
+inline f4 SDFDis4(const SDFList& sdfs, const Indices& indices, const vec3x4& p)
+{
+    f4 dis(1000.0f);
+    for(const u16 i : indices)
+    {
+        const SDF& sdf = sdfs[i];
+        if(SDFSkippable4(sdf, p, dis))
+            continue;
+        dis = SDFBlend4(sdf, dis, SDFDistance4(sdf, p));
+    }
+    return dis;
+}
+
+// central differences, unnormalised
+inline vec3x4 SDFGrad4(const SDFList& sdfs, const vec3x4& p, const float e = 0.001f)
+{
+    const f4 ex(e), zero(0.0f);
+    return vec3x4(
+        SDFDis4(sdfs, vec3x4(p.x + ex, p.y, p.z)) - SDFDis4(sdfs, vec3x4(p.x - ex, p.y, p.z)),
+        SDFDis4(sdfs, vec3x4(p.x, p.y + ex, p.z)) - SDFDis4(sdfs, vec3x4(p.x, p.y - ex, p.z)),
+        SDFDis4(sdfs, vec3x4(p.x, p.y, p.z + ex)) - SDFDis4(sdfs, vec3x4(p.x, p.y, p.z - ex)));
+}
+
+inline vec3x4 normalize(const vec3x4& v)
+{
+    const f4 len = max(length(v), f4(0.0000001f));
+    return vec3x4(v.x / len, v.y / len, v.z / len);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "ints.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define SIMD_SSE2 0
+#include <cmath>
+#include <cstring>
+#endif
+
+// 4 wide float with an SSE2 path and a scalar fallback.
+// comparisons return lane masks (all bits set) usable with select/any/all.
+struct f4
+{
+#if SIMD_SSE2
+    __m128 v;
+    f4(){}
+    f4(__m128 x) : v(x){}
+    f4(float x) : v(_mm_set1_ps(x)){}
+    f4(float a, float b, float c, float d) : v(_mm_setr_ps(a, b, c, d)){}
+    static f4 load(const float* p){ return _mm_loadu_ps(p); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+    float operator[](s32 i) const
+    {
+        float t[4];
+        store(t);
+        return t[i];
+    }
+#else
+    float v[4];
+    f4(){}
+    f4(float x){ v[0] = x; v[1] = x; v[2] = x; v[3] = x; }
+    f4(float a, float b, float c, float d){ v[0] = a; v[1] = b; v[2] = c; v[3] = d; }
+    static f4 load(const float* p){ return f4(p[0], p[1], p[2], p[3]); }
+    void store(float* p) const { p[0] = v[0]; p[1] = v[1]; p[2] = v[2]; p[3] = v[3]; }
+    float operator[](s32 i) const { return v[i]; }
+#endif
+};
+
+#if SIMD_SSE2
+
+inline f4 operator+(f4 a, f4 b){ return _mm_add_ps(a.v, b.v); }
+inline f4 operator-(f4 a, f4 b){ return _mm_sub_ps(a.v, b.v); }
+inline f4 operator*(f4 a, f4 b){ return _mm_mul_ps(a.v, b.v); }
+inline f4 operator/(f4 a, f4 b){ return _mm_div_ps(a.v, b.v); }
+inline f4 operator-(f4 a){ return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+inline f4 operator<(f4 a, f4 b){ return _mm_cmplt_ps(a.v, b.v); }
+inline f4 operator>(f4 a, f4 b){ return _mm_cmpgt_ps(a.v, b.v); }
+inline f4 operator<=(f4 a, f4 b){ return _mm_cmple_ps(a.v, b.v); }
+inline f4 operator>=(f4 a, f4 b){ return _mm_cmpge_ps(a.v, b.v); }
+inline f4 operator&(f4 a, f4 b){ return _mm_and_ps(a.v, b.v); }
+inline f4 operator|(f4 a, f4 b){ return _mm_or_ps(a.v, b.v); }
+inline f4 andnot(f4 mask, f4 a){ return _mm_andnot_ps(mask.v, a.v); }
+inline f4 min(f4 a, f4 b){ return _mm_min_ps(a.v, b.v); }
+inline f4 max(f4 a, f4 b){ return _mm_max_ps(a.v, b.v); }
+inline f4 abs(f4 a){ return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+inline f4 sqrt(f4 a){ return _mm_sqrt_ps(a.v); }
+inline f4 select(f4 mask, f4 a, f4 b){ return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+inline s32 movemask(f4 mask){ return _mm_movemask_ps(mask.v); }
+
+#else
+
+#define F4_BINARY(expr) f4 r; for(s32 i = 0; i < 4; ++i){ const float x = a.v[i]; const float y = b.v[i]; r.v[i] = (expr); } return r;
+#define F4_MASK(cond) f4 r; for(s32 i = 0; i < 4; ++i){ u32 m = (a.v[i] cond b.v[i]) ? 0xffffffffu : 0u; memcpy(&r.v[i], &m, 4); } return r;
+#define F4_BITS(op) f4 r; for(s32 i = 0; i < 4; ++i){ u32 x, y; memcpy(&x, &a.v[i], 4); memcpy(&y, &b.v[i], 4); x = op; memcpy(&r.v[i], &x, 4); } return r;
+
+inline f4 operator+(f4 a, f4 b){ F4_BINARY(x + y) }
+inline f4 operator-(f4 a, f4 b){ F4_BINARY(x - y) }
+inline f4 operator*(f4 a, f4 b){ F4_BINARY(x * y) }
+inline f4 operator/(f4 a, f4 b){ F4_BINARY(x / y) }
+inline f4 operator-(f4 a){ return f4(-a.v[0], -a.v[1], -a.v[2], -a.v[3]); }
+inline f4 operator<(f4 a, f4 b){ F4_MASK(<) }
+inline f4 operator>(f4 a, f4 b){ F4_MASK(>) }
+inline f4 operator<=(f4 a, f4 b){ F4_MASK(<=) }
+inline f4 operator>=(f4 a, f4 b){ F4_MASK(>=) }
+inline f4 operator&(f4 a, f4 b){ F4_BITS(x & y) }
+inline f4 operator|(f4 a, f4 b){ F4_BITS(x | y) }
+inline f4 andnot(f4 a, f4 b){ F4_BITS(~x & y) }
+inline f4 min(f4 a, f4 b){ F4_BINARY(x < y ? x : y) }
+inline f4 max(f4 a, f4 b){ F4_BINARY(x > y ? x : y) }
+inline f4 abs(f4 a){ return f4(fabsf(a.v[0]), fabsf(a.v[1]), fabsf(a.v[2]), fabsf(a.v[3])); }
+inline f4 sqrt(f4 a){ return f4(sqrtf(a.v[0]), sqrtf(a.v[1]), sqrtf(a.v[2]), sqrtf(a.v[3])); }
+inline f4 select(f4 mask, f4 a, f4 b){ return (mask & a) | andnot(mask, b); }
+inline s32 movemask(f4 mask)
+{
+    s32 r = 0;
+    for(s32 i = 0; i < 4; ++i)
+    {
+        u32 m;
+        memcpy(&m, &mask.v[i], 4);
+        r |= (m >> 31) << i;
+    }
+    return r;
+}
+
+#undef F4_BINARY
+#undef F4_MASK
+#undef F4_BITS
+
+#endif // SIMD_SSE2
+
+inline bool any(f4 mask){ return movemask(mask) != 0; }
+inline bool all(f4 mask){ return movemask(mask) == 0xf; }
+
+// structure of arrays vec3, one lane per point
+struct vec3x4
+{
+    f4 x, y, z;
+    vec3x4(){}
+    vec3x4(f4 a, f4 b, f4 c) : x(a), y(b), z(c){}
+};
+
+inline vec3x4 operator+(const vec3x4& a, const vec3x4& b){ return vec3x4(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline vec3x4 operator-(const vec3x4& a, const vec3x4& b){ return vec3x4(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline vec3x4 operator*(const vec3x4& a, f4 s){ return vec3x4(a.x * s, a.y * s, a.z * s); }
+inline f4 dot(const vec3x4& a, const vec3x4& b){ return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline f4 length(const vec3x4& a){ return sqrt(dot(a, a)); }
+inline vec3x4 select(f4 mask, const vec3x4& a, const vec3x4& b)
+{
+    return vec3x4(select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z));
+}
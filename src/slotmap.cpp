@@ -0,0 +1,84 @@
+#include "slotmap.h"
+#include "cputimer.h"
+#include <cstdio>
+#include <random>
+
+struct SlotBenchItem
+{
+    u32 m_id;
+    float m_payload[7];
+};
+
+void SlotMapBench()
+{
+    const s32 live = 4096;
+    const s32 churn = 1 << 20;
+    std::mt19937 rng(3);
+
+    SlotMap<SlotBenchItem> map;
+    Vector<SlotHandle> handles;
+    Vector<u32> ids;
+    Vector<SlotHandle> stale;
+    u32 next_id = 0;
+    for(s32 i = 0; i < live; ++i)
+    {
+        SlotBenchItem item = {};
+        item.m_id = next_id;
+        handles.grow() = map.insert(item);
+        ids.grow() = next_id++;
+    }
+
+    // replace a random live item per step, keeping every removed handle
+    u32 wrong = 0;
+    CPUTimer timer;
+    for(s32 i = 0; i < churn; ++i)
+    {
+        const s32 k = s32(rng() % u32(live));
+        if(!map.remove(handles[k]))
+            ++wrong;
+        if((i & 255) == 0)
+            stale.grow() = handles[k];
+        SlotBenchItem item = {};
+        item.m_id = next_id;
+        handles[k] = map.insert(item);
+        ids[k] = next_id++;
+    }
+    const double churn_ms = timer.ms();
+
+    timer.begin();
+    u64 sum = 0;
+    for(s32 rep = 0; rep < 256; ++rep)
+    {
+        for(s32 k = 0; k < live; ++k)
+        {
+            const SlotBenchItem& item = map[handles[k]];
+            sum += item.m_id;
+            wrong += item.m_id != ids[k];
+        }
+    }
+    const double lookup_ms = timer.ms();
+
+    timer.begin();
+    for(s32 rep = 0; rep < 256; ++rep)
+    {
+        for(const SlotBenchItem& item : map)
+        {
+            sum += item.m_id;
+            wrong += &map[map.handleOf(item)] != &item;
+        }
+    }
+    const double iterate_ms = timer.ms();
+
+    for(const SlotHandle h : stale)
+    {
+        wrong += map.get(h) != nullptr;
+    }
+    wrong += map.get(SLOT_NULL) != nullptr;
+
+    const double lookups = 256.0 * live;
+    printf("[SlotMap] %d live, %d remove+insert: %.1f ns per pair\n", live, churn, churn_ms * 1e6 / churn);
+    printf("[SlotMap] lookup %.2f ns, iterate with reverse lookup %.2f ns per item\n",
+        lookup_ms * 1e6 / lookups, iterate_ms * 1e6 / lookups);
+    printf("[SlotMap] %d stale handles rejected, %u errors (%llu)\n",
+        stale.count(), wrong, (unsigned long long)sum);
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "ints.h"
+#include "asserts.h"
+#include "array.h"
+
+// A handle packs a slot index in the low 16 bits and that slot's generation
+// in the high 16. Removing bumps the generation, so stale handles fail
+// valid() instead of aliasing whatever reuses the slot. Generations skip 0,
+// so a zero handle is never valid.
+typedef u32 SlotHandle;
+
+#define SLOT_NULL       0u
+#define SLOT_INDEX(h)   ((h) & 0xffffu)
+#define SLOT_GEN(h)     ((h) >> 16)
+
+// Generational slot map: O(1) insert, remove and lookup by handle. Values
+// live packed in a dense Vector for iteration and removal swaps the last
+// value into the hole; m_owners maps each dense position back to its slot.
+// Free slots form a list through m_dense and are reused first.
+// Dense pointers are valid until the next insert or remove.
+template<typename T>
+class SlotMap
+{
+    struct Slot
+    {
+        u16 m_gen;
+        u16 m_dense;    // position in m_values, or the next free slot
+    };
+
+    Vector<T> m_values;
+    Vector<u16> m_owners;
+    Vector<Slot> m_slots;
+    u16 m_free = 0xffff;
+
+    SlotHandle take()
+    {
+        u16 idx;
+        if(m_free != 0xffff)
+        {
+            idx = m_free;
+            m_free = m_slots[idx].m_dense;
+        }
+        else
+        {
+            Assert(m_slots.count() < 0xffff);
+            idx = u16(m_slots.count());
+            m_slots.grow().m_gen = 1;
+        }
+        Slot& s = m_slots[idx];
+        s.m_dense = u16(m_values.count());
+        m_owners.grow() = idx;
+        return (u32(s.m_gen) << 16) | idx;
+    }
+
+public:
+    s32 count() const { return m_values.count(); }
+    bool empty() const { return m_values.count() == 0; }
+    T* begin(){ return m_values.begin(); }
+    T* end(){ return m_values.end(); }
+    const T* begin() const { return m_values.begin(); }
+    const T* end() const { return m_values.end(); }
+
+    bool valid(SlotHandle h) const
+    {
+        const u32 idx = SLOT_INDEX(h);
+        return idx < u32(m_slots.count()) && m_slots[idx].m_gen == SLOT_GEN(h);
+    }
+    // null on a stale or null handle
+    T* get(SlotHandle h)
+    {
+        return valid(h) ? m_values.begin() + m_slots[SLOT_INDEX(h)].m_dense : nullptr;
+    }
+    const T* get(SlotHandle h) const
+    {
+        return valid(h) ? m_values.begin() + m_slots[SLOT_INDEX(h)].m_dense : nullptr;
+    }
+    T& operator[](SlotHandle h)
+    {
+        Assert(valid(h));
+        return m_values[m_slots[SLOT_INDEX(h)].m_dense];
+    }
+    const T& operator[](SlotHandle h) const
+    {
+        Assert(valid(h));
+        return m_values[m_slots[SLOT_INDEX(h)].m_dense];
+    }
+
+    // default constructs the value
+    SlotHandle insert()
+    {
+        const SlotHandle h = take();
+        m_values.grow();
+        return h;
+    }
+    SlotHandle insert(const T& t)
+    {
+        const SlotHandle h = take();
+        m_values.push(t);
+        return h;
+    }
+    SlotHandle insert(T&& t)
+    {
+        const SlotHandle h = take();
+        m_values.push(std::move(t));
+        return h;
+    }
+    // false if h was already stale
+    bool remove(SlotHandle h)
+    {
+        if(!valid(h))
+            return false;
+        const u16 idx = u16(SLOT_INDEX(h));
+        Slot& s = m_slots[idx];
+        const u16 pos = s.m_dense;
+        const u16 last = u16(m_values.count() - 1);
+        m_values.remove(pos);
+        if(pos != last)
+        {
+            const u16 moved = m_owners[last];
+            m_owners[pos] = moved;
+            m_slots[moved].m_dense = pos;
+        }
+        m_owners.pop();
+
+        s.m_gen = u16(s.m_gen + 1) ? u16(s.m_gen + 1) : 1;
+        s.m_dense = m_free;
+        m_free = idx;
+        return true;
+    }
+    void clear()
+    {
+        for(s32 i = m_owners.count() - 1; i >= 0; --i)
+        {
+            remove(handleAt(i));
+        }
+    }
+
+    // reverse lookups from a dense position or a value in the map
+    SlotHandle handleAt(s32 pos) const
+    {
+        const u16 idx = m_owners[pos];
+        return (u32(m_slots[idx].m_gen) << 16) | idx;
+    }
+    SlotHandle handleOf(const T& item) const
+    {
+        const s32 pos = s32(&item - m_values.begin());
+        Assert(pos >= 0 && pos < m_values.count());
+        return handleAt(pos);
+    }
+};
+
+// churns inserts and removes, timing lookups and checking every stale
+// handle is rejected
+void SlotMapBench();
@@ -0,0 +1,121 @@
+#include "sort.h"
+#include "cputimer.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+struct SortBenchItem
+{
+    u32 key;
+    u32 payload[3];
+    bool operator<(const SortBenchItem& o) const { return key < o.key; }
+};
+
+// best of 5 runs of fn over a fresh copy of src
+template<typename T, typename Fn>
+static double SortMs(const T* src, T* work, const u32 count, Fn fn)
+{
+    double best = 1e9;
+    for(s32 rep = 0; rep < 5; ++rep)
+    {
+        memcpy(work, src, sizeof(T) * count);
+        CPUTimer timer;
+        fn(work, work + count);
+        const double ms = timer.ms();
+        best = ms < best ? ms : best;
+    }
+    return best;
+}
+
+template<typename T>
+static bool Sorted(const T* a, const u32 count)
+{
+    for(u32 i = 1; i < count; ++i)
+    {
+        if(a[i] < a[i - 1])
+            return false;
+    }
+    return true;
+}
+
+template<typename T>
+static void SortBenchKeys(const char* name, const T* src, const u32 count)
+{
+    T* work = new T[count];
+    T* scratch = new T[count];
+    bool ok = true;
+    const double std_ms = SortMs(src, work, count, [](T* a, T* b){ std::sort(a, b); });
+    const double intro_ms = SortMs(src, work, count, [](T* a, T* b){ IntroSort(a, b); });
+    ok = ok && Sorted(work, count);
+    const double radix_ms = SortMs(src, work, count, [&](T* a, T* b){ RadixSort(a, scratch, u32(b - a)); });
+    ok = ok && Sorted(work, count);
+    printf("[Sort] 100k %-6s std::sort %.3f ms, introsort %.3f ms, radix %.3f ms%s\n",
+        name, std_ms, intro_ms, radix_ms, ok ? "" : ", NOT SORTED");
+    delete[] work;
+    delete[] scratch;
+}
+
+void SortBench()
+{
+    const u32 count = 100000;
+    std::mt19937_64 rng(7);
+    u32* u32s = new u32[count];
+    u64* u64s = new u64[count];
+    float* floats = new float[count];
+    u64* draws = new u64[count];
+    SortBenchItem* items = new SortBenchItem[count];
+    std::uniform_real_distribution<float> dist(-1000.0f, 1000.0f);
+    for(u32 i = 0; i < count; ++i)
+    {
+        u32s[i] = u32(rng());
+        u64s[i] = rng();
+        floats[i] = dist(rng);
+        // draw keys as Renderables builds them: program, view depth, handle
+        draws[i] = (u64(rng() & 3) << 48) | (u64(SortKey(dist(rng) + 1000.0f)) << 16) | u64(i & 0xffff);
+        items[i].key = u32(rng());
+    }
+
+    SortBenchKeys("u32", u32s, count);
+    SortBenchKeys("u64", u64s, count);
+    SortBenchKeys("float", floats, count);
+    SortBenchKeys("draws", draws, count);
+
+    // general types go to introsort; radix by the key member
+    SortBenchItem* work = new SortBenchItem[count];
+    SortBenchItem* scratch = new SortBenchItem[count];
+    const double std_ms = SortMs(items, work, count, [](SortBenchItem* a, SortBenchItem* b){ std::sort(a, b); });
+    const double intro_ms = SortMs(items, work, count, [](SortBenchItem* a, SortBenchItem* b){ IntroSort(a, b); });
+    bool ok = Sorted(work, count);
+    const double radix_ms = SortMs(items, work, count, [&](SortBenchItem* a, SortBenchItem* b)
+    {
+        RadixSort(a, scratch, u32(b - a), [](const SortBenchItem& item){ return item.key; });
+    });
+    ok = ok && Sorted(work, count);
+    printf("[Sort] 100k 16 byte items by u32 key: std::sort %.3f ms, introsort %.3f ms, radix %.3f ms%s\n",
+        std_ms, intro_ms, radix_ms, ok ? "" : ", NOT SORTED");
+
+    // already sorted and all equal input, where naive quicksorts degrade
+    u32* sorted = new u32[count];
+    for(u32 i = 0; i < count; ++i)
+    {
+        sorted[i] = i;
+    }
+    u32* work32 = new u32[count];
+    const double presorted_ms = SortMs(sorted, work32, count, [](u32* a, u32* b){ IntroSort(a, b); });
+    for(u32 i = 0; i < count; ++i)
+    {
+        sorted[i] = 7;
+    }
+    const double equal_ms = SortMs(sorted, work32, count, [](u32* a, u32* b){ IntroSort(a, b); });
+    printf("[Sort] introsort on 100k presorted %.3f ms, all equal %.3f ms\n", presorted_ms, equal_ms);
+
+    delete[] u32s;
+    delete[] u64s;
+    delete[] floats;
+    delete[] draws;
+    delete[] items;
+    delete[] work;
+    delete[] scratch;
+    delete[] sorted;
+    delete[] work32;
+}
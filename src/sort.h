@@ -0,0 +1,228 @@
+#pragma once
+
+#include "ints.h"
+#include "arena.h"
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+// Order preserving maps from arithmetic values to unsigned integers: signed
+// values flip the sign bit, floats flip every bit when negative and only the
+// sign bit otherwise, so comparing the results unsigned matches the values.
+inline u32 SortKey(const u8 v){ return v; }
+inline u32 SortKey(const u16 v){ return v; }
+inline u32 SortKey(const u32 v){ return v; }
+inline u64 SortKey(const unsigned long long v){ return v; }
+inline u64 SortKey(const unsigned long v){ return v; }
+inline u32 SortKey(const s8 v){ return u32(s32(v)) ^ 0x80000000u; }
+inline u32 SortKey(const s16 v){ return u32(s32(v)) ^ 0x80000000u; }
+inline u32 SortKey(const s32 v){ return u32(v) ^ 0x80000000u; }
+inline u64 SortKey(const long long v){ return u64(v) ^ 0x8000000000000000ull; }
+inline u64 SortKey(const long v){ return u64(v) ^ 0x8000000000000000ull; }
+inline u32 SortKey(const float v)
+{
+    u32 u;
+    memcpy(&u, &v, sizeof(u));
+    return u ^ (u32(s32(u) >> 31) | 0x80000000u);
+}
+inline u64 SortKey(const double v)
+{
+    u64 u;
+    memcpy(&u, &v, sizeof(u));
+    return u ^ (u64(s64(u) >> 63) | 0x8000000000000000ull);
+}
+
+// LSD radix sort on 8 bit digits of key(item), an unsigned integer. One pass
+// over the input builds every digit's histogram; digits all keys share are
+// skipped, so narrow ranges in wide keys cost few passes. Stable. scratch
+// holds count items; the result ends in data.
+template<typename T, typename KeyFn>
+void RadixSort(T* data, T* scratch, const u32 count, KeyFn key)
+{
+    typedef decltype(key(data[0])) K;
+    static_assert(std::is_unsigned<K>::value, "radix keys are unsigned integers, see SortKey");
+    static_assert(std::is_trivially_copyable<T>::value, "radix sort moves items with memcpy");
+    const u32 digits = sizeof(K);
+    if(count < 2)
+        return;
+
+    u32 hist[digits][256];
+    memset(hist, 0, sizeof(hist));
+    for(u32 i = 0; i < count; ++i)
+    {
+        const K k = key(data[i]);
+        for(u32 d = 0; d < digits; ++d)
+        {
+            ++hist[d][(k >> (d * 8)) & 0xff];
+        }
+    }
+
+    T* src = data;
+    T* dst = scratch;
+    for(u32 d = 0; d < digits; ++d)
+    {
+        u32* h = hist[d];
+        const u32 shift = d * 8;
+        if(h[(key(src[0]) >> shift) & 0xff] == count)
+            continue;
+        u32 sum = 0;
+        for(u32 b = 0; b < 256; ++b)
+        {
+            const u32 n = h[b];
+            h[b] = sum;
+            sum += n;
+        }
+        for(u32 i = 0; i < count; ++i)
+        {
+            dst[h[(key(src[i]) >> shift) & 0xff]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    if(src != data)
+    {
+        memcpy(data, src, sizeof(T) * count);
+    }
+}
+
+template<typename T>
+void RadixSort(T* data, T* scratch, const u32 count)
+{
+    RadixSort(data, scratch, count, [](const T& v){ return SortKey(v); });
+}
+
+template<typename T, typename Less>
+void InsertionSort(T* a, T* b, Less less)
+{
+    for(T* i = a + 1; i < b; ++i)
+    {
+        T v = std::move(*i);
+        T* j = i;
+        for(; j > a && less(v, j[-1]); --j)
+        {
+            *j = std::move(j[-1]);
+        }
+        *j = std::move(v);
+    }
+}
+
+template<typename T, typename Less>
+void HeapSort(T* a, T* b, Less less)
+{
+    const ptrdiff_t n = b - a;
+    auto sift = [&](ptrdiff_t root, const ptrdiff_t end)
+    {
+        while(true)
+        {
+            ptrdiff_t child = root * 2 + 1;
+            if(child >= end)
+                return;
+            if(child + 1 < end && less(a[child], a[child + 1]))
+                ++child;
+            if(!less(a[root], a[child]))
+                return;
+            std::swap(a[root], a[child]);
+            root = child;
+        }
+    };
+    for(ptrdiff_t i = n / 2; i > 0; --i)
+    {
+        sift(i - 1, n);
+    }
+    for(ptrdiff_t end = n - 1; end > 0; --end)
+    {
+        std::swap(a[0], a[end]);
+        sift(0, end);
+    }
+}
+
+// Quicksort with a median of three Hoare partition, recursing into the
+// smaller side. Past 2 log2(n) levels a range goes to heap sort, so bad
+// pivots cannot go quadratic; ranges of 16 or fewer are left for one
+// insertion sort pass at the end.
+template<typename T, typename Less>
+void IntroSort(T* a, T* b, Less less)
+{
+    u32 depth = 0;
+    for(ptrdiff_t n = b - a; n > 1; n >>= 1)
+    {
+        depth += 2;
+    }
+
+    struct Local
+    {
+        static void loop(T* a, T* b, u32 depth, Less& less)
+        {
+            while(b - a > 16)
+            {
+                if(!depth)
+                {
+                    HeapSort(a, b, less);
+                    return;
+                }
+                --depth;
+
+                T* mid = a + (b - a - 1) / 2;
+                if(less(*mid, *a)) std::swap(*mid, *a);
+                if(less(b[-1], *mid)) std::swap(b[-1], *mid);
+                if(less(*mid, *a)) std::swap(*mid, *a);
+                const T pivot = *mid;
+
+                T* i = a - 1;
+                T* j = b;
+                while(true)
+                {
+                    do{ ++i; } while(less(*i, pivot));
+                    do{ --j; } while(less(pivot, *j));
+                    if(i >= j)
+                        break;
+                    std::swap(*i, *j);
+                }
+
+                // [a, j] and (j, b)
+                T* split = j + 1;
+                if(split - a < b - split)
+                {
+                    loop(a, split, depth, less);
+                    a = split;
+                }
+                else
+                {
+                    loop(split, b, depth, less);
+                    b = split;
+                }
+            }
+        }
+    };
+    Local::loop(a, b, depth, less);
+    InsertionSort(a, b, less);
+}
+
+template<typename T>
+void IntroSort(T* a, T* b)
+{
+    IntroSort(a, b, [](const T& x, const T& y){ return x < y; });
+}
+
+// what Array::sort and Vector::sort use: radix sort through the thread arena
+// for integers and floats, introsort for everything else
+template<typename T>
+typename std::enable_if<std::is_arithmetic<T>::value>::type Sort(T* a, T* b)
+{
+    if(b - a <= 64)
+    {
+        InsertionSort(a, b, [](const T& x, const T& y){ return SortKey(x) < SortKey(y); });
+        return;
+    }
+    ArenaScope scope;
+    T* scratch = (T*)scope.m_arena.alloc(sizeof(T) * size_t(b - a));
+    RadixSort(a, scratch, u32(b - a));
+}
+
+template<typename T>
+typename std::enable_if<!std::is_arithmetic<T>::value>::type Sort(T* a, T* b)
+{
+    IntroSort(a, b);
+}
+
+// radix, introsort and insertion sort against std::sort on 100k keys
+void SortBench();
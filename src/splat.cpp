@@ -0,0 +1,408 @@
+#include "splat.h"
+
+#if MESH_GEN_ENABLED
+
+#include "asserts.h"
+#include "parallelfor.h"
+#include "cputimer.h"
+#include "randf.h"
+#include "raycast.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_access.hpp>
+#include <cfloat>
+
+struct SplatCell
+{
+    SDFIndices indices;
+    vec3 center;
+    float radius = 0.0f;    // half the edge, as SubTask
+};
+
+void SplatTree::build(const MeshTask& task, const u32 num_threads)
+{
+    m_nodes.clear();
+    m_levels.clear();
+
+    const SDFList& sdfs = task.sdfs;
+    const float lipschitz = SafeRelaxation(sdfs);
+
+    // ping pong between two levels; Vector has no safe move assignment
+    Vector<SplatCell> levels[2];
+    {
+        SplatCell& root = levels[0].grow();
+        root.center = task.center;
+        root.radius = task.radius;
+        const float qlen = 1.732052f * root.radius;
+        for(u16 i = 0; i < u16(sdfs.count()); ++i)
+        {
+            if(sdfs[i].distance(root.center) < qlen)
+            {
+                root.indices.grow() = i;
+            }
+        }
+        if(!root.indices.count())
+            return;
+    }
+
+    for(u32 depth = 0; levels[depth & 1].count(); ++depth)
+    {
+        const Vector<SplatCell>& level = levels[depth & 1];
+        Vector<SplatCell>& next = levels[(depth + 1) & 1];
+        const u32 first = u32(m_nodes.count());
+        m_levels.grow() = first;
+        for(s32 i = 0; i < level.count(); ++i)
+        {
+            m_nodes.grow();
+        }
+
+        const bool leaf = depth == task.max_depth;
+        Array<SplatCell, 8>* kids = leaf ? nullptr : new Array<SplatCell, 8>[level.count()];
+
+        ParallelForStealing(u32(level.count()), num_threads, [&](u32 i, u32)
+        {
+            const SplatCell& cell = level[i];
+            const MeshVertex vert = SurfacePoint(sdfs, cell.indices, cell.center, cell.radius);
+            SplatNode& node = m_nodes[first + i];
+            node.position = vert.position;
+            node.normal = vert.normal;
+            node.color = vert.color;
+            node.material = vert.material;
+            node.center = cell.center;
+            node.half = cell.radius;
+            node.radius = cell.radius * 1.732052f;
+            node.first_child = 0;
+            node.num_children = 0;
+
+            if(leaf)
+                return;
+
+            const float nlen = cell.radius * 0.5f;
+            for(u32 c = 0; c < 8; ++c)
+            {
+                SplatCell child;
+                child.center = cell.center;
+                child.center.x += (c & 1) ? -nlen : nlen;
+                child.center.y += (c & 2) ? -nlen : nlen;
+                child.center.z += (c & 4) ? -nlen : nlen;
+                child.radius = nlen;
+                if(SurfaceCell(sdfs, cell.indices, child.center, child.radius, lipschitz, child.indices))
+                {
+                    kids[i].grow() = child;
+                }
+            }
+        });
+
+        next.clear();
+        if(leaf)
+            break;
+
+        u32 num_next = 0;
+        for(s32 i = 0; i < level.count(); ++i)
+        {
+            SplatNode& node = m_nodes[first + i];
+            node.first_child = first + u32(level.count()) + num_next;
+            node.num_children = u32(kids[i].count());
+            for(const SplatCell& child : kids[i])
+            {
+                next.grow() = child;
+            }
+            num_next += node.num_children;
+        }
+        delete[] kids;
+    }
+}
+
+void SplatTree::selectCut(const SplatView& view, const float max_error, Vector<u32>& cut) const
+{
+    cut.clear();
+    if(!m_nodes.count())
+        return;
+
+    // clip planes from the rows of VP, inside where dot(plane, p) >= 0
+    vec4 planes[6];
+    for(s32 i = 0; i < 3; ++i)
+    {
+        const vec4 row3 = glm::row(view.VP, 3);
+        const vec4 row = glm::row(view.VP, i);
+        planes[i * 2 + 0] = row3 + row;
+        planes[i * 2 + 1] = row3 - row;
+    }
+
+    Array<u32, 256> stack;
+    stack.grow() = 0;
+    while(stack.count())
+    {
+        const u32 idx = stack.pop();
+        const SplatNode& node = m_nodes[idx];
+        // an inner cell whose children all missed the surface
+        if(!node.num_children && idx < m_levels.back())
+            continue;
+
+        const float bound = node.half * 1.732052f;
+
+        bool visible = true;
+        for(const vec4& plane : planes)
+        {
+            if(glm::dot(vec3(plane), node.center) + plane.w < -bound * glm::length(vec3(plane)))
+            {
+                visible = false;
+                break;
+            }
+        }
+        if(!visible)
+            continue;
+
+        // how far the splat's square can reach past the surface it stands for:
+        // its projected radius at the closest point of the cell's bounding
+        // sphere. RasterSplats samples pixel centers like RasterTriangles, so
+        // a fraction of a pixel covers about the pixels the leaves would.
+        const float dis = glm::max(glm::distance(view.eye, node.center) - bound, 0.0001f);
+        const float error = node.radius * view.pixels_per_unit / dis;
+        if(error <= max_error || !node.num_children)
+        {
+            cut.grow() = idx;
+            continue;
+        }
+        for(u32 c = 0; c < node.num_children; ++c)
+        {
+            stack.grow() = node.first_child + c;
+        }
+    }
+}
+
+// ------------------------------------------------------------------------
+
+RasterTarget::RasterTarget(const u32 w, const u32 h)
+{
+    width = w;
+    height = h;
+    rgba = new u8[w * h * 4];
+    depth = new float[w * h];
+    clear();
+}
+
+RasterTarget::~RasterTarget()
+{
+    delete[] rgba;
+    delete[] depth;
+}
+
+void RasterTarget::clear()
+{
+    for(u32 i = 0; i < width * height; ++i)
+    {
+        rgba[i * 4 + 0] = 0;
+        rgba[i * 4 + 1] = 0;
+        rgba[i * 4 + 2] = 0;
+        rgba[i * 4 + 3] = 255;
+        depth[i] = FLT_MAX;
+    }
+}
+
+static void WritePixel(RasterTarget& target, const u32 i, const float depth, const vec3& color)
+{
+    if(depth >= target.depth[i])
+        return;
+    target.depth[i] = depth;
+    target.rgba[i * 4 + 0] = u8(color.x * 255.0f + 0.5f);
+    target.rgba[i * 4 + 1] = u8(color.y * 255.0f + 0.5f);
+    target.rgba[i * 4 + 2] = u8(color.z * 255.0f + 0.5f);
+}
+
+void RasterSplats(const SplatTree& tree, const Vector<u32>& cut, const SplatView& view,
+    const CPUSun& sun, RasterTarget& target)
+{
+    const float W = float(target.width);
+    const float H = float(target.height);
+    for(const u32 idx : cut)
+    {
+        const SplatNode& node = tree.m_nodes[idx];
+        const vec3 V = view.eye - node.position;
+        if(glm::dot(node.normal, V) < 0.0f)
+            continue;
+
+        const vec4 clip = view.VP * vec4(node.position, 1.0f);
+        if(clip.w < 0.01f)
+            continue;
+
+        const float sx = (clip.x / clip.w * 0.5f + 0.5f) * W;
+        const float sy = (0.5f - clip.y / clip.w * 0.5f) * H;
+        const float r = node.radius * view.pixels_per_unit / clip.w;
+        // pixels whose centers the square covers, as RasterTriangles samples
+        const s32 x0 = glm::max(s32(glm::ceil(sx - r - 0.5f)), 0);
+        const s32 x1 = glm::min(s32(glm::floor(sx + r - 0.5f)), s32(target.width) - 1);
+        const s32 y0 = glm::max(s32(glm::ceil(sy - r - 0.5f)), 0);
+        const s32 y1 = glm::min(s32(glm::floor(sy + r - 0.5f)), s32(target.height) - 1);
+        if(x0 > x1 || y0 > y1)
+            continue;
+
+        const vec3 color = CPUShade(glm::normalize(V), node.normal, node.color, node.material.x, node.material.y, sun);
+        for(s32 y = y0; y <= y1; ++y)
+        {
+            for(s32 x = x0; x <= x1; ++x)
+            {
+                WritePixel(target, u32(y) * target.width + u32(x), clip.w, color);
+            }
+        }
+    }
+}
+
+void RasterTriangles(const Geometry& geom, const SplatView& view, const CPUSun& sun, RasterTarget& target)
+{
+    const s32 num_verts = geom.vertices.count();
+    if(!num_verts)
+        return;
+
+    const float W = float(target.width);
+    const float H = float(target.height);
+    vec4* clip = new vec4[num_verts];
+    vec3* colors = new vec3[num_verts];
+    for(s32 i = 0; i < num_verts; ++i)
+    {
+        const MeshVertex& vert = geom.vertices[i];
+        clip[i] = view.VP * vec4(vert.position, 1.0f);
+        const vec3 V = glm::normalize(view.eye - vert.position);
+        colors[i] = CPUShade(V, vert.normal, vert.color, vert.material.x, vert.material.y, sun);
+    }
+
+    const bool indexed = geom.indices.count() > 0;
+    const s32 num_tris = (indexed ? geom.indices.count() : num_verts) / 3;
+    for(s32 t = 0; t < num_tris; ++t)
+    {
+        s32 ids[3];
+        vec3 N = vec3(0.0f), centroid = vec3(0.0f);
+        bool clipped = false;
+        for(s32 j = 0; j < 3; ++j)
+        {
+            ids[j] = indexed ? s32(geom.indices[t * 3 + j]) : t * 3 + j;
+            N += geom.vertices[ids[j]].normal;
+            centroid += geom.vertices[ids[j]].position;
+            clipped = clipped || clip[ids[j]].w < 0.01f;
+        }
+        if(clipped || glm::dot(N, view.eye - centroid * (1.0f / 3.0f)) < 0.0f)
+            continue;
+
+        vec2 s[3];
+        float inv_w[3];
+        for(s32 j = 0; j < 3; ++j)
+        {
+            const vec4& c = clip[ids[j]];
+            inv_w[j] = 1.0f / c.w;
+            s[j] = vec2((c.x * inv_w[j] * 0.5f + 0.5f) * W, (0.5f - c.y * inv_w[j] * 0.5f) * H);
+        }
+
+        auto Edge = [](const vec2& a, const vec2& b, const vec2& p)
+        {
+            return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+        };
+        const float area = Edge(s[0], s[1], s[2]);
+        if(glm::abs(area) < 0.000001f)
+            continue;
+
+        const vec2 lo = glm::min(s[0], glm::min(s[1], s[2]));
+        const vec2 hi = glm::max(s[0], glm::max(s[1], s[2]));
+        const s32 x0 = glm::max(s32(lo.x), 0);
+        const s32 x1 = glm::min(s32(hi.x), s32(target.width) - 1);
+        const s32 y0 = glm::max(s32(lo.y), 0);
+        const s32 y1 = glm::min(s32(hi.y), s32(target.height) - 1);
+        const float inv_area = 1.0f / area;
+
+        for(s32 y = y0; y <= y1; ++y)
+        {
+            for(s32 x = x0; x <= x1; ++x)
+            {
+                const vec2 p = vec2(float(x) + 0.5f, float(y) + 0.5f);
+                const float l0 = Edge(s[1], s[2], p) * inv_area;
+                const float l1 = Edge(s[2], s[0], p) * inv_area;
+                const float l2 = Edge(s[0], s[1], p) * inv_area;
+                if(l0 < 0.0f || l1 < 0.0f || l2 < 0.0f)
+                    continue;
+
+                // perspective correct
+                const float iw = l0 * inv_w[0] + l1 * inv_w[1] + l2 * inv_w[2];
+                const vec3 color = (colors[ids[0]] * (l0 * inv_w[0]) + colors[ids[1]] * (l1 * inv_w[1])
+                    + colors[ids[2]] * (l2 * inv_w[2])) / iw;
+                WritePixel(target, u32(y) * target.width + u32(x), 1.0f / iw, color);
+            }
+        }
+    }
+
+    delete[] clip;
+    delete[] colors;
+}
+
+// ------------------------------------------------------------------------
+
+void SplatBench()
+{
+    MeshTask task;
+    for(u32 i = 0; i < 12; ++i)
+    {
+        SDF& sdf = task.sdfs.grow();
+        sdf.type = (i & 1) ? SDF_SPHERE : SDF_BOX;
+        sdf.translation = vec3(randf(), randf(), randf()) * 4.0f - 2.0f;
+        sdf.material.setColor(vec3(randf(), randf(), randf()));
+    }
+    task.center = vec3(0.0f);
+    task.radius = 4.0f;
+    task.max_depth = 7;
+
+    CPUTimer timer;
+    SplatTree tree;
+    tree.build(task);
+    printf("[Splat] %d nodes over %d levels in %.1f ms, %d leaves\n",
+        tree.m_nodes.count(), tree.m_levels.count(), timer.ms(), tree.m_nodes.count() - s32(tree.m_levels.back()));
+
+    timer.begin();
+    GenerateMeshDC(task);
+    printf("[Splat] dual contoured mesh at the same depth: %d tris in %.1f ms\n",
+        task.geom.indices.count() / 3, timer.ms());
+
+    const u32 width = 640, height = 360;
+    const float fov = glm::radians(60.0f);
+    const mat4 P = glm::perspective(fov, float(width) / float(height), 0.1f, 1000.0f);
+    SplatView view;
+    view.pixels_per_unit = float(height) / (2.0f * glm::tan(fov * 0.5f));
+
+    const CPUSun sun;
+    const float max_error = 0.25f;
+    RasterTarget splats(width, height), tris(width, height);
+    Vector<u32> cut;
+    for(float dis = 8.0f; dis <= 256.0f; dis *= 2.0f)
+    {
+        view.eye = glm::normalize(vec3(1.0f, 0.6f, 1.0f)) * dis;
+        view.VP = P * glm::lookAt(view.eye, task.center, vec3(0.0f, 1.0f, 0.0f));
+
+        const s32 frames = 8;
+        timer.begin();
+        for(s32 f = 0; f < frames; ++f)
+        {
+            splats.clear();
+            tree.selectCut(view, max_error, cut);
+            RasterSplats(tree, cut, view, sun, splats);
+        }
+        const double splat_ms = timer.ms() / frames;
+
+        timer.begin();
+        for(s32 f = 0; f < frames; ++f)
+        {
+            tris.clear();
+            RasterTriangles(task.geom, view, sun, tris);
+        }
+        const double tri_ms = timer.ms() / frames;
+
+        u32 both = 0, either = 0;
+        for(u32 i = 0; i < width * height; ++i)
+        {
+            const bool a = splats.depth[i] != FLT_MAX;
+            const bool b = tris.depth[i] != FLT_MAX;
+            both += (a && b) ? 1 : 0;
+            either += (a || b) ? 1 : 0;
+        }
+        printf("[Splat] distance %5.0f: %6d splats %7.2f ms | %6d tris %7.2f ms | coverage agreement %5.1f%%\n",
+            dis, cut.count(), splat_ms, task.geom.indices.count() / 3, tri_ms,
+            either ? 100.0f * both / either : 100.0f);
+    }
+}
+
+#endif // MESH_GEN_ENABLED
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "meshgen.h"
+
+#if MESH_GEN_ENABLED
+
+#include "cpurender.h"
+
+// Point splat LOD: every octree cell that can hold surface keeps one
+// SurfacePoint, so each level is a complete, coarser point cloud of the scene.
+// Nodes are stored breadth first with children contiguous. A frame picks a
+// cut through the tree, descending only while a splat could reach more than
+// max_error pixels past the surface, so distant geometry costs few splats.
+
+struct SplatNode
+{
+    vec3 position;
+    vec3 normal;
+    vec3 color;
+    vec3 material;          // roughness, metalness, ao
+    vec3 center;            // of the octree cell
+    float half;             // half the cell's edge
+    float radius;           // world space splat radius, covers the cell's surface
+    u32 first_child;
+    u32 num_children;
+};
+
+struct SplatView
+{
+    vec3 eye;
+    mat4 VP;
+    float pixels_per_unit;  // height / (2 * tan(fovy / 2)), pixels per unit at distance 1
+};
+
+struct SplatTree
+{
+    Vector<SplatNode> m_nodes;  // m_nodes[0] is the root
+    Vector<u32> m_levels;       // index of the first node of every level
+
+    // the same octree GenerateMesh walks for task, down to task.max_depth
+    void build(const MeshTask& task, const u32 num_threads = 0);
+    void selectCut(const SplatView& view, const float max_error, Vector<u32>& cut) const;
+};
+
+// software z-buffer, row 0 at the top like CPURender
+struct RasterTarget
+{
+    u32 width = 0;
+    u32 height = 0;
+    u8* rgba = nullptr;
+    float* depth = nullptr;     // view distance, FLT_MAX where nothing drew
+
+    RasterTarget(const u32 w, const u32 h);
+    ~RasterTarget();
+    RasterTarget(const RasterTarget&) = delete;
+    RasterTarget& operator=(const RasterTarget&) = delete;
+    void clear();
+};
+
+// square splats shaded once each; back facing ones are skipped
+void RasterSplats(const SplatTree& tree, const Vector<u32>& cut, const SplatView& view,
+    const CPUSun& sun, RasterTarget& target);
+// indexed or soup geometry, shaded per vertex; back facing and near clipped
+// triangles are skipped
+void RasterTriangles(const Geometry& geom, const SplatView& view, const CPUSun& sun, RasterTarget& target);
+
+// cut size and frame time against the triangle mesh at increasing distance
+void SplatBench();
+
+#endif // MESH_GEN_ENABLED
@@ -0,0 +1,68 @@
+#version 450 core
+
+// SplatVertex: a PackedVertex, drawn as a point, and its radius
+layout(location = 0) in vec3 position;  // across the tree bounds
+layout(location = 1) in vec2 material;  // roughness, metalness
+layout(location = 2) in vec2 normal;    // octahedral
+layout(location = 3) in vec4 color;     // rgb, ao
+layout(location = 4) in float radius;   // world space
+
+out vec3 Position;
+out vec3 Normal;
+out vec3 Albedo;
+out vec3 Material;
+
+#define SHARED_UNIFORMS_BINDING 13
+
+struct SharedUniforms
+{
+    mat4 MVP;
+    mat4 IVP;
+    mat4 sunMatrix;
+    vec4 sunDirection;
+    vec4 sunColor; // w -> intensity
+    vec4 eye;
+    vec4 render_resolution; // zw -> sunNearFar
+    vec4 df_translation; // w -> df_pitch;
+    vec4 df_scale;
+    ivec4 seed_flags; // x -> seed, y -> draw mode
+    ivec4 sampler_states; // x -> env_cm; y -> sunDepth;
+};
+
+layout(std430, binding = SHARED_UNIFORMS_BINDING) buffer SU_BUFFER
+{
+    SharedUniforms SU;
+};
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    // df_translation is the bounds' lo, df_scale their extent, df_scale.w
+    // pixels per unit at distance 1
+    const vec3 pos = position.xyz * SU.df_scale.xyz + SU.df_translation.xyz;
+    Position.xyz = pos.xyz;
+    Normal = octDecode(normal);
+    Albedo = color.rgb;
+    Material = vec3(material.xy, color.a);
+    gl_Position = SU.MVP * vec4(pos.xyz, 1.0);
+
+    // a square as wide as RasterSplats draws it. GL draws any point over at
+    // least one pixel, so splats whose square holds no pixel center are
+    // dropped like back facing ones, by moving them outside the clip volume.
+    const float r = radius * SU.df_scale.w / max(gl_Position.w, 0.01);
+    const vec2 win = (gl_Position.xy / max(gl_Position.w, 0.01) * 0.5 + 0.5) * SU.render_resolution.xy;
+    const bvec2 empty = lessThan(floor(win + r - 0.5), ceil(win - r - 0.5));
+    gl_PointSize = 2.0 * r;
+    if(dot(Normal, SU.eye.xyz - pos) < 0.0 || any(empty))
+    {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+    }
+}
@@ -0,0 +1,74 @@
+#include "store.h"
+#include "cputimer.h"
+#include <cstdio>
+
+#define BENCH_STORE_CAP     4096
+#define BENCH_STORE_KEYS    3600
+
+// the size of NameStore's TextBlock
+struct BenchBlock
+{
+    char m_text[256];
+    BenchBlock(){ m_text[0] = 0; }
+    BenchBlock(u32 i){ m_text[0] = char('a' + i % 26); m_text[1] = 0; }
+};
+
+template<typename T, typename Map>
+static void BenchStore(const char* name, Map& map, const u32* keys)
+{
+    CPUTimer timer;
+    for(u32 i = 0; i < BENCH_STORE_KEYS; ++i)
+    {
+        map.insert(keys[i], T(i));
+    }
+    const double insert_ns = timer.ms() * 1e6 / BENCH_STORE_KEYS;
+
+    u32 sum = 0;
+    timer.begin();
+    for(u32 r = 0; r < 16; ++r)
+    {
+        for(u32 i = 0; i < BENCH_STORE_KEYS; ++i)
+        {
+            const T* p = map.get(keys[i]);
+            sum += p ? 1 : 0;
+        }
+    }
+    const double hit_ns = timer.ms() * 1e6 / (BENCH_STORE_KEYS * 16);
+
+    timer.begin();
+    for(u32 i = 0; i < BENCH_STORE_KEYS; ++i)
+    {
+        map.remove(keys[i]);
+    }
+    const double erase_ns = timer.ms() * 1e6 / BENCH_STORE_KEYS;
+
+    printf("[Store] %-26s insert %7.1f ns, hit %5.1f ns, erase %6.1f ns (%u)\n",
+        name, insert_ns, hit_ns, erase_ns, sum);
+}
+
+void StoreBench()
+{
+    u32* keys = new u32[BENCH_STORE_KEYS];
+    for(u32 i = 0; i < BENCH_STORE_KEYS; ++i)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "u_uniform%u", i);
+        keys[i] = fnv(name);
+    }
+    printf("[Store] %u keys in %u slots, %u byte values\n", BENCH_STORE_KEYS, BENCH_STORE_CAP, u32(sizeof(BenchBlock)));
+
+    {
+        typedef Store<BenchBlock, BENCH_STORE_CAP> BigStore;
+        BigStore* store = new BigStore();
+        BenchStore<BenchBlock>("Store<256 bytes>", *store, keys);
+        delete store;
+    }
+    {
+        typedef Store<s32, BENCH_STORE_CAP> SmallStore;
+        SmallStore* store = new SmallStore();
+        BenchStore<s32>("Store<s32>", *store, keys);
+        delete store;
+    }
+
+    delete[] keys;
+}
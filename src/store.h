@@ -5,6 +5,11 @@
 #include "asserts.h"
 #include "hash.h"
 
+// Robin Hood table over a fixed capacity. Probing only touches names and
+// slots, the key and the index of its value; values sit in data at the index
+// they were given on insert and never move, so displacing an entry swaps two
+// u32s whatever the size of T, and pointers from get stay valid until the
+// key is removed.
 template<typename T, const u32 cap>
 class Store
 {
@@ -13,12 +18,30 @@ class Store
     
     T data[cap];
     u32 names[cap];
+    u32 slots[cap];         // index into data for each name
+    u32 free_list[cap];     // unused data indices, a stack
+    u32 num_free;
     u32 count;
     u32 capacity;
 
+    u32 alloc_index(){
+        Assert(num_free > 0);
+        return free_list[--num_free];
+    }
+    void free_index(u32 index){
+        free_list[num_free++] = index;
+    }
+    void reset_free(){
+        // pops hand out 0, 1, 2... so a fresh store fills data front to back
+        for(u32 i = 0; i < cap; ++i){
+            free_list[i] = cap - 1 - i;
+        }
+        num_free = cap;
+    }
+
 public:
     u32 getKey(s32 idx){ return names[idx]; }
-    T& getValue(s32 idx){ return data[idx]; }
+    T& getValue(s32 idx){ return data[slots[idx]]; }
     u32 getCapacity(){ return capacity; }
     bool validSlot(s32 idx){ return names[idx] != 0 && names[idx] != Tombstone; }
     bool is_deleted(u32 key){
@@ -62,6 +85,7 @@ public:
     }
     Store(){
         memset(names, 0, sizeof(u32) * cap);
+        reset_free();
         count = 0;
         capacity = cap;
     }
@@ -84,7 +108,7 @@ public:
             return m_idx != o.m_idx;
         }
         T& operator*(){
-            return m_pStore->data[m_idx];
+            return m_pStore->data[m_pStore->slots[m_idx]];
         }
         iterator& operator++(){
             ++m_idx;
@@ -96,43 +120,35 @@ public:
     iterator begin(){ return iterator(this); }
     iterator end(){ return iterator(this, capacity); }
 
-    void insert(u32 key, T&& val) noexcept
+    // the value is moved into place once; probing after that moves indices
+    T* insert(u32 key, T&& val) noexcept
     {
         Assert(count < cap);
+        u32 index = alloc_index();
+        T* result = data + index;
+        *result = static_cast<T&&>(val);
+        count++;
+
         u32 pos = mask(key);
         u32 dist = 0;
         while(true)
         {
-            if(names[pos] == 0)
+            if(names[pos] == 0 || (is_deleted(names[pos]) && probe_distance(pos, names[pos]) < dist))
             {
                 names[pos] = key;
-                data[pos] = val;
-                count++;
-                return;
+                slots[pos] = index;
+                return result;
             }
 
             u32 existing_dist = probe_distance(pos, names[pos]);
             if(existing_dist < dist)
             {
-                if(is_deleted(names[pos]))
-                {
-                    names[pos] = key;
-                    data[pos] = val;
-                    count++;
-                    return;
-                }
-
-                {
-                    const u32 tname = key;
-                    key = names[pos];
-                    names[pos] = tname;
-                }
-                {
-                    const T tval = val;
-                    val = data[pos];
-                    data[pos] = tval;
-                }
-
+                const u32 tname = names[pos];
+                const u32 tindex = slots[pos];
+                names[pos] = key;
+                slots[pos] = index;
+                key = tname;
+                index = tindex;
                 dist = existing_dist;
             }
 
@@ -140,42 +156,47 @@ public:
             ++dist;
         }
     }
-    void insert(const char** name, const T& val){
-        insert(fnv(name), val);
+    T* insert(u32 key, const T& val){
+        return insert(key, T(val));
+    }
+    T* insert(const char* name, T&& val){
+        return insert(fnv(name), static_cast<T&&>(val));
     }
     T* get(u32 key){
         u32 loc = index_of(key);
         if(loc == invalid_val){
             return nullptr;
         }
-        return data + loc;
+        return data + slots[loc];
     }
-    T* get(const char** name){
+    T* get(const char* name){
         return get(fnv(name));
     }
     T* operator[](u32 key){
         return get(key);
     }
-    T* operator[](const char** name){
+    T* operator[](const char* name){
         return get(fnv(name));
     }
+    // the value stays readable until its index is handed to another insert
     T* remove(u32 key){
         u32 loc = index_of(key);
         if(loc != invalid_val){
             names[loc] = Tombstone;
+            free_index(slots[loc]);
             count--;
-            return data + loc;
+            return data + slots[loc];
         }
         return nullptr;
     }
-    T* remove(const char** name){
+    T* remove(const char* name){
         return remove(fnv(name));
     }
     bool exists(u32 key){
         u32 loc = index_of(key);
-        return loc != invalid_key;
+        return loc != invalid_val;
     }
-    bool exists(const char** name){
+    bool exists(const char* name){
         return exists(fnv(name));
     }
     u32 empty_slots(){
@@ -186,19 +207,20 @@ public:
         Assert(full());
         u32 loc = first_evictable(name);
         names[loc] = Tombstone;
+        free_index(slots[loc]);
         count--;
-        return data + loc;
+        return data + slots[loc];
     }
-    T* remove_near(const char** name){
+    T* remove_near(const char* name){
         return remove_near(fnv(name));
     }
     T* reuse_near(u32 name){
         Assert(full());
         u32 loc = first_evictable(name);
         names[loc] = name;
-        return data + loc;
+        return data + slots[loc];
     }
-    T* reuse_near(const char** name){
+    T* reuse_near(const char* name){
         return reuse_near(fnv(name));
     }
     u32 grow(){
@@ -208,22 +230,26 @@ public:
             key = ((key + 1) & 0x7fffffff);
             key = key ? key : 1;
         }
-        insert(key, {});
+        insert(key, T());
         return key;
     }
     void clear()
     {
-        for(u32 i = 0; i < count; ++i)
-        {
-            names[i] = 0;
-        }
-        for(u32 i = 0; i < count; ++i)
+        // keys sit anywhere in the table, not in the first count slots
+        memset(names, 0, sizeof(u32) * cap);
+        for(u32 i = 0; i < cap; ++i)
         {
             data[i] = T();
         }
+        reset_free();
+        count = 0;
     }
 };
 
+// insert and lookup cost with a large T: index displacement against moving
+// whole values, as Store did before splitting them out
+void StoreBench();
+
 inline void store_test(){
     constexpr u32 c = 2048;
     Store<s32, c> store;
@@ -1 +1,63 @@
 #include "vertexbuffer.h"
+
+static u16 Unorm16(const float x)
+{
+    return u16(glm::clamp(x, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+static u8 Unorm8(const float x)
+{
+    return u8(glm::clamp(x, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static s16 Snorm16(const float x)
+{
+    return s16(glm::round(glm::clamp(x, -1.0f, 1.0f) * 32767.0f));
+}
+
+snorm16x2 PackNormal(const vec3& N)
+{
+    // a degenerate normal packs as +z rather than dividing by zero
+    const float l1 = glm::abs(N.x) + glm::abs(N.y) + glm::abs(N.z);
+    if(!(l1 > 0.0f))
+        return { 0, 0 };
+    // project onto the octahedron, folding the lower half over the upper
+    const vec3 p = N / l1;
+    vec2 e = vec2(p.x, p.y);
+    if(p.z < 0.0f)
+    {
+        e = (vec2(1.0f) - glm::abs(vec2(p.y, p.x))) * vec2(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return { Snorm16(e.x), Snorm16(e.y) };
+}
+
+vec3 UnpackNormal(const snorm16x2& e)
+{
+    const vec2 f = glm::max(vec2(e.x, e.y) / 32767.0f, vec2(-1.0f));
+    vec3 N = vec3(f.x, f.y, 1.0f - glm::abs(f.x) - glm::abs(f.y));
+    const float t = glm::max(-N.z, 0.0f);
+    N.x += N.x >= 0.0f ? -t : t;
+    N.y += N.y >= 0.0f ? -t : t;
+    return glm::normalize(N);
+}
+
+PackedVertex PackVertex(const vec3& position, const vec3& normal, const vec3& color, const vec3& material,
+    const vec3& origin, const vec3& extent)
+{
+    const vec3 q = (position - origin) / extent;
+    PackedVertex v;
+    v.position = { Unorm16(q.x), Unorm16(q.y), Unorm16(q.z) };
+    v.material = { Unorm8(material.x), Unorm8(material.y) };
+    v.normal = PackNormal(normal);
+    v.color = { Unorm8(color.x), Unorm8(color.y), Unorm8(color.z), Unorm8(material.z) };
+    return v;
+}
+
+void UnpackVertex(const PackedVertex& v, const vec3& origin, const vec3& extent,
+    vec3& position, vec3& normal, vec3& color, vec3& material)
+{
+    position = origin + vec3(v.position.x, v.position.y, v.position.z) / 65535.0f * extent;
+    normal = UnpackNormal(v.normal);
+    color = vec3(v.color.x, v.color.y, v.color.z) / 255.0f;
+    material = vec3(v.material.x, v.material.y, v.color.w) / 255.0f;
+}
@@ -1,8 +1,43 @@
 #pragma once
 
 #include "linmath.h"
+#include "ints.h"
 
 struct Vertex 
 {
     vec3 position;
 };
+
+// normalized integer attributes; mesh_layout maps them to floats in the shader
+struct unorm16x3 { u16 x, y, z; };
+struct snorm16x2 { s16 x, y; };
+struct unorm8x2 { u8 x, y; };
+struct unorm8x4 { u8 x, y, z, w; };
+
+// 16 bytes against 48 for a float MeshVertex. Positions are quantised across
+// the bounds of the chunk they belong to, normals octahedral encoded.
+struct PackedVertex
+{
+    unorm16x3 position;
+    unorm8x2 material;      // roughness, metalness
+    snorm16x2 normal;
+    unorm8x4 color;         // rgb, ao
+};
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+// a point splat for splatVert.glsl: a PackedVertex and its world space radius
+struct SplatVertex
+{
+    PackedVertex vertex;
+    float radius;
+};
+
+snorm16x2 PackNormal(const vec3& N);
+vec3 UnpackNormal(const snorm16x2& e);
+
+// origin and extent are the quantisation bounds, lo and hi - lo
+PackedVertex PackVertex(const vec3& position, const vec3& normal, const vec3& color, const vec3& material,
+    const vec3& origin, const vec3& extent);
+void UnpackVertex(const PackedVertex& v, const vec3& origin, const vec3& extent,
+    vec3& position, vec3& normal, vec3& color, vec3& material);